@@ -15,9 +15,24 @@ let package = Package(
     targets: [
         // Targets are the basic building blocks of a package. A target can define a module or a test suite.
         // Targets can depend on other targets in this package, and on products in packages this package depends on.
+        .target(
+            name: "vrEmuTms9918",
+            path: "src",
+            // only what the VideoDisplayProcessor library links against (the frame output conversion).
+            // the threaded, memory mapped and WebAssembly modules aren't part of the package
+            sources: ["vrEmuTms9918.c", "vrEmuTms9918Util.c", "vrEmuTms9918Output.c"],
+            // no public headers (there's no src/include): the library finds the core's headers,
+            // including the internal kernels, through its own header search path
+            cSettings: [.define("VR_TMS9918_EMU_STATIC")]
+        ),
         .target(
             name: "VideoDisplayProcessor",
-            dependencies: []
+            // shares the scanline kernels (vrEmuTms9918Kernels.h) with the core
+            dependencies: ["vrEmuTms9918"],
+            cSettings: [
+                .define("VR_TMS9918_EMU_STATIC"),
+                .headerSearchPath("../../src")
+            ]
         ),
         .testTarget(
             name: "VideoDisplayProcessorTests",
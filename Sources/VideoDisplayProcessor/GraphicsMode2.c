@@ -0,0 +1,35 @@
+//
+//  GraphicsMode2.c
+//
+//
+
+#include "GraphicsMode2.h"
+#include "Sprites.h"
+#include "VideoDisplayProcessor_Private.h"
+
+#include "vrEmuTms9918Kernels.h"
+
+void GraphicsMode2GetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]) {
+    if (!vdp) {
+        return;
+    }
+
+    const uint8_t *vram = VDPGetVramView(vdp).bytes;
+
+    const uint8_t nameTableRow = rowIdx >> 3; // divide by size of each tile (8 bytes) to get first tile in that row
+    const uint8_t innerPatternRow = rowIdx & 0x07; // this is the row within the pattern itself
+
+    // each third of the screen has its own 256 patterns and colors, unless the table address masks are invalid
+    const bool invalidMasks = !VDPGraphicsMode2MasksValid(vdp);
+    const uint16_t pageOffset = tmsGraphicsIIPageOffset(nameTableRow, invalidMasks);
+
+    const uint8_t *names = vram + VDPGetVramNameTableAddress(vdp) + (nameTableRow * kVDPGraphicsTileX);
+    const uint8_t *patternTable = vram + VDPGetVramPatternTableAddress(vdp) + pageOffset;
+    const uint8_t *colorTable = vram + VDPGetVramColorTableAddress(vdp) + pageOffset; // a color byte per pattern row
+
+    tmsGraphicsIIRow(names, patternTable, colorTable, innerPatternRow, invalidMasks ? 0x07 : 0xFF,
+                     VDPGetColorPairs(vdp), pixelBuffer, NULL);
+
+    // overwrite with sprites
+    SpritesOverwriteScanline(vdp, rowIdx, pixelBuffer);
+}
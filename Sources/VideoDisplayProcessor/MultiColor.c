@@ -0,0 +1,30 @@
+//
+//  MultiColor.c
+//
+//
+
+#include "MultiColor.h"
+#include "Sprites.h"
+#include "VideoDisplayProcessor_Private.h"
+
+#include "vrEmuTms9918Kernels.h"
+
+void MultiColorGetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]) {
+    if (!vdp) {
+        return;
+    }
+
+    const uint8_t *vram = VDPGetVramView(vdp).bytes;
+
+    const uint8_t nameTableRow = rowIdx >> 3; // divide by size of each tile (8 bytes) to get first tile in that row
+
+    // each name is a 2x2 block of colors: every pattern byte holds a left / right pair,
+    // 4 scanlines tall, and the name table row picks which pair of bytes is used
+    const uint8_t *names = vram + VDPGetVramNameTableAddress(vdp) + (nameTableRow * kVDPGraphicsTileX);
+    const uint8_t *patternTable = vram + VDPGetVramPatternTableAddress(vdp);
+
+    tmsMulticolorRow(names, patternTable, tmsMulticolorPattRow(rowIdx), VDPGetColorPairs(vdp), pixelBuffer, NULL);
+
+    // overwrite with sprites
+    SpritesOverwriteScanline(vdp, rowIdx, pixelBuffer);
+}
@@ -0,0 +1,57 @@
+//
+//  Output.c
+//
+//
+
+#include "Output.h"
+
+#include "vrEmuTms9918Output.h"
+
+// the formats are declared in the same order as the core's
+_Static_assert((int)kVDPPixelFormatRGB888 == (int)TMS_PIXEL_RGB888, "VDPPixelFormat doesn't match vrEmuTms9918PixelFormat");
+_Static_assert(kVDPOutputMaxScale == TMS9918_OUTPUT_MAX_SCALE, "kVDPOutputMaxScale doesn't match TMS9918_OUTPUT_MAX_SCALE");
+
+/// sets up the core conversion for `format` and `scale` with the VDP palette
+static bool VDPOutputInit(vrEmuTms9918Output *output, VDPPixelFormat format, uint8_t scale) {
+    return vrEmuTms9918OutputInit(output, (vrEmuTms9918PixelFormat)format, scale, VDPColorPalette);
+}
+
+bool VDPConvertPixels(const uint8_t *pixels, size_t numPixels, VDPPixelFormat format, uint8_t scale,
+                      void *surface, size_t pitch) {
+    vrEmuTms9918Output output;
+    if (!pixels || !surface || !VDPOutputInit(&output, format, scale)) {
+        return false;
+    }
+
+    vrEmuTms9918OutputLine(&output, pixels, numPixels, surface, pitch);
+    return true;
+}
+
+bool VDPGetScanlineInFormat(VideoDisplayProcessorRef vdp, uint8_t rowIdx, VDPPixelFormat format, uint8_t scale,
+                            void *surface, size_t pitch) {
+    vrEmuTms9918Output output;
+    if (!vdp || !surface || !VDPOutputInit(&output, format, scale)) {
+        return false;
+    }
+
+    uint8_t pixels[kVDPSizeX];
+    VDPGetScanline(vdp, rowIdx, pixels);
+
+    vrEmuTms9918OutputLine(&output, pixels, kVDPSizeX, surface, pitch);
+    return true;
+}
+
+bool VDPConvertFrame(const uint8_t *frame, VDPPixelFormat format, uint8_t scale, void *surface, size_t pitch) {
+    vrEmuTms9918Output output;
+    if (!frame || !surface || !VDPOutputInit(&output, format, scale)) {
+        return false;
+    }
+
+    uint8_t *row = surface;
+    for (int y = 0; y < kVDPSizeY; ++y) {
+        vrEmuTms9918OutputLine(&output, frame + y * kVDPSizeX, kVDPSizeX, row, pitch);
+        row += pitch * scale;
+    }
+
+    return true;
+}
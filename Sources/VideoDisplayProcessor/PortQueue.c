@@ -0,0 +1,108 @@
+//
+//  PortQueue.c
+//
+//
+
+#include "PortQueue.h"
+
+// the ring (and its atomics) is shared with the core's port queue
+#include "vrEmuTms9918PortRing.h"
+
+#include <stdlib.h>
+
+struct __VDPPortQueue {
+    VideoDisplayProcessorRef vdp;
+    tmsPortRing ring;
+};
+
+#pragma mark Ports
+
+static void VDPPortWriteRegister(void *vdp, uint8_t value) {
+    VDPWriteToRegisterPort(vdp, value);
+}
+
+static void VDPPortWriteData(void *vdp, uint8_t value) {
+    VDPWriteToDataPort(vdp, value);
+}
+
+static uint8_t VDPPortReadRegister(void *vdp) {
+    return VDPReadFromRegisterPort(vdp);
+}
+
+static uint8_t VDPPortReadData(void *vdp) {
+    return VDPReadFromDataPort(vdp);
+}
+
+/// the VDP's ports, as applied by `tmsPortRingDrain`
+static const tmsPortTarget kVDPPorts = {
+    VDPPortWriteRegister, VDPPortWriteData, VDPPortReadRegister, VDPPortReadData
+};
+
+#pragma mark Queue
+
+VDPPortQueueRef VDPPortQueueCreate(VideoDisplayProcessorRef vdp, size_t capacity) {
+    if (!vdp) {
+        return NULL;
+    }
+
+    struct __VDPPortQueue *queue = calloc(1, sizeof(struct __VDPPortQueue));
+    if (!queue) {
+        return NULL;
+    }
+
+    if (!tmsPortRingInit(&queue->ring, capacity)) {
+        free(queue);
+        return NULL;
+    }
+
+    queue->vdp = vdp;
+
+    return queue;
+}
+
+void VDPPortQueueDestroy(VDPPortQueueRef queue) {
+    if (queue) {
+        tmsPortRingFree(&queue->ring);
+        free(queue);
+    }
+}
+
+void VDPPortQueueWriteToRegisterPort(VDPPortQueueRef queue, uint8_t value) {
+    if (!queue) {
+        return;
+    }
+
+    tmsPortRingPush(&queue->ring, TMS_PORT_WRITE_ADDR, value);
+}
+
+void VDPPortQueueWriteToDataPort(VDPPortQueueRef queue, uint8_t value) {
+    if (!queue) {
+        return;
+    }
+
+    tmsPortRingPush(&queue->ring, TMS_PORT_WRITE_DATA, value);
+}
+
+uint8_t VDPPortQueueReadFromRegisterPort(VDPPortQueueRef queue) {
+    if (!queue) {
+        return 0;
+    }
+
+    return tmsPortRingRead(&queue->ring, TMS_PORT_READ_STATUS);
+}
+
+uint8_t VDPPortQueueReadFromDataPort(VDPPortQueueRef queue) {
+    if (!queue) {
+        return 0;
+    }
+
+    return tmsPortRingRead(&queue->ring, TMS_PORT_READ_DATA);
+}
+
+size_t VDPPortQueueDrain(VDPPortQueueRef queue) {
+    if (!queue) {
+        return 0;
+    }
+
+    return tmsPortRingDrain(&queue->ring, &kVDPPorts, queue->vdp);
+}
@@ -1,52 +1,91 @@
 //
 //  Sprites.c
-//  
+//
 //
 //  Created by Nate Rivard on 24/07/2023.
 //
 
 #include "Sprites.h"
+#include "SpritesFrame.h"
 #include "VideoDisplayProcessor_Private.h"
 
-typedef struct {
-    uint8_t yPos;
-    uint8_t xPos;
-    uint8_t patternIdx;
-    uint8_t color;      // low nibble contains color, high bit is `kVDPSpriteEarlyClkMask`
-} SpriteAttrs;
+#include <memory.h>
+
+/// takes a new snapshot of the sprite attribute table and re-buckets sprites by scanline
+static void SpritesCaptureFrame(VideoDisplayProcessorRef vdp, SpritesFrame *frame, uint8_t spriteFlags) {
+    VDPGetVramBlock(vdp, VDPGetVramSpriteAttributesAddress(vdp), frame->attrs, kVDPSpriteAttrsSize);
+    tmsEvaluateSprites(frame->attrs, spriteFlags, frame->lines);
+    frame->valid = true;
+}
+
+/// draws the sprites on a scanline and accumulates collision / 5th sprite status
+/// `spriteFlags` is always a constant, so each size/magnification combination gets its own copy of the loop
+static TMS_FORCE_INLINE void SpritesOutputLine(const SpritesFrame *frame, const uint8_t *vram, uint16_t spritePatternTable,
+                                               uint8_t rowIdx, uint8_t *pixels, uint8_t *status, const uint8_t spriteFlags) {
+    const tmsSpriteLine *line = &frame->lines[rowIdx];
+
+    // collision mask for this line (msb first)
+    uint64_t rowSpriteBits[kVDPSizeX / 64] = { 0 };
+
+    for (uint8_t i = 0; i < line->numSprites; ++i) {
+        const uint8_t *attrs = frame->attrs + line->sprites[i] * 4;
+
+        int16_t xPos;
+        const uint32_t spriteBits = tmsSpriteRowBits(vram, spritePatternTable, attrs, rowIdx, &xPos, spriteFlags);
+
+        if (tmsSpriteCollision(rowSpriteBits, spriteBits, xPos)) {
+            *status |= kVDPStatusSprCoMask;
+        }
+
+        // transparent sprites are still processed, since they count towards collisions and the 5th sprite
+        const uint8_t color = attrs[SPRITE_ATTR_COLOR] & 0x0F;
+        if (color != kVDPColorTransparent) {
+            tmsDrawSprite(pixels, spriteBits, xPos, color, spriteFlags);
+        }
+    }
+
+    // 5th sprite (or last processed sprite) index is latched until status is read
+    if (!(*status & kVDPStatus5thSprMask)) {
+        *status |= line->status;
+    }
+}
 
 void SpritesOverwriteScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]) {
-    if (!vdp) {
+    if (!vdp || rowIdx >= kVDPSizeY) {
         return;
     }
 
-    uint8_t *pixels = pixelBuffer;
+    const uint8_t spriteFlags = VDPGetRegister(vdp, 1) & (kVDPSpriteSizeLargeMask | kVDPSpriteMagMask);
 
-    const uint8_t status = VDPGetStatus(vdp);
-    const uint8_t control1 = VDPGetRegister(vdp, 1);
-    const uint8_t spriteSize = (control1 & kVDPSpriteSizeLargeMask ? 16 : 8) * (control1 & kVDPSpriteMagMask ? 2 : 1);
+    SpritesFrame *frame = VDPGetSpritesFrame(vdp);
+    if (!frame->valid) {
+        SpritesCaptureFrame(vdp, frame, spriteFlags);
+    }
 
-    const uint16_t spriteAttrTable = VDPGetVramSpriteAttributesAddress(vdp);
+    // sprite patterns are read live, only the attributes are cached
+    const uint8_t *vram = VDPGetVramView(vdp).bytes;
     const uint16_t spritePatternTable = VDPGetVramSpriteNamesAddress(vdp);
 
-    // keeps track of 5th sprite where we need to stop processing sprites and set status register fields
-    uint8_t spritesOnLine = 0;
+    uint8_t status = VDPGetStatus(vdp);
 
-    // let's copy over sprite attrs
-    SpriteAttrs spriteAttrs[kVDPSpriteMax];
-    VDPGetVramBlock(vdp, spriteAttrTable, (uint8_t *)spriteAttrs, sizeof(SpriteAttrs) * kVDPSpriteMax);
+    switch (spriteFlags) {
+        case 0:
+            SpritesOutputLine(frame, vram, spritePatternTable, rowIdx, pixelBuffer, &status, 0);
+            break;
 
-    for (uint8_t spriteIdx = 0; spriteIdx < kVDPSpriteMax; ++spriteIdx) {
-        SpriteAttrs current = spriteAttrs[spriteIdx];
+        case kVDPSpriteMagMask:
+            SpritesOutputLine(frame, vram, spritePatternTable, rowIdx, pixelBuffer, &status, kVDPSpriteMagMask);
+            break;
 
-        if (current.yPos == kVDPSpriteHideRemaining) {
-            if (status == 0) {
-                VDPSetStatus(vdp, status | spriteIdx);
-            }
-            return;
-        }
+        case kVDPSpriteSizeLargeMask:
+            SpritesOutputLine(frame, vram, spritePatternTable, rowIdx, pixelBuffer, &status, kVDPSpriteSizeLargeMask);
+            break;
 
-        // use 16 bit signed value. have to convert to signed 8 bit first otherwise sign won't be extended
-        int16_t signedYPos = (int16_t)(int8_t)current.yPos;
+        default:
+            SpritesOutputLine(frame, vram, spritePatternTable, rowIdx, pixelBuffer, &status,
+                              kVDPSpriteSizeLargeMask | kVDPSpriteMagMask);
+            break;
     }
+
+    VDPSetStatus(vdp, status);
 }
@@ -0,0 +1,37 @@
+//
+//  SpritesFrame.h
+//
+//
+//  Per-frame sprite state shared by VideoDisplayProcessor.c and Sprites.c.
+//  Deliberately kept out of `include/` since it pulls in the vrEmuTms9918 kernels.
+//
+
+#ifndef SpritesFrame_h
+#define SpritesFrame_h
+
+#include "VideoDisplayProcessor_Private.h"
+
+// sprite evaluation is shared with the vrEmuTms9918 core
+#include "vrEmuTms9918Kernels.h"
+
+/// bytes in the sprite attribute table
+#define kVDPSpriteAttrsSize     (kVDPSpriteMax * 4)
+
+/// a snapshot of the sprite attribute table, bucketed into per-scanline sprite lists
+/// captured on the first sprite scanline after it becomes invalid, then reused for every line
+/// until the attribute table, its address or the sprite size/magnification change (typically once per frame)
+typedef struct {
+    /// whether `attrs` and `lines` reflect the current vram and registers
+    bool valid;
+
+    /// copy of the sprite attribute table
+    uint8_t attrs[kVDPSpriteAttrsSize];
+
+    /// sprites to draw on each scanline, and the status bits each line sets
+    tmsSpriteLine lines[kVDPSizeY];
+} SpritesFrame;
+
+/// returns the VDP's sprite snapshot
+extern SpritesFrame *VDPGetSpritesFrame(VideoDisplayProcessorRef vdp);
+
+#endif /* SpritesFrame_h */
@@ -7,10 +7,17 @@
 
 #include "VideoDisplayProcessor.h"
 #include "VideoDisplayProcessor_Private.h"
+#include "SpritesFrame.h"
 #include "GraphicsMode1.h"
+#include "GraphicsMode2.h"
+#include "MultiColor.h"
 #include "TextMode.h"
+#include "vrEmuTms9918Kernels.h"
+#include "vrEmuTms9918Watch.h"
+#include "vrEmuTms9918Atomic.h"
 
 #include <memory.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #define kVDPRegisterCount   8
@@ -18,9 +25,9 @@
 #define kVDPUnsetAddr       0xFFFF  // 0xFFFF is outside of valid vram space so we're using this to express the register is in stage 1
 #define kVDPDisplayEnMask   0b01000000
 #define kVDPIRQEnMask       0b00100000
-#define kVDPStatusIRQMask    0b10000000
-#define kVDPStatus5thSprMask 0b01000000
-#define kVDPStatusSprCoMask  0b0010000
+#define kVDPFrameBuffers    3
+#define kVDPFrameSlotFresh  0x04    // set in `FrameBuffers.shared` when it holds a frame the display thread hasn't seen
+#define kVDPFrameSlotIndex  0x03
 
 const uint32_t VDPColorPaletteArray[] = {
     0x00000000, // kVDPColorTransparent
@@ -47,6 +54,33 @@ typedef struct {
     void (*handler)(void *observer);
 } InterruptHandler;
 
+typedef struct {
+    void *observer;
+    VDPWatchHandler handler;
+} WatchHandler;
+
+// the watch set (shared with the core) tracks the limits
+typedef char VDPWatchLimitsCheck[(kVDPMaxWatches == TMS9918_MAX_WATCHES && kVDPWatchMaxRanges == TMS9918_WATCH_MAX_RANGES) ? 1 : -1];
+
+/// triple-buffered output for `VDPRenderFrame` / `VDPAcquireFrame`
+/// each buffer is owned by one thread at a time, ownership is handed over by exchanging `shared`
+typedef struct {
+    uint8_t pixels[kVDPFrameBuffers][kVDPSizeY][kVDPSizeX];
+
+    /// number of the frame in each buffer, handed over with the buffer
+    uint64_t frameNumbers[kVDPFrameBuffers];
+
+    /// emulation thread only
+    uint8_t back;
+    uint64_t published;
+
+    /// display thread only
+    uint8_t front;
+
+    /// the latest finished frame: buffer index | `kVDPFrameSlotFresh`
+    tmsAtomicU32 shared;
+} FrameBuffers;
+
 struct __VideoDisplayProcessor {
     /// write-only registers
     uint8_t registers[kVDPRegisterCount];
@@ -69,17 +103,58 @@ struct __VideoDisplayProcessor {
     uint8_t readAheadBuffer;
 
     InterruptHandler interruptHandler;
+
+    /// sprite attribute snapshot, invalidated by register writes and writes to the sprite attribute table
+    SpritesFrame sprites;
+
+    /// color table bytes resolved against the background color, rebuilt when register 7 changes it
+    tmsColorPairs colorPairs;
+
+    /// not touched by `VDPReset`, the display thread may be reading from it
+    FrameBuffers frames;
+
+    /// vram watches and their handlers (`VDPAddWatch`), not touched by `VDPReset`
+    tmsWatchSet watches;
+    WatchHandler watchHandlers[kVDPMaxWatches];
 };
 
 #pragma mark Lifecycle
 
 VideoDisplayProcessorRef VDPCreate() {
-    struct __VideoDisplayProcessor *vdp = malloc(sizeof(struct __VideoDisplayProcessor));
+    return VDPInit(malloc(sizeof(struct __VideoDisplayProcessor)));
+}
 
-    if (vdp) {
-        VDPReset(vdp);
+/// used to determine the alignment of `struct __VideoDisplayProcessor` (C99 has no `alignof`)
+typedef struct {
+    char c;
+    struct __VideoDisplayProcessor vdp;
+} VDPAlignProbe;
+
+size_t VDPSizeOf(void) {
+    return sizeof(struct __VideoDisplayProcessor);
+}
+
+size_t VDPAlignOf(void) {
+    return offsetof(VDPAlignProbe, vdp);
+}
+
+VideoDisplayProcessorRef VDPInit(void *mem) {
+    if (!mem || ((uintptr_t)mem % VDPAlignOf()) != 0) {
+        return NULL;
     }
-    
+
+    struct __VideoDisplayProcessor *vdp = mem;
+    VDPReset(vdp);
+
+    memset(vdp->frames.pixels, 0, sizeof(vdp->frames.pixels));
+    memset(vdp->frames.frameNumbers, 0, sizeof(vdp->frames.frameNumbers));
+    vdp->frames.back = 0;
+    vdp->frames.front = 1;
+    vdp->frames.published = 0;
+    tmsAtomicInit(&vdp->frames.shared, 2);
+
+    tmsWatchSetInit(&vdp->watches);
+
     return vdp;
 }
 
@@ -103,6 +178,24 @@ void VDPReset(VideoDisplayProcessorRef vdp) {
     vdp->registerValue = kVDPUnsetAddr;
     memset(vdp->registers, 0, sizeof(vdp->registers));
     memset(&vdp->interruptHandler, 0, sizeof(vdp->interruptHandler));
+    vdp->sprites.valid = false;
+    tmsColorPairsInit(&vdp->colorPairs, VDPGetBackgroundColor(vdp));
+}
+
+/// updates state derived from register `registerIdx` after it is written
+static inline void VDPRegisterWritten(VideoDisplayProcessorRef vdp, uint8_t registerIdx) {
+    vdp->sprites.valid = false;
+
+    if (registerIdx == 0x7 && vdp->colorPairs.backdrop != VDPGetBackgroundColor(vdp)) {
+        tmsColorPairsInit(&vdp->colorPairs, VDPGetBackgroundColor(vdp));
+    }
+}
+
+/// drops the sprite snapshot if `addr` is within the sprite attribute table
+static inline void VDPVramWritten(VideoDisplayProcessorRef vdp, uint16_t addr) {
+    if ((uint16_t)(addr - VDPGetVramSpriteAttributesAddress(vdp)) < kVDPSpriteAttrsSize) {
+        vdp->sprites.valid = false;
+    }
 }
 
 void VDPWriteToRegisterPort(VideoDisplayProcessorRef vdp, uint8_t value) {
@@ -116,6 +209,7 @@ void VDPWriteToRegisterPort(VideoDisplayProcessorRef vdp, uint8_t value) {
         if (value & kVDPRegisterWriteMask) {
             // register write
             vdp->registers[value & (kVDPRegisterCount - 1)] = vdp->registerValue & 0xFF;
+            VDPRegisterWritten(vdp, value & (kVDPRegisterCount - 1));
         } else {
             // vram address
             vdp->vramAddr = ((value & (kVDPVramWriteMask - 1)) << 8) | vdp->registerValue;
@@ -145,8 +239,14 @@ void VDPWriteToDataPort(VideoDisplayProcessorRef vdp, uint8_t value) {
         return;
     }
 
+    // record the change for any watch (before the old value is overwritten)
+    if (tmsWatchHit(&vdp->watches, vdp->vramAddr, 1)) {
+        tmsWatchWrite(&vdp->watches, vdp->vram, vdp->vramAddr, &value, 1);
+    }
+
     // write value at current vram addr
     vdp->vram[vdp->vramAddr] = value;
+    VDPVramWritten(vdp, vdp->vramAddr);
 
     // fill read-ahead buffer with the passed in value
     vdp->readAheadBuffer = value;
@@ -176,9 +276,45 @@ uint8_t VDPReadFromDataPort(VideoDisplayProcessorRef vdp) {
 
 #pragma mark Video Display
 
-void VDPGetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]) {
-    if (!vdp) {
-        return;
+/// calls the interrupt handler, if there is one and interrupts are enabled
+static void VDPDeliverInterrupt(VideoDisplayProcessorRef vdp) {
+    if (vdp->interruptHandler.handler && (vdp->registers[1] & kVDPIRQEnMask)) {
+        (*vdp->interruptHandler.handler)(vdp->interruptHandler.observer);
+    }
+}
+
+/// calls the handlers of watches with changes due at a scanline (or frame, when `frame`) boundary
+static void VDPReportWatches(VideoDisplayProcessorRef vdp, bool frame) {
+    const uint8_t due = tmsWatchDue(&vdp->watches, frame);
+
+    for (uint8_t watchIdx = 0; watchIdx < kVDPMaxWatches; ++watchIdx) {
+        // handlers may add or remove watches
+        const uint8_t bit = 1 << watchIdx;
+        if (!(due & bit) || !(vdp->watches.pending & bit)) {
+            continue;
+        }
+
+        tmsWatch *watch = &vdp->watches.watches[watchIdx];
+
+        VDPVramRange ranges[kVDPWatchMaxRanges];
+        const uint8_t count = watch->numRanges;
+        for (uint8_t rangeIdx = 0; rangeIdx < count; ++rangeIdx) {
+            ranges[rangeIdx].address = watch->ranges[rangeIdx].addr;
+            ranges[rangeIdx].size = watch->ranges[rangeIdx].numBytes;
+        }
+
+        watch->numRanges = 0;
+        vdp->watches.pending &= ~bit;
+
+        (*vdp->watchHandlers[watchIdx].handler)(vdp->watchHandlers[watchIdx].observer, ranges, count);
+    }
+}
+
+/// renders a scanline. `deliverInterrupt` is false when the caller calls the interrupt handler itself
+static void VDPRenderScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX], bool deliverInterrupt) {
+    // changes made before this scanline
+    if (vdp->watches.pending) {
+        VDPReportWatches(vdp, rowIdx == 0);
     }
 
     if (!(vdp->registers[1] & kVDPDisplayEnMask)) {
@@ -198,9 +334,11 @@ void VDPGetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelB
             break;
 
         case kVDPGraphicsMode2:
+            GraphicsMode2GetScanline(vdp, rowIdx, pixelBuffer);
             break;
 
         case kVDPGraphicsModeMultiColor:
+            MultiColorGetScanline(vdp, rowIdx, pixelBuffer);
             break;
 
         case kVDPGraphicsModeText:
@@ -215,12 +353,62 @@ void VDPGetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelB
     if (rowIdx == kVDPSizeY - 1) {
         vdp->status |= kVDPStatusIRQMask;
 
-        if (vdp->interruptHandler.handler && (vdp->registers[1] & kVDPIRQEnMask)) {
-            (*vdp->interruptHandler.handler)(vdp->interruptHandler.observer);
+        if (deliverInterrupt) {
+            VDPDeliverInterrupt(vdp);
         }
     }
 }
 
+void VDPGetScanline(VideoDisplayProcessorRef vdp, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]) {
+    if (!vdp) {
+        return;
+    }
+
+    VDPRenderScanline(vdp, rowIdx, pixelBuffer, true);
+}
+
+void VDPRenderFrame(VideoDisplayProcessorRef vdp) {
+    if (!vdp) {
+        return;
+    }
+
+    FrameBuffers *frames = &vdp->frames;
+
+    for (uint8_t rowIdx = 0; rowIdx < kVDPSizeY; ++rowIdx) {
+        VDPRenderScanline(vdp, rowIdx, frames->pixels[frames->back][rowIdx], false);
+    }
+
+    frames->frameNumbers[frames->back] = ++frames->published;
+
+    // whatever was in the shared slot (seen or not) becomes the new back buffer
+    frames->back = tmsAtomicExchange(&frames->shared, frames->back | kVDPFrameSlotFresh) & kVDPFrameSlotIndex;
+
+    // the display thread can now pick the frame up, so it's safe to signal vsync
+    // (as with `VDPGetScanline`, only when the last line was rendered with the display enabled)
+    if (vdp->registers[1] & kVDPDisplayEnMask) {
+        VDPDeliverInterrupt(vdp);
+    }
+}
+
+const uint8_t *VDPAcquireFrame(VideoDisplayProcessorRef vdp, uint64_t *frameNumber) {
+    if (!vdp) {
+        return NULL;
+    }
+
+    FrameBuffers *frames = &vdp->frames;
+
+    // only `VDPRenderFrame` sets `kVDPFrameSlotFresh`, so once seen it stays set until the exchange below
+    if (tmsAtomicLoad(&frames->shared) & kVDPFrameSlotFresh) {
+        frames->front = tmsAtomicExchange(&frames->shared, frames->front) & kVDPFrameSlotIndex;
+    }
+
+    if (frameNumber) {
+        *frameNumber = frames->frameNumbers[frames->front];
+    }
+
+    return &frames->pixels[frames->front][0][0];
+}
+
 void VDPSetInterruptHandler(VideoDisplayProcessorRef vdp, void *observer, void (*handler)(void *)) {
     vdp->interruptHandler.observer = observer;
     vdp->interruptHandler.handler = handler;
@@ -242,6 +430,7 @@ void VDPSetRegister(VideoDisplayProcessorRef vdp, uint8_t registerIdx, uint8_t v
     }
 
     vdp->registers[registerIdx & (kVDPRegisterCount - 1)] = value;
+    VDPRegisterWritten(vdp, registerIdx & (kVDPRegisterCount - 1));
 }
 
 uint8_t VDPGetStatus(VideoDisplayProcessorRef vdp) {
@@ -272,6 +461,19 @@ void VDPGetVramContents(VideoDisplayProcessorRef vdp, uint8_t vramBuffer[kVDPVra
     VDPGetVramBlock(vdp, 0x00, vramBuffer, kVDPVramSize);
 }
 
+VDPVramView VDPGetVramView(VideoDisplayProcessorRef vdp) {
+    VDPVramView view = { NULL, 0 };
+
+    if (!vdp) {
+        return view;
+    }
+
+    view.bytes = vdp->vram;
+    view.mask = kVDPVramMask;
+
+    return view;
+}
+
 uint8_t VDPGetVram(VideoDisplayProcessorRef vdp, uint16_t addr) {
     if (!vdp) {
         return 0;
@@ -285,7 +487,42 @@ void VDPSetVram(VideoDisplayProcessorRef vdp, uint16_t addr, uint8_t value) {
         return;
     }
 
+    if (tmsWatchHit(&vdp->watches, addr & kVDPVramMask, 1)) {
+        tmsWatchWrite(&vdp->watches, vdp->vram, addr & kVDPVramMask, &value, 1);
+    }
+
     vdp->vram[addr & kVDPVramMask] = value;
+    VDPVramWritten(vdp, addr & kVDPVramMask);
+}
+
+int VDPAddWatch(VideoDisplayProcessorRef vdp, uint16_t addr, uint16_t size, uint8_t flags, void *observer, VDPWatchHandler handler) {
+    if (!vdp || !handler) {
+        return -1;
+    }
+
+    const int watch = tmsWatchAdd(&vdp->watches, addr, size, (flags & kVDPWatchLine) ? TMS_WATCH_LINE : TMS_WATCH_FRAME);
+    if (watch >= 0) {
+        vdp->watchHandlers[watch].observer = observer;
+        vdp->watchHandlers[watch].handler = handler;
+    }
+
+    return watch;
+}
+
+void VDPRemoveWatch(VideoDisplayProcessorRef vdp, int watch) {
+    if (!vdp) {
+        return;
+    }
+
+    tmsWatchRemove(&vdp->watches, watch);
+}
+
+void VDPFlushWatches(VideoDisplayProcessorRef vdp) {
+    if (!vdp || !vdp->watches.pending) {
+        return;
+    }
+
+    VDPReportWatches(vdp, true);
 }
 
 uint16_t VDPGetVramAddress(VideoDisplayProcessorRef vdp) {
@@ -304,6 +541,10 @@ void VDPSetVramAddress(VideoDisplayProcessorRef vdp, uint16_t addr) {
     vdp->vramAddr = addr;
 }
 
+SpritesFrame *VDPGetSpritesFrame(VideoDisplayProcessorRef vdp) {
+    return &vdp->sprites;
+}
+
 VDPGraphicsMode VDPGetGraphicsMode(VideoDisplayProcessorRef vdp) {
     return ((vdp->registers[1] & 0x18) >> 2) | ((vdp->registers[0] & 0x02) >> 1);
 }
@@ -323,8 +564,10 @@ uint16_t VDPGetVramColorTableAddress(VideoDisplayProcessorRef vdp) {
         return kVDPUnsetAddr;
     }
 
-    // TODO: does this differ in gfx mode II?
-    return (vdp->registers[3] << 6) & kVDPVramMask;
+    // in graphics mode II only the top bit selects the table (0x0000 or 0x2000)
+    const uint8_t mask = VDPGetGraphicsMode(vdp) == kVDPGraphicsMode2 ? kVDPMode2ColorTableMask : 0xFF;
+
+    return ((vdp->registers[3] & mask) << 6) & kVDPVramMask;
 }
 
 uint16_t VDPGetVramPatternTableAddress(VideoDisplayProcessorRef vdp) {
@@ -332,7 +575,10 @@ uint16_t VDPGetVramPatternTableAddress(VideoDisplayProcessorRef vdp) {
         return kVDPUnsetAddr;
     }
 
-    return (vdp->registers[4] << 11) & kVDPVramMask;
+    // in graphics mode II only the top bit selects the table (0x0000 or 0x2000)
+    const uint8_t mask = VDPGetGraphicsMode(vdp) == kVDPGraphicsMode2 ? kVDPMode2PatternTableMask : 0xFF;
+
+    return ((vdp->registers[4] & mask) << 11) & kVDPVramMask;
 }
 
 uint16_t VDPGetVramSpriteAttributesAddress(VideoDisplayProcessorRef vdp) {
@@ -351,6 +597,15 @@ uint16_t VDPGetVramSpriteNamesAddress(VideoDisplayProcessorRef vdp) {
     return (vdp->registers[6] << 11) & kVDPVramMask;
 }
 
+bool VDPGraphicsMode2MasksValid(VideoDisplayProcessorRef vdp) {
+    if (!vdp) {
+        return false;
+    }
+
+    // the remaining address bits act as masks on the pattern index, and must all be set
+    return (vdp->registers[3] & 0x7F) == 0x7F && (vdp->registers[4] & 0x03) == 0x03;
+}
+
 VDPColor VDPGetBackgroundColor(VideoDisplayProcessorRef vdp) {
     return VDPColorBackground(vdp->registers[0x7]);
 }
@@ -358,3 +613,7 @@ VDPColor VDPGetBackgroundColor(VideoDisplayProcessorRef vdp) {
 VDPColor VDPGetForegroundColor(VideoDisplayProcessorRef vdp) {
     return VDPColorForeground(vdp->registers[0x7]);
 }
+
+const struct tmsColorPairs *VDPGetColorPairs(VideoDisplayProcessorRef vdp) {
+    return &vdp->colorPairs;
+}
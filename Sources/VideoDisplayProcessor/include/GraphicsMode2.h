@@ -0,0 +1,13 @@
+//
+//  GraphicsMode2.h
+//
+//
+
+#ifndef GraphicsMode2_h
+#define GraphicsMode2_h
+
+#include "VideoDisplayProcessor.h"
+
+extern void GraphicsMode2GetScanline(VideoDisplayProcessorRef ref, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]);
+
+#endif /* GraphicsMode2_h */
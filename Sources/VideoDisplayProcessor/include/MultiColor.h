@@ -0,0 +1,13 @@
+//
+//  MultiColor.h
+//
+//
+
+#ifndef MultiColor_h
+#define MultiColor_h
+
+#include "VideoDisplayProcessor.h"
+
+extern void MultiColorGetScanline(VideoDisplayProcessorRef ref, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]);
+
+#endif /* MultiColor_h */
@@ -0,0 +1,48 @@
+//
+//  Output.h
+//
+//
+
+#ifndef Output_h
+#define Output_h
+
+#include <stdbool.h>
+
+#include "VideoDisplayProcessor.h"
+
+/// largest integer scale factor for the output functions
+#define kVDPOutputMaxScale      4
+
+/// pixel formats for the output functions, named in memory byte order
+typedef enum {
+    /// bytes R, G, B, A (`MTLPixelFormatRGBA8Unorm`)
+    kVDPPixelFormatRGBA8888,
+
+    /// bytes B, G, R, A (`MTLPixelFormatBGRA8Unorm`, `kCVPixelFormatType_32BGRA`)
+    kVDPPixelFormatBGRA8888,
+
+    /// bytes A, R, G, B (`kCVPixelFormatType_32ARGB`)
+    kVDPPixelFormatARGB8888,
+
+    /// native endian `uint16_t`, red in the top 5 bits (`MTLPixelFormatB5G6R5Unorm`)
+    kVDPPixelFormatRGB565,
+
+    /// bytes R, G, B (`kCVPixelFormatType_24RGB`)
+    kVDPPixelFormatRGB888
+} VDPPixelFormat;
+
+/// converts `numPixels` `VDPColor` values to `scale` rows of `numPixels * scale` pixels of `format`
+/// at `surface`, `pitch` bytes apart, using `VDPColorPalette`. eg. straight into a locked texture or pixel buffer
+/// returns false (and writes nothing) if `format` or `scale` is out of range
+extern bool VDPConvertPixels(const uint8_t *pixels, size_t numPixels, VDPPixelFormat format, uint8_t scale,
+                             void *surface, size_t pitch);
+
+/// `VDPGetScanline`, converted straight into `surface` as for `VDPConvertPixels`
+extern bool VDPGetScanlineInFormat(VideoDisplayProcessorRef ref, uint8_t rowIdx, VDPPixelFormat format, uint8_t scale,
+                                   void *surface, size_t pitch);
+
+/// converts a frame from `VDPAcquireFrame` into `surface`: `kVDPSizeY * scale` rows of `kVDPSizeX * scale` pixels,
+/// `pitch` bytes apart. safe to call from the display thread
+extern bool VDPConvertFrame(const uint8_t *frame, VDPPixelFormat format, uint8_t scale, void *surface, size_t pitch);
+
+#endif /* Output_h */
@@ -0,0 +1,46 @@
+//
+//  PortQueue.h
+//
+//
+
+#ifndef PortQueue_h
+#define PortQueue_h
+
+#include "VideoDisplayProcessor.h"
+
+/// single producer / single consumer queue of port operations, so the cpu emulation (producer)
+/// and the VDP (consumer) can run on separate threads
+/// the cpu thread calls the `VDPPortQueue*` port functions instead of `VDPWriteToRegisterPort` etc.
+/// the VDP thread applies them in order with `VDPPortQueueDrain` before each `VDPGetScanline`,
+/// and is the only thread to call any other `VDP*` function on the VDP
+typedef struct __VDPPortQueue *VDPPortQueueRef;
+
+/// creates a queue of (at least) `capacity` operations for `vdp`. returns `NULL` if `vdp` is `NULL` or `capacity` is 0
+extern VDPPortQueueRef VDPPortQueueCreate(VideoDisplayProcessorRef vdp, size_t capacity);
+
+/// destroys a queue (not the VDP). neither thread may be using it
+extern void VDPPortQueueDestroy(VDPPortQueueRef queue);
+
+/// queues `VDPWriteToRegisterPort`. cpu thread only
+/// Note: if the queue is full, this waits for the VDP thread to drain it
+extern void VDPPortQueueWriteToRegisterPort(VDPPortQueueRef queue, uint8_t value);
+
+/// queues `VDPWriteToDataPort`. cpu thread only
+/// Note: if the queue is full, this waits for the VDP thread to drain it
+extern void VDPPortQueueWriteToDataPort(VDPPortQueueRef queue, uint8_t value);
+
+/// `VDPReadFromRegisterPort` through the queue. cpu thread only
+/// this is a synchronization point: the read is queued behind every earlier write, performed by the VDP thread's
+/// next `VDPPortQueueDrain` and waited for, so the status is as of the scanline being drained for
+extern uint8_t VDPPortQueueReadFromRegisterPort(VDPPortQueueRef queue);
+
+/// `VDPReadFromDataPort` through the queue. cpu thread only
+/// a synchronization point, as for `VDPPortQueueReadFromRegisterPort`. since it's ordered with the writes,
+/// the read-ahead buffer and address increment behave exactly as they would with direct port access
+extern uint8_t VDPPortQueueReadFromDataPort(VDPPortQueueRef queue);
+
+/// applies every queued operation in order, returning how many were applied. VDP thread only
+/// Note: the cpu thread waits on this while reading (or when the queue is full), so keep draining while otherwise idle
+extern size_t VDPPortQueueDrain(VDPPortQueueRef queue);
+
+#endif /* PortQueue_h */
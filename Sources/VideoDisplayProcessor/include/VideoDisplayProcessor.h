@@ -9,6 +9,8 @@
 #define VideoDisplayProcessor_h
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /// sizes in pixels
 #define kVDPSizeX               256
@@ -22,6 +24,30 @@
 
 typedef struct __VideoDisplayProcessor *VideoDisplayProcessorRef;
 
+/// read-only, zero-copy view of vram
+typedef struct {
+    /// all `kVDPVramSize` bytes of vram
+    const uint8_t *bytes;
+
+    /// mask any address with this to keep it within `bytes` (`kVDPVramSize - 1`)
+    uint16_t mask;
+} VDPVramView;
+
+/// a changed range of vram, see `VDPAddWatch`
+typedef struct {
+    uint16_t address;
+    uint16_t size;
+} VDPVramRange;
+
+/// receives the changed ranges of a watch, see `VDPAddWatch`
+typedef void (*VDPWatchHandler)(void *observer, const VDPVramRange *ranges, size_t count);
+
+/// vram watches (`VDPAddWatch`)
+#define kVDPMaxWatches          8
+#define kVDPWatchMaxRanges      8   // changed ranges reported per call
+#define kVDPWatchFrame          0x00
+#define kVDPWatchLine           0x01
+
 /// Color palette indices
 typedef enum {
     kVDPColorTransparent = 0,
@@ -63,6 +89,17 @@ extern VideoDisplayProcessorRef VDPCreate();
 /// destroys an existing VDP instance
 extern void VDPDestroy(VideoDisplayProcessorRef ref);
 
+/// number of bytes required by `VDPInit`
+extern size_t VDPSizeOf(void);
+
+/// alignment required by `VDPInit` (never more than `malloc` provides)
+extern size_t VDPAlignOf(void);
+
+/// creates a new VDP instance in caller provided memory of at least `VDPSizeOf()` bytes, aligned to `VDPAlignOf()`
+/// returns `NULL` if `mem` is `NULL` or misaligned
+/// Note: don't call `VDPDestroy` on the result, simply release the memory when done
+extern VideoDisplayProcessorRef VDPInit(void *mem);
+
 /// Describes hardware access to the VDP
 #pragma mark Hardware API
 
@@ -92,6 +129,16 @@ extern uint8_t VDPReadFromDataPort(VideoDisplayProcessorRef ref);
 /// `pixels` is filled out with `VDPColor` values
 extern void VDPGetScanline(VideoDisplayProcessorRef ref, uint8_t rowIdx, uint8_t pixelBuffer[kVDPSizeX]);
 
+/// renders every scanline into the back buffer of a triple buffer, then publishes it as the latest frame
+/// unlike `VDPGetScanline`, the interrupt handler is called _after_ the frame is published, so it can signal a presenter directly
+extern void VDPRenderFrame(VideoDisplayProcessorRef ref);
+
+/// returns the latest frame published by `VDPRenderFrame`: `kVDPSizeY` rows of `kVDPSizeX` `VDPColor` values
+/// may be called from one other thread (eg. the display thread) while `VDPRenderFrame` runs. no locks are taken and nothing is copied
+/// the frame stays valid and unchanged until the next `VDPAcquireFrame`. returns the same frame again if nothing new was published
+/// `frameNumber` (optional) is set to its number (1 for the first frame, all zeros and 0 before it)
+extern const uint8_t *VDPAcquireFrame(VideoDisplayProcessorRef ref, uint64_t *frameNumber);
+
 /// called after last scanline is requested if interrupts are enabled
 /// Note: this is called _before_ returning the last scanline, so if you want to mimic the hardware,
 /// you will need to setup your own async mechanism to order these two events
@@ -109,12 +156,29 @@ extern void VDPSetRegister(VideoDisplayProcessorRef ref, uint8_t registerIdx, ui
 /// copies raw vram content into the provided buffer
 extern void VDPGetVramContents(VideoDisplayProcessorRef ref, uint8_t vramBuffer[kVDPVramSize]);
 
+/// returns a read-only view of vram, without copying it
+/// the view stays valid (and reflects every write) for the lifetime of the VDP. all zeros for a `NULL` ref
+extern VDPVramView VDPGetVramView(VideoDisplayProcessorRef ref);
+
 /// gets vram contents at `addr`
 extern uint8_t VDPGetVram(VideoDisplayProcessorRef ref, uint16_t addr);
 
 /// sets the contents of vram at `addr` to `value`
 extern void VDPSetVram(VideoDisplayProcessorRef ref, uint16_t addr, uint8_t value);
 
+/// watches `size` bytes of vram from `addr` (not wrapping) for changes through `VDPWriteToDataPort` and `VDPSetVram`
+/// writes that leave a byte unchanged are ignored. changes are coalesced into at most `kVDPWatchMaxRanges` ranges (merged ranges may cover
+/// unchanged bytes) and handed to `handler` at the next frame (scanline 0, including `VDPRenderFrame`) or, with `kVDPWatchLine`, the next scanline
+/// writes cost a single test unless they're near a watch, so tools don't need to poll and diff vram
+/// returns the watch number, or -1 if all `kVDPMaxWatches` are in use. watches aren't touched by `VDPReset`
+extern int VDPAddWatch(VideoDisplayProcessorRef ref, uint16_t addr, uint16_t size, uint8_t flags, void *observer, VDPWatchHandler handler);
+
+/// removes a watch added with `VDPAddWatch`. unreported changes are dropped
+extern void VDPRemoveWatch(VideoDisplayProcessorRef ref, int watch);
+
+/// reports all unreported changes now (eg. when a debugger pauses mid-frame)
+extern void VDPFlushWatches(VideoDisplayProcessorRef ref);
+
 /// gets the current vram address
 extern uint16_t VDPGetVramAddress(VideoDisplayProcessorRef ref);
 
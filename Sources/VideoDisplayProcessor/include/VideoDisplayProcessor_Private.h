@@ -10,6 +10,8 @@
 
 #include "VideoDisplayProcessor.h"
 
+#include <stdbool.h>
+
 #define kVDPGraphicsTileX         32
 #define kVDPGraphicsTileY         24
 #define kVDPGraphicsPatternWidth   8
@@ -21,6 +23,15 @@
 #define VDPColorBackground(x)   (x & 0x0F)
 #define VDPColorForeground(x)   ((x >> 4) & 0x0F)
 
+// graphics mode II table address bits (the rest of registers 3 and 4 are masks)
+#define kVDPMode2ColorTableMask   0x80
+#define kVDPMode2PatternTableMask 0x04
+
+// status register bits
+#define kVDPStatusIRQMask       0b10000000
+#define kVDPStatus5thSprMask    0b01000000
+#define kVDPStatusSprCoMask     0b00100000
+
 #define kVDPSpriteSizeLargeMask 0x02
 #define kVDPSpriteMagMask       0x01
 
@@ -52,6 +63,24 @@ extern uint16_t VDPGetVramSpriteAttributesAddress(VideoDisplayProcessorRef vdp);
 /// gets the address for the start of the sprite names table in VRAM
 extern uint16_t VDPGetVramSpriteNamesAddress(VideoDisplayProcessorRef vdp);
 
+/// reads a byte through a `VDPGetVramView` view. the renderers fetch the view once per scanline
+/// and read through it directly (or hand `view.bytes` to the shared kernels), rather than calling `VDPGetVram` per byte
+/// the kernels (`vrEmuTms9918Kernels.h`, shared with the vrEmuTms9918 core) index `view.bytes` without masking:
+/// the `VDPGetVram*Address` table addresses are masked to vram, and every table a mode reads fits below the end of it
+static inline uint8_t VDPVramViewRead(VDPVramView view, uint16_t addr) {
+    return view.bytes[addr & view.mask];
+}
+
+struct tmsColorPairs;
+
+/// every color table byte resolved against the background color (a transparent color shows the background),
+/// kept up to date on register writes so the renderers don't resolve colors per tile
+extern const struct tmsColorPairs *VDPGetColorPairs(VideoDisplayProcessorRef vdp);
+
+/// whether the graphics mode II table address masks (low bits of registers 3 and 4) are all set
+/// when they aren't, the screen thirds share one pattern/color table and only the low 3 bits of each name are used
+extern bool VDPGraphicsMode2MasksValid(VideoDisplayProcessorRef vdp);
+
 /// copies contents of VRAM as a block starting at given address up to given size
 /// this does no safety checks!
 extern void VDPGetVramBlock(VideoDisplayProcessorRef vdp, uint16_t address, uint8_t *const buffer, uint16_t size);
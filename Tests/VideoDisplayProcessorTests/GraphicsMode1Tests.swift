@@ -117,4 +117,21 @@ final class GraphicsMode1Tests: XCTestCase {
         VDPGetScanline(vdp, 0, scanline.baseAddress)
         XCTAssert(Array(scanline) == GraphicsMode1Tests.line0)
     }
+
+    func testTransparentFollowsBackground() {
+        // given: the first group of patterns is transparent on transparent
+        VDPSetVramAddress(vdp, 0x2000)
+        VDPWriteToDataPort(vdp, UInt8(kVDPColorTransparent.rawValue) << 4 | UInt8(kVDPColorTransparent.rawValue))
+
+        let scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+        defer { scanline.deallocate() }
+
+        // when / then: each background change shows through the transparent tiles
+        for background in [kVDPColorDarkBlue, kVDPColorMagenta] {
+            VDPSetRegister(vdp, 7, UInt8(background.rawValue))
+            VDPGetScanline(vdp, 0, scanline.baseAddress)
+            XCTAssert(Array(scanline[0..<8]) == Array(repeating: UInt8(background.rawValue), count: 8))
+            XCTAssert(Array(scanline[8..<16]) == Array(repeating: UInt8(background.rawValue), count: 8))
+        }
+    }
 }
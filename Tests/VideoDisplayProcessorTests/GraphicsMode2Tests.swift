@@ -0,0 +1,92 @@
+//
+//  GraphicsMode2Tests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class GraphicsMode2Tests: XCTestCase {
+    var vdp: VideoDisplayProcessorRef!
+
+    // each third of the screen gets its own pattern and color for every tile's first row
+    static let thirdPatterns: [UInt8] = [0xF0, 0x0F, 0xCC]
+    static let thirdColors: [UInt8] = [
+        UInt8(kVDPColorWhite.rawValue) << 4 | UInt8(kVDPColorBlack.rawValue),
+        UInt8(kVDPColorDarkRed.rawValue) << 4 | UInt8(kVDPColorGray.rawValue),
+        UInt8(kVDPColorLightGreen.rawValue) << 4 | UInt8(kVDPColorTransparent.rawValue)
+    ]
+
+    static func line(pattern: UInt8, color: UInt8) -> [UInt8] {
+        let tile: [UInt8] = (0..<8).map { bit in
+            let c = (pattern << bit) & 0x80 != 0 ? color >> 4 : color & 0x0F
+            return c == UInt8(kVDPColorTransparent.rawValue) ? UInt8(kVDPColorDarkBlue.rawValue) : c // backdrop
+        }
+        return Array([[UInt8]](repeating: tile, count: 32).joined())
+    }
+
+    override func setUp() {
+        vdp = VDPCreate()
+
+        // put VDP in graphics mode 2
+        VDPSetRegister(vdp, 0, 0x02);
+        VDPSetRegister(vdp, 1, 0xC0);
+
+        // setup table addresses
+        VDPSetRegister(vdp, 2, 0x0E); // 0x3800
+        VDPSetRegister(vdp, 3, 0xFF); // 0x2000 (all mask bits set)
+        VDPSetRegister(vdp, 4, 0x03); // 0x0000 (all mask bits set)
+        VDPSetRegister(vdp, 5, 0x76); // 0x3B00
+        VDPSetRegister(vdp, 6, 0x03); // 0x1800
+        VDPSetRegister(vdp, 7, UInt8(kVDPColorDarkBlue.rawValue));
+
+        // setup vram: nametable (the same names in every third), patterns, colors, no sprites
+        VDPSetVramAddress(vdp, 0x3800)
+        for _ in 0..<24 {
+            for name in 0..<32 {
+                VDPWriteToDataPort(vdp, UInt8(name))
+            }
+        }
+
+        for third in 0..<3 {
+            for name in 0..<256 {
+                VDPSetVram(vdp, UInt16(third * 0x800 + name * 8), GraphicsMode2Tests.thirdPatterns[third])
+                VDPSetVram(vdp, UInt16(0x2000 + third * 0x800 + name * 8), GraphicsMode2Tests.thirdColors[third])
+            }
+        }
+
+        VDPSetVram(vdp, 0x3B00, 0xD0)
+    }
+
+    override func tearDown() {
+        VDPDestroy(vdp)
+    }
+
+    func testThirds() {
+        // given is taken care of in setup
+        // when
+        let scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+
+        // then: the first line of each third uses that third's tables
+        for third in 0..<3 {
+            VDPGetScanline(vdp, UInt8(third * 64), scanline.baseAddress)
+            XCTAssert(Array(scanline) == GraphicsMode2Tests.line(pattern: GraphicsMode2Tests.thirdPatterns[third],
+                                                                 color: GraphicsMode2Tests.thirdColors[third]))
+        }
+    }
+
+    func testInvalidMasks() {
+        // given: pattern table mask bits cleared
+        VDPSetRegister(vdp, 4, 0x00);
+
+        // when
+        let scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+
+        // then: every third uses the first third's tables
+        for third in 0..<3 {
+            VDPGetScanline(vdp, UInt8(third * 64), scanline.baseAddress)
+            XCTAssert(Array(scanline) == GraphicsMode2Tests.line(pattern: GraphicsMode2Tests.thirdPatterns[0],
+                                                                 color: GraphicsMode2Tests.thirdColors[0]))
+        }
+    }
+}
@@ -0,0 +1,65 @@
+//
+//  MultiColorTests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class MultiColorTests: XCTestCase {
+    var vdp: VideoDisplayProcessorRef!
+
+    // 8 color pairs (left << 4 | right). name row n uses bytes 2 * (n % 4) and 2 * (n % 4) + 1
+    static let patternData: [UInt8] = [0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0]
+
+    override func setUp() {
+        vdp = VDPCreate()
+
+        // put VDP in multicolor mode
+        VDPSetRegister(vdp, 0, 0x00);
+        VDPSetRegister(vdp, 1, 0xC8);
+
+        // setup table addresses
+        VDPSetRegister(vdp, 2, 0x0E); // 0x3800
+        VDPSetRegister(vdp, 4, 0x00); // 0x0000
+        VDPSetRegister(vdp, 5, 0x76); // 0x3B00
+        VDPSetRegister(vdp, 6, 0x03); // 0x1800
+        VDPSetRegister(vdp, 7, UInt8(kVDPColorDarkBlue.rawValue));
+
+        // setup vram: nametable is all pattern 0, no sprites
+        VDPSetVramAddress(vdp, 0x3800)
+        for _ in 0..<(32 * 24) {
+            VDPWriteToDataPort(vdp, 0)
+        }
+
+        VDPSetVramAddress(vdp, 0x0000)
+        for pattern in MultiColorTests.patternData {
+            VDPWriteToDataPort(vdp, pattern)
+        }
+
+        VDPSetVram(vdp, 0x3B00, 0xD0)
+    }
+
+    override func tearDown() {
+        VDPDestroy(vdp)
+    }
+
+    func testBlocks() {
+        // given is taken care of in setup
+        // when
+        let scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+
+        // then: each byte is 4 lines tall, and each name row moves on 2 bytes
+        for y in 0..<Int(kVDPSizeY) {
+            var color = MultiColorTests.patternData[((y / 8) % 4) * 2 + (y / 4) % 2]
+            if color & 0x0F == 0 {
+                color |= UInt8(kVDPColorDarkBlue.rawValue) // transparent shows the backdrop
+            }
+
+            let tile = [UInt8](repeating: color >> 4, count: 4) + [UInt8](repeating: color & 0x0F, count: 4)
+
+            VDPGetScanline(vdp, UInt8(y), scanline.baseAddress)
+            XCTAssert(Array(scanline) == Array([[UInt8]](repeating: tile, count: 32).joined()))
+        }
+    }
+}
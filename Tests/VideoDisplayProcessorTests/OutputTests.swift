@@ -0,0 +1,90 @@
+//
+//  OutputTests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class OutputTests: XCTestCase {
+    func testConvertPixels() {
+        // given
+        let pixels: [UInt8] = [
+            UInt8(kVDPColorBlack.rawValue), UInt8(kVDPColorWhite.rawValue),
+            UInt8(kVDPColorDarkRed.rawValue), UInt8(kVDPColorTransparent.rawValue)
+        ]
+        var surface = [UInt8](repeating: 0xEE, count: pixels.count * 4)
+
+        // when
+        XCTAssert(VDPConvertPixels(pixels, pixels.count, kVDPPixelFormatBGRA8888, 1, &surface, surface.count))
+
+        // then
+        XCTAssert(surface == [
+            0x00, 0x00, 0x00, 0xff,
+            0xff, 0xff, 0xff, 0xff,
+            0x4d, 0x52, 0xd3, 0xff,
+            0x00, 0x00, 0x00, 0x00
+        ])
+    }
+
+    func testScaling() {
+        // given: 20 pixels (more than one vector) at 3x, with padding at the end of each row
+        let pixels: [UInt8] = (0..<20).map { UInt8($0 & 0x0F) }
+        let pitch = pixels.count * 3 * 3 + 5
+        var surface = [UInt8](repeating: 0xEE, count: pitch * 3)
+
+        // when
+        XCTAssert(VDPConvertPixels(pixels, pixels.count, kVDPPixelFormatRGB888, 3, &surface, pitch))
+
+        // then
+        for row in 0..<3 {
+            for x in 0..<(pixels.count * 3) {
+                let color = VDPColorPalette[Int(pixels[x / 3])]
+                let offset = row * pitch + x * 3
+                XCTAssert(surface[offset + 0] == UInt8((color >> 24) & 0xFF))
+                XCTAssert(surface[offset + 1] == UInt8((color >> 16) & 0xFF))
+                XCTAssert(surface[offset + 2] == UInt8((color >> 8) & 0xFF))
+            }
+            XCTAssert(surface[(row * pitch + pixels.count * 9)..<((row + 1) * pitch)].allSatisfy { $0 == 0xEE })
+        }
+    }
+
+    func testRGB565() {
+        // given
+        let pixels: [UInt8] = [UInt8(kVDPColorWhite.rawValue), UInt8(kVDPColorMediumGreen.rawValue)]
+        var surface = [UInt16](repeating: 0, count: 2)
+
+        // when
+        XCTAssert(VDPConvertPixels(pixels, pixels.count, kVDPPixelFormatRGB565, 1, &surface, 4))
+
+        // then: 0x21c942
+        XCTAssert(surface == [0xFFFF, (0x21 >> 3) << 11 | (0xc9 >> 2) << 5 | (0x42 >> 3)])
+    }
+
+    func testInvalidArguments() {
+        var surface = [UInt8](repeating: 0, count: 64)
+        let pixels: [UInt8] = [0, 1]
+
+        XCTAssertFalse(VDPConvertPixels(pixels, 2, kVDPPixelFormatRGBA8888, 0, &surface, 64))
+        XCTAssertFalse(VDPConvertPixels(pixels, 2, kVDPPixelFormatRGBA8888, UInt8(kVDPOutputMaxScale + 1), &surface, 64))
+        XCTAssertFalse(VDPConvertPixels(nil, 2, kVDPPixelFormatRGBA8888, 1, &surface, 64))
+    }
+
+    func testConvertFrame() {
+        // given: a display with a white backdrop
+        let vdp = VDPCreate()
+        defer { VDPDestroy(vdp) }
+        VDPSetRegister(vdp, 1, 0x40)
+        VDPSetRegister(vdp, 7, UInt8(kVDPColorWhite.rawValue))
+        VDPRenderFrame(vdp)
+
+        let pitch = Int(kVDPSizeX) * 2 * 4
+        var surface = [UInt8](repeating: 0, count: pitch * Int(kVDPSizeY) * 2)
+
+        // when
+        XCTAssert(VDPConvertFrame(VDPAcquireFrame(vdp, nil), kVDPPixelFormatRGBA8888, 2, &surface, pitch))
+
+        // then: empty vram is transparent everywhere, so the backdrop shows through
+        XCTAssert(surface.allSatisfy { $0 == 0xFF })
+    }
+}
@@ -0,0 +1,79 @@
+//
+//  PortQueueTests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class PortQueueTests: XCTestCase {
+    var vdp: VideoDisplayProcessorRef!
+    var queue: VDPPortQueueRef!
+
+    override func setUp() {
+        vdp = VDPCreate()
+        queue = VDPPortQueueCreate(vdp, 16)
+    }
+
+    override func tearDown() {
+        VDPPortQueueDestroy(queue)
+        VDPDestroy(vdp)
+    }
+
+    func testCreate() {
+        XCTAssert(VDPPortQueueCreate(nil, 16) == nil)
+        XCTAssert(VDPPortQueueCreate(vdp, 0) == nil)
+    }
+
+    func testWritesApplyOnDrain() {
+        // given: a register write and a vram write
+        VDPPortQueueWriteToRegisterPort(queue, 0xAA)
+        VDPPortQueueWriteToRegisterPort(queue, 0x82)
+        VDPPortQueueWriteToRegisterPort(queue, 0x00)
+        VDPPortQueueWriteToRegisterPort(queue, 0x40 | 0x10)
+        VDPPortQueueWriteToDataPort(queue, 0x55)
+
+        // then: nothing happens until the VDP thread drains
+        XCTAssert(VDPGetRegister(vdp, 2) == 0)
+        XCTAssert(VDPGetVram(vdp, 0x1000) == 0)
+
+        // when
+        XCTAssert(VDPPortQueueDrain(queue) == 5)
+
+        // then
+        XCTAssert(VDPGetRegister(vdp, 2) == 0xAA)
+        XCTAssert(VDPGetVram(vdp, 0x1000) == 0x55)
+        XCTAssert(VDPPortQueueDrain(queue) == 0)
+    }
+
+    func testReadsFromAnotherThread() {
+        // given: the cpu thread writes a block, then reads it back through the read-ahead buffer
+        let block: [UInt8] = (0..<100).map { UInt8(($0 * 7) & 0xFF) }
+        var readBack: [UInt8] = []
+        let done = expectation(description: "cpu thread")
+
+        let cpu = Thread { [queue] in
+            VDPPortQueueWriteToRegisterPort(queue, 0x00)
+            VDPPortQueueWriteToRegisterPort(queue, 0x40 | 0x20)
+            for value in block {
+                VDPPortQueueWriteToDataPort(queue, value) // more than the queue holds
+            }
+
+            VDPPortQueueWriteToRegisterPort(queue, 0x00)
+            VDPPortQueueWriteToRegisterPort(queue, 0x20)
+            for _ in block {
+                readBack.append(VDPPortQueueReadFromDataPort(queue))
+            }
+            done.fulfill()
+        }
+
+        // when: this thread plays the VDP
+        cpu.start()
+        while XCTWaiter.wait(for: [done], timeout: 0) != .completed {
+            VDPPortQueueDrain(queue)
+        }
+
+        // then
+        XCTAssert(readBack == block)
+    }
+}
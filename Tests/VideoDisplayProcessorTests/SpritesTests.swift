@@ -0,0 +1,189 @@
+//
+//  SpritesTests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class SpritesTests: XCTestCase {
+    var vdp: VideoDisplayProcessorRef!
+
+    static let spriteAttrTable: UInt16 = 0x3B00
+    static let spritePatternTable: UInt16 = 0x1800
+
+    // status register bits
+    static let statusCollision: UInt8 = 0x20
+    static let status5thSprite: UInt8 = 0x40
+
+    static let backdrop = UInt8(kVDPColorDarkBlue.rawValue)
+    static let white = UInt8(kVDPColorWhite.rawValue)
+    static let red = UInt8(kVDPColorDarkRed.rawValue)
+
+    override func setUp() {
+        vdp = VDPCreate()
+
+        // put VDP in graphics mode 1, 8x8 sprites, no magnification
+        VDPSetRegister(vdp, 0, 0x00);
+        VDPSetRegister(vdp, 1, 0xC0);
+
+        // setup table addresses
+        VDPSetRegister(vdp, 2, 0x0E); // 0x3800
+        VDPSetRegister(vdp, 3, 0x80); // 0x2000
+        VDPSetRegister(vdp, 4, 0x00); // 0x0000
+        VDPSetRegister(vdp, 5, 0x76); // 0x3B00
+        VDPSetRegister(vdp, 6, 0x03); // 0x1800
+        VDPSetRegister(vdp, 7, SpritesTests.backdrop);
+
+        // fresh vram is all zeros: every tile is blank and transparent, so the screen shows the backdrop
+        // sprite pattern 0 is a solid block, pattern 1 a single pixel in the top left corner
+        for row in 0..<32 {
+            VDPSetVram(vdp, SpritesTests.spritePatternTable + UInt16(row), 0xFF)
+        }
+        VDPSetVram(vdp, SpritesTests.spritePatternTable + 32, 0x80)
+
+        VDPSetVram(vdp, SpritesTests.spriteAttrTable, 0xD0)
+    }
+
+    override func tearDown() {
+        VDPDestroy(vdp)
+    }
+
+    /// sets the attributes of sprite `idx`, terminating the table after it
+    func setSprite(_ idx: Int, y: UInt8, x: UInt8, name: UInt8, color: UInt8) {
+        let addr = SpritesTests.spriteAttrTable + UInt16(idx * 4)
+        VDPSetVram(vdp, addr, y)
+        VDPSetVram(vdp, addr + 1, x)
+        VDPSetVram(vdp, addr + 2, name)
+        VDPSetVram(vdp, addr + 3, color)
+        VDPSetVram(vdp, addr + 4, 0xD0)
+    }
+
+    /// a backdrop line with `color` from `x` for `width` pixels
+    static func line(x: Int, width: Int, color: UInt8) -> [UInt8] {
+        var line = [UInt8](repeating: backdrop, count: Int(kVDPSizeX))
+        for px in x..<min(x + width, Int(kVDPSizeX)) {
+            line[px] = color
+        }
+        return line
+    }
+
+    func scanline(_ rowIdx: UInt8) -> [UInt8] {
+        let scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+        defer { scanline.deallocate() }
+
+        VDPGetScanline(vdp, rowIdx, scanline.baseAddress)
+        return Array(scanline)
+    }
+
+    func testDrawing() {
+        // given: sprites are drawn one line below their y position
+        setSprite(0, y: 9, x: 16, name: 0, color: SpritesTests.white)
+
+        // then
+        XCTAssert(scanline(9) == SpritesTests.line(x: 0, width: 0, color: SpritesTests.white))
+        XCTAssert(scanline(10) == SpritesTests.line(x: 16, width: 8, color: SpritesTests.white))
+        XCTAssert(scanline(17) == SpritesTests.line(x: 16, width: 8, color: SpritesTests.white))
+        XCTAssert(scanline(18) == SpritesTests.line(x: 0, width: 0, color: SpritesTests.white))
+    }
+
+    func testPriority() {
+        // given: sprite 0 is in front of sprite 1
+        setSprite(0, y: 9, x: 16, name: 0, color: SpritesTests.white)
+        setSprite(1, y: 9, x: 20, name: 0, color: SpritesTests.red)
+
+        // then
+        var expected = SpritesTests.line(x: 20, width: 8, color: SpritesTests.red)
+        for px in 16..<24 {
+            expected[px] = SpritesTests.white
+        }
+        XCTAssert(scanline(10) == expected)
+    }
+
+    func testCollision() {
+        // given: two overlapping sprites, one of them transparent
+        setSprite(0, y: 9, x: 16, name: 0, color: SpritesTests.white)
+        setSprite(1, y: 9, x: 23, name: 0, color: UInt8(kVDPColorTransparent.rawValue))
+
+        // when
+        _ = scanline(0)
+        XCTAssert(VDPReadFromRegisterPort(vdp) & SpritesTests.statusCollision == 0)
+        _ = scanline(10)
+
+        // then: transparent sprites still collide, and aren't drawn
+        XCTAssert(VDPReadFromRegisterPort(vdp) & SpritesTests.statusCollision != 0)
+        XCTAssert(scanline(11) == SpritesTests.line(x: 16, width: 8, color: SpritesTests.white))
+    }
+
+    func testNoCollision() {
+        // given: two sprites side by side
+        setSprite(0, y: 9, x: 16, name: 0, color: SpritesTests.white)
+        setSprite(1, y: 9, x: 24, name: 0, color: SpritesTests.red)
+
+        // when
+        _ = scanline(0)
+        _ = scanline(10)
+
+        // then
+        XCTAssert(VDPReadFromRegisterPort(vdp) & SpritesTests.statusCollision == 0)
+    }
+
+    func testFifthSprite() {
+        // given: five sprites on the same line
+        for idx in 0..<5 {
+            setSprite(idx, y: 9, x: UInt8(idx * 16), name: 0, color: SpritesTests.white)
+        }
+
+        // when
+        _ = scanline(0)
+        let line = scanline(10)
+
+        // then: only the first four are drawn, and the fifth's index is latched in status
+        XCTAssert(line == SpritesTests.line(x: 0, width: 0, color: 0).enumerated().map { px, color in
+            px < 64 && px % 16 < 8 ? SpritesTests.white : color
+        })
+        XCTAssert(VDPReadFromRegisterPort(vdp) == SpritesTests.status5thSprite | 4)
+    }
+
+    func testMagnification() {
+        // given: a single pixel sprite, 16x16 and magnified
+        VDPSetRegister(vdp, 1, 0xC3);
+        setSprite(0, y: 9, x: 16, name: 4, color: SpritesTests.white)
+
+        // then: 16x16 sprites use 4 consecutive patterns, each pixel is doubled in both directions
+        XCTAssert(scanline(10) == SpritesTests.line(x: 16, width: 2, color: SpritesTests.white))
+        XCTAssert(scanline(11) == SpritesTests.line(x: 16, width: 2, color: SpritesTests.white))
+        XCTAssert(scanline(12) == SpritesTests.line(x: 0, width: 0, color: SpritesTests.white))
+    }
+
+    func testEarlyClock() {
+        // given: early clock shifts sprites 32 pixels to the left, clipping at the screen edge
+        setSprite(0, y: 9, x: 40, name: 0, color: SpritesTests.white | 0x80)
+        setSprite(1, y: 19, x: 28, name: 0, color: SpritesTests.white | 0x80)
+
+        // then
+        XCTAssert(scanline(10) == SpritesTests.line(x: 8, width: 8, color: SpritesTests.white))
+        XCTAssert(scanline(20) == SpritesTests.line(x: 0, width: 4, color: SpritesTests.white))
+    }
+
+    func testAttributeUpdates() {
+        // given
+        setSprite(0, y: 9, x: 16, name: 0, color: SpritesTests.white)
+        XCTAssert(scanline(10) == SpritesTests.line(x: 16, width: 8, color: SpritesTests.white))
+
+        // when: the sprite is moved through the data port mid-frame
+        VDPWriteToRegisterPort(vdp, UInt8((SpritesTests.spriteAttrTable + 1) & 0xFF))
+        VDPWriteToRegisterPort(vdp, UInt8((SpritesTests.spriteAttrTable + 1) >> 8) | UInt8(kVDPVramWriteMask))
+        VDPWriteToDataPort(vdp, 32)
+
+        // then
+        XCTAssert(scanline(11) == SpritesTests.line(x: 32, width: 8, color: SpritesTests.white))
+
+        // when: sprites are made large through the register
+        VDPWriteToRegisterPort(vdp, 0xC2)
+        VDPWriteToRegisterPort(vdp, 0x81)
+
+        // then
+        XCTAssert(scanline(20) == SpritesTests.line(x: 32, width: 16, color: SpritesTests.white))
+    }
+}
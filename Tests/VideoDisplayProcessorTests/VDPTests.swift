@@ -19,6 +19,35 @@ final class VDPTests: XCTestCase {
         VDPDestroy(vdp)
     }
 
+    func testInitInPlace() {
+        // given
+        let mem = UnsafeMutableRawPointer.allocate(byteCount: VDPSizeOf(), alignment: VDPAlignOf())
+        defer { mem.deallocate() }
+        memset(mem, 0xFF, VDPSizeOf())
+
+        // when
+        let placed = VDPInit(mem)
+
+        // then
+        XCTAssert(placed != nil)
+        XCTAssert(UnsafeMutableRawPointer(placed) == mem)
+        XCTAssert(VDPGetRegister(placed, 1) == 0x00)
+        XCTAssert(VDPGetVramAddress(placed) == 0x0000)
+
+        VDPSetVram(placed, 0x2000, 0x5A)
+        XCTAssert(VDPGetVram(placed, 0x2000) == 0x5A)
+    }
+
+    func testInitMisaligned() {
+        guard VDPAlignOf() > 1 else { return }
+
+        let mem = UnsafeMutableRawPointer.allocate(byteCount: VDPSizeOf() + 1, alignment: VDPAlignOf())
+        defer { mem.deallocate() }
+
+        XCTAssert(VDPInit(mem + 1) == nil)
+        XCTAssert(VDPInit(nil) == nil)
+    }
+
     func testGetSetRegister() {
         VDPSetRegister(vdp, 2, 0xAA)
         XCTAssert(VDPGetRegister(vdp, 2) == 0xAA)
@@ -40,6 +69,21 @@ final class VDPTests: XCTestCase {
         XCTAssert(vram[0x3FFF] == 0xEF)
     }
 
+    func testVramView() {
+        // given
+        let view = VDPGetVramView(vdp)
+
+        // when
+        VDPSetVram(vdp, 0x1001, 0x55)
+        VDPSetVram(vdp, 0x3FFF, 0xEF)
+
+        // then: the view reflects writes without being fetched again
+        XCTAssert(view.mask == UInt16(kVDPVramSize - 1))
+        XCTAssert(view.bytes[0x1001] == 0x55)
+        XCTAssert(view.bytes[Int(0x4000 + 0x3FFF) & Int(view.mask)] == 0xEF)
+        XCTAssert(VDPGetVramView(nil).bytes == nil)
+    }
+
     func testReset() {
         // given
         VDPSetRegister(vdp, 3, 0xA0)
@@ -203,4 +247,53 @@ final class VDPTests: XCTestCase {
         // then (interrupts are _on_)
         XCTAssert(interrupted)
     }
+
+    func testFrameHandoff() {
+        // given: nothing published yet
+        var frameNumber: UInt64 = 99
+        let initial = VDPAcquireFrame(vdp, &frameNumber)
+        XCTAssert(initial != nil && frameNumber == 0)
+
+        // when
+        VDPSetRegister(vdp, 1, 0x40)
+        VDPSetRegister(vdp, 7, UInt8(kVDPColorDarkRed.rawValue))
+        VDPRenderFrame(vdp)
+        let first = VDPAcquireFrame(vdp, &frameNumber)
+
+        // then: a new buffer holding the rendered frame
+        XCTAssert(first != initial && frameNumber == 1)
+        XCTAssert(Array(UnsafeBufferPointer(start: first, count: Int(kVDPSizeX * kVDPSizeY))) ==
+                  [UInt8](repeating: UInt8(kVDPColorDarkRed.rawValue), count: Int(kVDPSizeX * kVDPSizeY)))
+
+        // when: frames nobody acquired are skipped, and re-acquiring without a new frame returns the same one
+        VDPRenderFrame(vdp)
+        VDPRenderFrame(vdp)
+        _ = VDPAcquireFrame(vdp, &frameNumber)
+        XCTAssert(frameNumber == 3)
+
+        let again = VDPAcquireFrame(vdp, &frameNumber)
+        XCTAssert(again != first && frameNumber == 3)
+        XCTAssert(VDPAcquireFrame(vdp, nil) == again)
+    }
+
+    func testFrameInterruptAfterPublish() {
+        // given: the handler acquires the frame it's signalled for
+        var context: (vdp: VideoDisplayProcessorRef?, frameNumber: UInt64) = (vdp, 0)
+        VDPSetInterruptHandler(vdp, &context) { contextPtr in
+            guard let opaquePtr = contextPtr else {
+                return
+            }
+
+            let context = opaquePtr.assumingMemoryBound(to: (vdp: VideoDisplayProcessorRef?, frameNumber: UInt64).self)
+            let ref = context.pointee.vdp
+            _ = VDPAcquireFrame(ref, &context.pointee.frameNumber)
+        }
+
+        // when
+        VDPSetRegister(vdp, 1, 0b01100000)
+        VDPRenderFrame(vdp)
+
+        // then
+        XCTAssert(context.frameNumber == 1)
+    }
 }
@@ -0,0 +1,127 @@
+//
+//  WatchTests.swift
+//
+//
+
+import XCTest
+@testable import VideoDisplayProcessor
+
+final class WatchTests: XCTestCase {
+    struct Reported {
+        var calls = 0
+        var ranges: [VDPVramRange] = []
+    }
+
+    static let handler: VDPWatchHandler = { observer, ranges, count in
+        guard let reported = observer?.assumingMemoryBound(to: Reported.self) else {
+            return
+        }
+
+        reported.pointee.calls += 1
+        reported.pointee.ranges.append(contentsOf: UnsafeBufferPointer(start: ranges, count: count))
+    }
+
+    var vdp: VideoDisplayProcessorRef!
+    var reported: UnsafeMutablePointer<Reported>!
+    var scanline: UnsafeMutableBufferPointer<UInt8>!
+
+    override func setUp() {
+        vdp = VDPCreate()
+        reported = UnsafeMutablePointer<Reported>.allocate(capacity: 1)
+        reported.initialize(to: Reported())
+        scanline = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: Int(kVDPSizeX))
+    }
+
+    override func tearDown() {
+        scanline.deallocate()
+        reported.deinitialize(count: 1)
+        reported.deallocate()
+        VDPDestroy(vdp)
+    }
+
+    func setWriteAddress(_ addr: UInt16) {
+        VDPWriteToRegisterPort(vdp, UInt8(addr & 0xFF))
+        VDPWriteToRegisterPort(vdp, UInt8(kVDPVramWriteMask) | UInt8(addr >> 8))
+    }
+
+    func clearVram(_ range: Range<UInt16>) {
+        for addr in range {
+            VDPSetVram(vdp, addr, 0x00)
+        }
+    }
+
+    func testFrameWatch() {
+        // given
+        clearVram(0x1700..<0x2100)
+        XCTAssert(VDPAddWatch(vdp, 0x1800, 0x300, UInt8(kVDPWatchFrame), reported, WatchTests.handler) == 0)
+
+        // when: sequential writes (partly before the watch) and one elsewhere in it
+        setWriteAddress(0x17FE)
+        for value: UInt8 in 1...6 {
+            VDPWriteToDataPort(vdp, value)
+        }
+        VDPSetVram(vdp, 0x1900, 0x55)
+        VDPSetVram(vdp, 0x2000, 0x55)
+
+        // then: nothing until the next frame, then once with the coalesced ranges
+        VDPGetScanline(vdp, 10, scanline.baseAddress)
+        XCTAssert(reported.pointee.calls == 0)
+
+        VDPRenderFrame(vdp)
+        XCTAssert(reported.pointee.calls == 1)
+        XCTAssert(reported.pointee.ranges.count == 2)
+        XCTAssert(reported.pointee.ranges[0].address == 0x1800 && reported.pointee.ranges[0].size == 4)
+        XCTAssert(reported.pointee.ranges[1].address == 0x1900 && reported.pointee.ranges[1].size == 1)
+    }
+
+    func testLineWatch() {
+        // given
+        clearVram(0x0000..<0x0100)
+        XCTAssert(VDPAddWatch(vdp, 0x0000, 0x100, UInt8(kVDPWatchLine), reported, WatchTests.handler) >= 0)
+
+        // when
+        VDPSetVram(vdp, 0x0010, 0xAA)
+        VDPGetScanline(vdp, 20, scanline.baseAddress)
+
+        // then
+        XCTAssert(reported.pointee.calls == 1)
+        XCTAssert(reported.pointee.ranges.first?.address == 0x0010)
+    }
+
+    func testUnchangedWritesIgnored() {
+        // given
+        VDPSetVram(vdp, 0x0200, 0x11)
+        XCTAssert(VDPAddWatch(vdp, 0x0200, 0x10, UInt8(kVDPWatchFrame), reported, WatchTests.handler) >= 0)
+
+        // when
+        VDPSetVram(vdp, 0x0200, 0x11)
+        VDPFlushWatches(vdp)
+
+        // then
+        XCTAssert(reported.pointee.calls == 0)
+    }
+
+    func testRemoveWatch() {
+        // given
+        let watch = VDPAddWatch(vdp, 0x0000, 0x4000, UInt8(kVDPWatchFrame), reported, WatchTests.handler)
+        XCTAssert(watch >= 0)
+        VDPSetVram(vdp, 0x3000, 0x22)
+
+        // when
+        VDPRemoveWatch(vdp, watch)
+        VDPSetVram(vdp, 0x3001, 0x22)
+        VDPFlushWatches(vdp)
+
+        // then: pending changes were dropped too
+        XCTAssert(reported.pointee.calls == 0)
+    }
+
+    func testWatchLimit() {
+        for idx in 0..<Int(kVDPMaxWatches) {
+            XCTAssert(VDPAddWatch(vdp, UInt16(idx * 0x100), 0x100, UInt8(kVDPWatchFrame), reported, WatchTests.handler) == idx)
+        }
+
+        XCTAssert(VDPAddWatch(vdp, 0x0000, 0x100, UInt8(kVDPWatchFrame), reported, WatchTests.handler) == -1)
+        XCTAssert(VDPAddWatch(vdp, 0x0000, 0x100, UInt8(kVDPWatchFrame), reported, nil) == -1)
+    }
+}
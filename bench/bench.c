@@ -0,0 +1,759 @@
+/*
+ * Troy's TMS9918 Emulator - Renderer benchmarks
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ * Renders a fixed set of scenes through the public APIs and reports
+ * the timings as JSON (to stdout)
+ *
+ * usage: bench [-n frames] [-r repeats] [-t threads] [-T trace]... [image.bin]
+ *
+ * -T replays a recorded trace (see vrEmuTms9918Trace.h and replay.c) as an
+ * extra workload
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#endif
+
+#include "vrEmuTms9918.h"
+#include "vrEmuTms9918Util.h"
+#include "vrEmuTms9918Output.h"
+#include "vrEmuTms9918Workers.h"
+#include "vrEmuTms9918Batch.h"
+#include "vrEmuTms9918Gpu.h"
+#include "vrEmuTms9918Trace.h"
+#include "VideoDisplayProcessor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+#define BENCH_VRAM_SIZE   0x4000
+#define BENCH_NUM_REGS    8
+
+#define BENCH_SAT_ADDR    0x3b00   /* R5 = 0x76 */
+#define BENCH_NUM_SPRITES 32
+
+#define BENCH_MAX_TRACES  16
+#define BENCH_LINE_CYCLES 228      /* cpu cycles per scanline (3.58MHz Z80) */
+
+/* a scene to render
+ * ---------------------- */
+typedef struct
+{
+  const char* name;
+  uint8_t regs[BENCH_NUM_REGS];
+  uint8_t vram[BENCH_VRAM_SIZE];
+} BenchScene;
+
+static int benchFrames = 1000;
+static int benchRepeats = 5;
+static int benchThreads = 4;
+static int benchFirstResult = 1;
+static VrEmuTms9918Workers* benchWorkers = NULL;
+
+
+/* Function:  benchNowNs
+ * ----------------------------------------
+ * monotonic time in nanoseconds
+ */
+static double benchNowNs(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER freq, now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+/* Function:  benchRandom
+ * ----------------------------------------
+ * fixed sequence pseudo-random bytes, so scenes are identical between runs
+ */
+static uint8_t benchRandom(uint32_t* state)
+{
+  *state = *state * 1664525u + 1013904223u;
+  return (uint8_t)(*state >> 24);
+}
+
+/* Function:  benchSceneInit
+ * ----------------------------------------
+ * fill a scene with pseudo-random vram, the given registers and no sprites
+ */
+static void benchSceneInit(BenchScene* scene, const char* name, const uint8_t regs[BENCH_NUM_REGS], uint32_t seed)
+{
+  scene->name = name;
+  memcpy(scene->regs, regs, BENCH_NUM_REGS);
+
+  for (int i = 0; i < BENCH_VRAM_SIZE; ++i)
+  {
+    scene->vram[i] = benchRandom(&seed);
+  }
+
+  scene->vram[BENCH_SAT_ADDR] = 0xd0; /* no sprites */
+}
+
+/* Function:  benchSceneSprites
+ * ----------------------------------------
+ * place all 32 sprites. clustered sprites overflow the 4 per line limit
+ */
+static void benchSceneSprites(BenchScene* scene, int clustered, uint32_t seed)
+{
+  for (int i = 0; i < BENCH_NUM_SPRITES; ++i)
+  {
+    uint8_t* attr = scene->vram + BENCH_SAT_ADDR + i * 4;
+    attr[0] = clustered ? (uint8_t)(32 + (i % 8) * 16 + (i / 8)) : (uint8_t)(benchRandom(&seed) % 176);
+    attr[1] = clustered ? (uint8_t)(i * 7) : benchRandom(&seed);
+    attr[2] = benchRandom(&seed);
+    attr[3] = (uint8_t)(1 + i % 15);
+  }
+}
+
+/* Function:  benchSceneLoadImage
+ * ----------------------------------------
+ * load a 16KB vram + 8 register snapshot (see pybindings/image.bin)
+ */
+static int benchSceneLoadImage(BenchScene* scene, const char* name, const char* path)
+{
+  FILE* f = fopen(path, "rb");
+  if (f == NULL)
+    return 0;
+
+  scene->name = name;
+  const int ok = fread(scene->vram, 1, BENCH_VRAM_SIZE, f) == BENCH_VRAM_SIZE &&
+                 fread(scene->regs, 1, BENCH_NUM_REGS, f) == BENCH_NUM_REGS;
+  fclose(f);
+  return ok;
+}
+
+/* Function:  benchTmsLoad
+ * ----------------------------------------
+ * load a scene into a tms9918
+ */
+static void benchTmsLoad(VrEmuTms9918* tms9918, const BenchScene* scene)
+{
+  for (int i = 0; i < BENCH_NUM_REGS; ++i)
+  {
+    vrEmuTms9918WriteRegisterValue(tms9918, (vrEmuTms9918Register)i, scene->regs[i]);
+  }
+
+  vrEmuTms9918SetAddressWrite(tms9918, 0);
+  vrEmuTms9918WriteBlock(tms9918, scene->vram, BENCH_VRAM_SIZE);
+}
+
+/* Function:  benchVdpLoad
+ * ----------------------------------------
+ * load a scene into a VideoDisplayProcessor
+ */
+static void benchVdpLoad(VideoDisplayProcessorRef vdp, const BenchScene* scene)
+{
+  for (int i = 0; i < BENCH_NUM_REGS; ++i)
+  {
+    VDPSetRegister(vdp, (uint8_t)i, scene->regs[i]);
+  }
+
+  for (int i = 0; i < BENCH_VRAM_SIZE; ++i)
+  {
+    VDPSetVram(vdp, (uint16_t)i, scene->vram[i]);
+  }
+}
+
+/* Function:  benchReportFrames
+ * ----------------------------------------
+ * output a result for a run of frames. bytes is the number of bytes
+ * produced or copied per frame
+ */
+static void benchReportFrames(const char* scene, const char* api, double frames, double bestNs, double lines, double bytes,
+                              uint32_t checksum)
+{
+  const double frameNs = bestNs / frames;
+
+  printf("%s\n    {\"scene\": \"%s\", \"api\": \"%s\", \"frames\": %.0f, \"repeats\": %d, "
+         "\"ns_per_scanline\": %.2f, \"frames_per_sec\": %.1f, \"bytes_per_sec\": %.0f, \"checksum\": %u}",
+         benchFirstResult ? "" : ",", scene, api, frames, benchRepeats,
+         lines ? frameNs / lines : 0.0, 1e9 / frameNs, bytes * 1e9 / frameNs, (unsigned)checksum);
+
+  benchFirstResult = 0;
+}
+
+/* Function:  benchReport
+ * ----------------------------------------
+ * output a result for benchFrames frames
+ */
+static void benchReport(const char* scene, const char* api, double bestNs, double lines, double bytes, uint32_t checksum)
+{
+  benchReportFrames(scene, api, benchFrames, bestNs, lines, bytes, checksum);
+}
+
+/* Function:  benchChecksum
+ * ----------------------------------------
+ * checksum the output, so it can't be optimized away (and can be compared)
+ */
+static uint32_t benchChecksum(const uint8_t* data, size_t numBytes)
+{
+  uint32_t sum = 2166136261u;
+  for (size_t i = 0; i < numBytes; ++i)
+  {
+    sum = (sum ^ data[i]) * 16777619u;
+  }
+  return sum;
+}
+
+/* Function:  benchScanLine
+ * ----------------------------------------
+ * vrEmuTms9918ScanLine() for each line of each frame
+ */
+static void benchScanLine(const BenchScene* scene)
+{
+  static uint8_t frame[TMS9918_PIXELS_Y][TMS9918_PIXELS_X];
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      for (int y = 0; y < TMS9918_PIXELS_Y; ++y)
+      {
+        vrEmuTms9918ScanLine(tms9918, (uint8_t)y, frame[y]);
+      }
+      vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "vrEmuTms9918ScanLine", best, TMS9918_PIXELS_Y, sizeof(frame),
+              benchChecksum(frame[0], sizeof(frame)));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchRenderFrame
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame() for each frame
+ */
+static void benchRenderFrame(const BenchScene* scene)
+{
+  static uint8_t frame[TMS9918_PIXELS_Y * TMS9918_PIXELS_X];
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918RenderFrame(tms9918, frame, TMS9918_PIXELS_X);
+      vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "vrEmuTms9918RenderFrame", best, TMS9918_PIXELS_Y, sizeof(frame),
+              benchChecksum(frame, sizeof(frame)));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchSkipFrame
+ * ----------------------------------------
+ * vrEmuTms9918SkipFrame() for each frame
+ */
+static void benchSkipFrame(const BenchScene* scene)
+{
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  uint8_t status = 0;
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918SkipFrame(tms9918);
+      status = vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "vrEmuTms9918SkipFrame", best, TMS9918_PIXELS_Y, 0, status);
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchRenderFrameToSurface
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrameToSurface() to BGRA8888 at scale for each frame
+ */
+static void benchRenderFrameToSurface(const BenchScene* scene, unsigned scale, const char* api)
+{
+  static uint8_t surface[TMS9918_PIXELS_Y * TMS9918_OUTPUT_MAX_SCALE * TMS9918_PIXELS_X * TMS9918_OUTPUT_MAX_SCALE * 4];
+  vrEmuTms9918Output output;
+  vrEmuTms9918OutputInit(&output, TMS_PIXEL_BGRA8888, scale, NULL);
+
+  /* rows packed at this scale, so the pixels converted are all there is to count and checksum */
+  const size_t pitch = (size_t)TMS9918_PIXELS_X * scale * output.bytesPerPixel;
+  const size_t surfaceBytes = (size_t)TMS9918_PIXELS_Y * scale * pitch;
+
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918RenderFrameToSurface(tms9918, &output, surface, pitch);
+      vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, api, best, TMS9918_PIXELS_Y, (double)surfaceBytes,
+              benchChecksum(surface, surfaceBytes));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchGpuUpload
+ * ----------------------------------------
+ * stands in for a texture upload
+ */
+static void benchGpuUpload(void* context, uint16_t addr, const uint8_t* data, size_t numBytes)
+{
+  memcpy((uint8_t*)context + addr, data, numBytes);
+}
+
+/* Function:  benchGpuBeginFrame
+ * ----------------------------------------
+ * vrEmuTms9918GpuBeginFrame() for each frame, after rewriting the name
+ * table (a typical frame's vram traffic)
+ */
+static void benchGpuBeginFrame(const BenchScene* scene)
+{
+  static uint8_t texture[BENCH_VRAM_SIZE];
+  vrEmuTms9918GpuUniforms uniforms;
+  vrEmuTms9918GpuInitUniforms(&uniforms, NULL);
+
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+  const uint16_t nameTable = (uint16_t)((vrEmuTms9918RegValue(tms9918, TMS_REG_NAME_TABLE) & 0x0f) << 10);
+
+  size_t uploaded = 0;
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918SetAddressWrite(tms9918, nameTable);
+      vrEmuTms9918WriteBlock(tms9918, scene->vram + nameTable, 768);
+      uploaded = vrEmuTms9918GpuBeginFrame(tms9918, benchGpuUpload, texture, &uniforms);
+      vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "vrEmuTms9918GpuBeginFrame", best, TMS9918_PIXELS_Y, (double)uploaded,
+              benchChecksum(texture, sizeof(texture)));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchRenderFrameParallel
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrameParallel() with a band per thread
+ */
+static void benchRenderFrameParallel(const BenchScene* scene)
+{
+  static uint8_t frame[TMS9918_PIXELS_Y * TMS9918_PIXELS_X];
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918RenderFrameParallel(tms9918, frame, TMS9918_PIXELS_X, (uint8_t)benchThreads,
+                                      vrEmuTms9918WorkersParallelFor, benchWorkers);
+      vrEmuTms9918ReadStatus(tms9918);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "vrEmuTms9918RenderFrameParallel", best, TMS9918_PIXELS_Y, sizeof(frame),
+              benchChecksum(frame, sizeof(frame)));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchBatchRenderFrames
+ * ----------------------------------------
+ * vrEmuTms9918BatchRenderFrames() for BENCH_BATCH_SIZE copies of the scene
+ */
+#define BENCH_BATCH_SIZE 32
+
+static void benchBatchRenderFrames(const BenchScene* scene)
+{
+  static uint8_t frames[BENCH_BATCH_SIZE][TMS9918_PIXELS_Y * TMS9918_PIXELS_X];
+  VrEmuTms9918Batch* batch = vrEmuTms9918BatchNew(BENCH_BATCH_SIZE);
+  for (size_t i = 0; i < BENCH_BATCH_SIZE; ++i)
+  {
+    benchTmsLoad(vrEmuTms9918BatchInstance(batch, i), scene);
+  }
+
+  uint8_t status[BENCH_BATCH_SIZE];
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      vrEmuTms9918BatchRenderFrames(batch, frames[0], sizeof(frames[0]), TMS9918_PIXELS_X,
+                                    vrEmuTms9918WorkersParallelFor, benchWorkers);
+      vrEmuTms9918BatchReadStatus(batch, status);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  /* per instance frame, so results compare with vrEmuTms9918RenderFrame */
+  benchReport(scene->name, "vrEmuTms9918BatchRenderFrames", best / BENCH_BATCH_SIZE, TMS9918_PIXELS_Y, sizeof(frames[0]),
+              benchChecksum(frames[BENCH_BATCH_SIZE - 1], sizeof(frames[0])));
+  vrEmuTms9918BatchDestroy(batch);
+}
+
+/* Function:  benchVdpScanline
+ * ----------------------------------------
+ * VDPGetScanline() (the Swift package's core) for each line of each frame
+ */
+static void benchVdpScanline(const BenchScene* scene)
+{
+  static uint8_t frame[kVDPSizeY][kVDPSizeX];
+  VideoDisplayProcessorRef vdp = VDPCreate();
+  benchVdpLoad(vdp, scene);
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    for (int f = 0; f < benchFrames; ++f)
+    {
+      for (int y = 0; y < kVDPSizeY; ++y)
+      {
+        VDPGetScanline(vdp, (uint8_t)y, frame[y]);
+      }
+      VDPReadFromRegisterPort(vdp);
+    }
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  benchReport(scene->name, "VDPGetScanline", best, kVDPSizeY, sizeof(frame),
+              benchChecksum(frame[0], sizeof(frame)));
+  VDPDestroy(vdp);
+}
+
+/* Function:  benchTraceClock
+ * ----------------------------------------
+ * the recorded "cpu" cycle count
+ */
+static uint64_t benchTraceClock(void* context)
+{
+  return *(const uint64_t*)context;
+}
+
+/* Function:  benchRecordTrace
+ * ----------------------------------------
+ * record benchFrames frames of a typical game loop on scene: a raster
+ * scrolled frame a row at a time, then a whole frame with the sprites
+ * moved, polling the status register between. returns the trace (to free)
+ */
+static uint8_t* benchRecordTrace(const BenchScene* scene, size_t* numBytes)
+{
+  FILE* file = tmpfile();
+  if (file == NULL)
+    return NULL;
+
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  uint64_t cycles = 0;
+  VrEmuTms9918TraceRecorder* recorder = vrEmuTms9918TraceRecorderNew(tms9918, file, benchTraceClock, &cycles);
+
+  const uint16_t nameTable = (uint16_t)((vrEmuTms9918RegValue(tms9918, TMS_REG_NAME_TABLE) & 0x0f) << 10);
+  uint8_t line[TMS9918_PIXELS_X];
+  static uint8_t frame[TMS9918_PIXELS_Y * TMS9918_PIXELS_X];
+  uint32_t seed = 7;
+
+  for (int f = 0; recorder && f < benchFrames; ++f)
+  {
+    if (f & 1)
+    {
+      for (int i = 0; i < BENCH_NUM_SPRITES; ++i)
+      {
+        vrEmuTms9918SetAddressWrite(tms9918, (uint16_t)(BENCH_SAT_ADDR + i * 4));
+        vrEmuTms9918WriteData(tms9918, (uint8_t)(benchRandom(&seed) % 192));
+        vrEmuTms9918WriteData(tms9918, benchRandom(&seed));
+      }
+      cycles += BENCH_LINE_CYCLES * TMS9918_PIXELS_Y;
+      vrEmuTms9918RenderFrame(tms9918, frame, TMS9918_PIXELS_X);
+    }
+    else
+    {
+      for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+      {
+        if ((y & 7) == 0)
+        {
+          vrEmuTms9918SetAddressWrite(tms9918, (uint16_t)(nameTable + (y >> 3) * 32));
+          for (int x = 0; x < 32; ++x)
+          {
+            vrEmuTms9918WriteData(tms9918, (uint8_t)(f + x));
+          }
+        }
+        cycles += BENCH_LINE_CYCLES;
+        vrEmuTms9918ScanLine(tms9918, y, line);
+      }
+    }
+    vrEmuTms9918ReadStatus(tms9918);
+  }
+
+  vrEmuTms9918TraceRecorderDestroy(recorder);
+  vrEmuTms9918Destroy(tms9918);
+
+  uint8_t* trace = NULL;
+  const long size = ftell(file);
+  if (recorder && size > 0 && fseek(file, 0, SEEK_SET) == 0 && (trace = malloc((size_t)size)) != NULL)
+  {
+    if (fread(trace, 1, (size_t)size, file) != (size_t)size)
+    {
+      free(trace);
+      trace = NULL;
+    }
+    *numBytes = (size_t)size;
+  }
+  fclose(file);
+
+  return trace;
+}
+
+/* Function:  benchTraceReplay
+ * ----------------------------------------
+ * vrEmuTms9918TraceReplay() of a whole trace, normalized per frame
+ */
+static void benchTraceReplay(const char* name, const VrEmuTms9918Trace* trace, size_t traceBytes, unsigned flags,
+                             const char* api)
+{
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  vrEmuTms9918TraceStats stats;
+
+  double best = 0;
+  for (int r = 0; r < benchRepeats; ++r)
+  {
+    const double start = benchNowNs();
+    vrEmuTms9918TraceReplay(trace, tms9918, flags, &stats);
+    const double elapsed = benchNowNs() - start;
+    if (r == 0 || elapsed < best) best = elapsed;
+  }
+
+  /* scanline records count towards frames */
+  const double lines = (double)stats.frames * TMS9918_PIXELS_Y + (double)stats.scanLines;
+  const double frames = lines ? lines / TMS9918_PIXELS_Y : 1;
+  benchReportFrames(name, api, frames, best, TMS9918_PIXELS_Y, traceBytes / frames,
+                    (uint32_t)(stats.portAccesses ^ stats.readMismatches));
+  vrEmuTms9918Destroy(tms9918);
+}
+
+/* Function:  benchTrace
+ * ----------------------------------------
+ * replay a trace, rendering and status only
+ */
+static void benchTrace(const char* name, const VrEmuTms9918Trace* trace, size_t traceBytes)
+{
+  benchTraceReplay(name, trace, traceBytes, 0, "vrEmuTms9918TraceReplay");
+  benchTraceReplay(name, trace, traceBytes, TMS_TRACE_REPLAY_SKIP_PIXELS, "vrEmuTms9918TraceReplay_skip_pixels");
+}
+
+/* Function:  benchVramTransfer
+ * ----------------------------------------
+ * full 16KB vram uploads and downloads, block and byte-wise
+ */
+static void benchVramTransfer(const BenchScene* scene)
+{
+  static uint8_t buffer[BENCH_VRAM_SIZE];
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+  benchTmsLoad(tms9918, scene);
+
+  for (int api = 0; api < 3; ++api)
+  {
+    double best = 0;
+    for (int r = 0; r < benchRepeats; ++r)
+    {
+      const double start = benchNowNs();
+      for (int f = 0; f < benchFrames; ++f)
+      {
+        switch (api)
+        {
+          case 0:
+            vrEmuTms9918SetAddressWrite(tms9918, 0);
+            vrEmuTms9918WriteBlock(tms9918, scene->vram, BENCH_VRAM_SIZE);
+            break;
+
+          case 1:
+            vrEmuTms9918SetAddressRead(tms9918, 0);
+            vrEmuTms9918ReadBlock(tms9918, buffer, BENCH_VRAM_SIZE);
+            break;
+
+          default:
+            vrEmuTms9918SetAddressWrite(tms9918, 0);
+            for (int i = 0; i < BENCH_VRAM_SIZE; ++i)
+            {
+              vrEmuTms9918WriteData(tms9918, scene->vram[i]);
+            }
+            break;
+        }
+      }
+      const double elapsed = benchNowNs() - start;
+      if (r == 0 || elapsed < best) best = elapsed;
+    }
+
+    static const char* apiNames[] = { "vrEmuTms9918WriteBlock", "vrEmuTms9918ReadBlock", "vrEmuTms9918WriteData" };
+    benchReport(scene->name, apiNames[api], best, 0, BENCH_VRAM_SIZE,
+                benchChecksum(api == 1 ? buffer : scene->vram, BENCH_VRAM_SIZE));
+  }
+
+  vrEmuTms9918Destroy(tms9918);
+}
+
+
+int main(int argc, char** argv)
+{
+  const char* imagePath = "../pybindings/image.bin";
+  const char* tracePaths[BENCH_MAX_TRACES];
+  int numTraces = 0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      benchFrames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      benchRepeats = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      benchThreads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc && numTraces < BENCH_MAX_TRACES)
+      tracePaths[numTraces++] = argv[++i];
+    else
+      imagePath = argv[i];
+  }
+
+  if (benchFrames < 1) benchFrames = 1;
+  if (benchRepeats < 1) benchRepeats = 1;
+  if (benchThreads < 1) benchThreads = 1;
+  if (benchThreads > TMS9918_PIXELS_Y) benchThreads = TMS9918_PIXELS_Y;
+
+  /* the calling thread also renders a band */
+  benchWorkers = vrEmuTms9918WorkersNew((unsigned)benchThreads - 1);
+
+  /*                               R0    R1    R2    R3    R4    R5    R6    R7 */
+  static const uint8_t textRegs[] = { 0x00, 0xd0, 0x02, 0x00, 0x00, 0x76, 0x03, 0xf4 };
+  static const uint8_t gfx1Regs[] = { 0x00, 0xc0, 0x0e, 0x80, 0x00, 0x76, 0x03, 0x17 };
+  static const uint8_t gfx2Regs[] = { 0x02, 0xc0, 0x0e, 0xff, 0x03, 0x76, 0x03, 0x17 };
+  static const uint8_t multRegs[] = { 0x00, 0xc8, 0x0e, 0x80, 0x00, 0x76, 0x03, 0x17 };
+  static const uint8_t sprMagRegs[] = { 0x00, 0xc3, 0x0e, 0x80, 0x00, 0x76, 0x03, 0x17 };
+
+  static BenchScene scenes[7];
+  int numScenes = 0;
+
+  benchSceneInit(&scenes[numScenes++], "text", textRegs, 1);
+  benchSceneInit(&scenes[numScenes++], "graphics_i", gfx1Regs, 2);
+  benchSceneInit(&scenes[numScenes++], "graphics_ii", gfx2Regs, 3);
+  benchSceneInit(&scenes[numScenes++], "multicolor", multRegs, 4);
+
+  benchSceneInit(&scenes[numScenes], "sprites_5s", gfx1Regs, 5);
+  benchSceneSprites(&scenes[numScenes++], 1, 5);
+
+  benchSceneInit(&scenes[numScenes], "sprites_16x16_mag", sprMagRegs, 6);
+  benchSceneSprites(&scenes[numScenes++], 0, 6);
+
+  if (benchSceneLoadImage(&scenes[numScenes], "image_bin", imagePath))
+  {
+    ++numScenes;
+  }
+  else
+  {
+    fprintf(stderr, "bench: unable to load '%s'. skipping image_bin scene\n", imagePath);
+  }
+
+  /* the conversion path the RenderFrameToSurface figures measure */
+  printf("{\n  \"output_simd\": \"%s\",\n  \"benchmarks\": [", vrEmuTms9918OutputSimd());
+
+  for (int i = 0; i < numScenes; ++i)
+  {
+    benchScanLine(&scenes[i]);
+    benchRenderFrame(&scenes[i]);
+    benchSkipFrame(&scenes[i]);
+    benchRenderFrameToSurface(&scenes[i], 1, "vrEmuTms9918RenderFrameToSurface_bgra_x1");
+    benchRenderFrameToSurface(&scenes[i], 3, "vrEmuTms9918RenderFrameToSurface_bgra_x3");
+    benchGpuBeginFrame(&scenes[i]);
+    benchRenderFrameParallel(&scenes[i]);
+    benchBatchRenderFrames(&scenes[i]);
+    benchVdpScanline(&scenes[i]);
+  }
+
+  benchVramTransfer(&scenes[numScenes - 1]);
+
+  size_t traceBytes = 0;
+  uint8_t* traceData = benchRecordTrace(&scenes[numScenes - 1], &traceBytes);
+  VrEmuTms9918Trace* trace = traceData ? vrEmuTms9918TraceOpenMemory(traceData, traceBytes) : NULL;
+  if (trace)
+  {
+    benchTrace("game_loop_trace", trace, traceBytes);
+  }
+  else
+  {
+    fprintf(stderr, "bench: unable to record a trace. skipping game_loop_trace\n");
+  }
+  vrEmuTms9918TraceClose(trace);
+  free(traceData);
+
+  for (int i = 0; i < numTraces; ++i)
+  {
+    trace = vrEmuTms9918TraceOpen(tracePaths[i]);
+    if (trace == NULL)
+    {
+      fprintf(stderr, "bench: unable to open trace '%s'\n", tracePaths[i]);
+      continue;
+    }
+    benchTrace(tracePaths[i], trace, vrEmuTms9918TraceSize(trace));
+    vrEmuTms9918TraceClose(trace);
+  }
+
+  printf("\n  ]\n}\n");
+
+  vrEmuTms9918WorkersDestroy(benchWorkers);
+
+  return 0;
+}
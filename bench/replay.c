@@ -0,0 +1,127 @@
+/*
+ * Troy's TMS9918 Emulator - Trace replay
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ * Replays recorded port traces (see vrEmuTms9918Trace.h) through the core
+ * as fast as possible and reports the timings as JSON (to stdout). traces
+ * are memory mapped, so may be larger than memory
+ *
+ * usage: replay [-s] [-r repeats] trace...
+ *
+ * -s only skips frames (status, no pixels). exits with 1 if a trace can't
+ * be replayed, or a read returned a different value to the recording
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#endif
+
+#include "vrEmuTms9918.h"
+#include "vrEmuTms9918Trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+
+/* Function:  replayNowNs
+ * ----------------------------------------
+ * monotonic time in nanoseconds
+ */
+static double replayNowNs(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER freq, now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+  unsigned flags = 0;
+  int repeats = 1;
+  int first = 1;
+  int failed = 0;
+
+  VrEmuTms9918* tms9918 = vrEmuTms9918New();
+
+  printf("{\n  \"traces\": [");
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-s") == 0)
+    {
+      flags |= TMS_TRACE_REPLAY_SKIP_PIXELS;
+      continue;
+    }
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+    {
+      repeats = atoi(argv[++i]);
+      if (repeats < 1) repeats = 1;
+      continue;
+    }
+
+    VrEmuTms9918Trace* trace = vrEmuTms9918TraceOpen(argv[i]);
+    if (trace == NULL)
+    {
+      fprintf(stderr, "replay: unable to open trace '%s'\n", argv[i]);
+      failed = 1;
+      continue;
+    }
+
+    vrEmuTms9918TraceStats stats;
+    bool ok = true;
+    double best = 0;
+    for (int r = 0; r < repeats; ++r)
+    {
+      const double start = replayNowNs();
+      ok = vrEmuTms9918TraceReplay(trace, tms9918, flags, &stats) && ok;
+      const double elapsed = replayNowNs() - start;
+      if (r == 0 || elapsed < best) best = elapsed;
+    }
+
+    const double seconds = best > 0 ? best * 1e-9 : 1e-9;
+    const double frames = (double)stats.frames + (double)stats.scanLines / TMS9918_PIXELS_Y;
+
+    printf("%s\n    {\"trace\": \"%s\", \"ok\": %s, \"skip_pixels\": %s, \"repeats\": %d, "
+           "\"records\": %llu, \"port_accesses\": %llu, \"scanlines\": %llu, \"frames\": %llu, "
+           "\"read_mismatches\": %llu, \"duration\": %llu, "
+           "\"records_per_sec\": %.0f, \"frames_per_sec\": %.1f, \"bytes_per_sec\": %.0f}",
+           first ? "" : ",", argv[i], ok ? "true" : "false", (flags & TMS_TRACE_REPLAY_SKIP_PIXELS) ? "true" : "false",
+           repeats, (unsigned long long)stats.records, (unsigned long long)stats.portAccesses,
+           (unsigned long long)stats.scanLines, (unsigned long long)stats.frames,
+           (unsigned long long)stats.readMismatches, (unsigned long long)stats.duration,
+           (double)stats.records / seconds, frames / seconds, (double)vrEmuTms9918TraceSize(trace) / seconds);
+    first = 0;
+
+    if (!ok || stats.readMismatches)
+    {
+      failed = 1;
+    }
+
+    vrEmuTms9918TraceClose(trace);
+  }
+
+  printf("\n  ]\n}\n");
+
+  vrEmuTms9918Destroy(tms9918);
+
+  return failed;
+}
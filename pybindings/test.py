@@ -8,9 +8,12 @@ vram=d[:16*1024]
 regs=d[16*1024:]
 
 
-t.setRegs(list(regs))
-t.setVram(0,list(vram))
+# any bytes-like object (bytes, bytearray, memoryview, numpy array) is accepted
+t.setRegs(regs)
+t.setVram(0,vram)
 
 
-img = Image.frombytes('RGB', (256, 192), bytes(t.getScreen()))
+# getScreen() returns a (192, 256, 3) numpy array (getScreenIndexed() and
+# getScreenRgba() are also available)
+img = Image.fromarray(t.getScreen(), 'RGB')
 img.show()
@@ -1,24 +1,95 @@
+#include "vrEmuTms9918Output.h"
 #include "vrEmuTms9918Util.h"
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <stdint.h>
 #include <vector>
 
+namespace py = pybind11;
+
+// renderTrace() relies on the write log for its line timing
+#if !VR_TMS9918_EMU_WRITE_LOG
+#error "build with VR_TMS9918_EMU_WRITE_LOG=1 (see Makefile)"
+#endif
+
+// a renderTrace() record. writes are applied at their scanline within the
+// frame (see vrEmuTms9918LogWriteData)
+struct TraceRecord {
+  uint16_t line;
+  uint8_t op;
+  uint8_t value;
+};
+
+enum {
+  TRACE_DATA = 0,  // write value to the data port (mode = 0)
+  TRACE_ADDR = 1,  // write value to the address / register port (mode = 1)
+  TRACE_FRAME = 2, // render a frame
+  TRACE_SKIP = 3,  // run a frame without rendering it (status only)
+};
+
+static_assert(sizeof(TraceRecord) == 4, "trace records are 4 bytes");
+
 class Tms9918 {
 public:
   Tms9918();
   ~Tms9918();
   void setReg(uint8_t reg, uint8_t val);
-  void setRegs(const std::vector<uint8_t> &val);
-  void setVram(uint16_t addr, const std::vector<uint8_t> &data);
-  std::vector<uint8_t> getScreen();
+  void setRegs(py::buffer val);
+  void setRegsList(const std::vector<uint8_t> &val);
+  void setVram(uint16_t addr, py::buffer data);
+  void setVramList(uint16_t addr, const std::vector<uint8_t> &data);
+  void renderIndexed();
+  void renderRgb();
+  void renderRgba();
+  py::array_t<uint8_t> renderTrace(py::buffer trace, int channels);
+
+  // reused between calls. the getScreen*() arrays are views of these,
+  // kept alive by (and overwritten with each call on) the Tms9918 object
+  uint8_t indexed[TMS9918_PIXELS_Y][TMS9918_PIXELS_X];
+  uint8_t rgb[TMS9918_PIXELS_Y][TMS9918_PIXELS_X][3];
+  uint8_t rgba[TMS9918_PIXELS_Y][TMS9918_PIXELS_X][4];
 
 private:
   VrEmuTms9918 *t;
+  vrEmuTms9918Output rgbOutput;
+  vrEmuTms9918Output rgbaOutput;
 };
 
-Tms9918::Tms9918() { t = vrEmuTms9918New(); }
+// is a buffer C contiguous?
+static bool isContiguous(const py::buffer_info &info) {
+  py::ssize_t stride = info.itemsize;
+  for (py::ssize_t i = info.ndim - 1; i >= 0; --i) {
+    if (info.shape[i] > 1 && info.strides[i] != stride) {
+      return false;
+    }
+    stride *= info.shape[i];
+  }
+  return true;
+}
+
+// a contiguous byte view of any buffer protocol object (bytes, bytearray,
+// memoryview, numpy arrays, ...)
+static py::buffer_info byteBuffer(py::buffer data) {
+  py::buffer_info info = data.request();
+  if (info.itemsize != 1) {
+    throw std::invalid_argument("expected a buffer of bytes");
+  }
+  if (!isContiguous(info)) {
+    throw std::invalid_argument("expected a contiguous buffer");
+  }
+  return info;
+}
+
+Tms9918::Tms9918() {
+  t = vrEmuTms9918New();
+  vrEmuTms9918OutputInit(&rgbOutput, TMS_PIXEL_RGB888, 1, NULL);
+  vrEmuTms9918OutputInit(&rgbaOutput, TMS_PIXEL_RGBA8888, 1, NULL);
+}
 
 Tms9918::~Tms9918() { vrEmuTms9918Destroy(t); }
 
@@ -26,49 +97,183 @@ void Tms9918::setReg(uint8_t reg, uint8_t val) {
   vrEmuTms9918WriteRegValue(t, vrEmuTms9918Register(reg), val);
 }
 
-void Tms9918::setRegs(const std::vector<uint8_t> &val) {
+void Tms9918::setRegs(py::buffer val) {
+  py::buffer_info info = byteBuffer(val);
+  const uint8_t *regs = static_cast<const uint8_t *>(info.ptr);
+  for (py::ssize_t i = 0; i < info.size && i < TMS_NUM_REGISTERS; ++i) {
+    vrEmuTms9918WriteRegValue(t, vrEmuTms9918Register(i), regs[i]);
+  }
+}
+
+void Tms9918::setRegsList(const std::vector<uint8_t> &val) {
   for (size_t i = 0; i < val.size(); ++i) {
     vrEmuTms9918WriteRegValue(t, vrEmuTms9918Register(i), val[i]);
   }
 }
 
-void Tms9918::setVram(uint16_t addr, const std::vector<uint8_t> &data) {
+void Tms9918::setVram(uint16_t addr, py::buffer data) {
+  py::buffer_info info = byteBuffer(data);
+  py::gil_scoped_release release;
+  vrEmuTms9918SetAddressWrite(t, addr);
+  vrEmuTms9918WriteBytes(t, static_cast<const uint8_t *>(info.ptr), info.size);
+}
+
+void Tms9918::setVramList(uint16_t addr, const std::vector<uint8_t> &data) {
   vrEmuTms9918SetAddressWrite(t, addr);
   vrEmuTms9918WriteBytes(t, data.data(), data.size());
 }
 
-std::vector<uint8_t> Tms9918::getScreen() {
-  uint8_t scanline[TMS9918_PIXELS_X]; // scanline buffer
-
-  // an example output (a framebuffer for an SDL texture)
-  std::vector<uint8_t> framebuffer(TMS9918_PIXELS_X * TMS9918_PIXELS_Y * 3);
-
-  // generate all scanlines and render to framebuffer
-  size_t c = 0;
-  for (int y = 0; y < TMS9918_PIXELS_Y; ++y) {
-    // get the scanline pixels
-    vrEmuTms9918ScanLine(t, y, scanline);
-    for (int x = 0; x < TMS9918_PIXELS_X; ++x) {
-      // values returned from vrEmuTms9918ScanLine() are palette indexes
-      // use the vrEmuTms9918Palette array to convert to an RGBA value
-
-      uint32_t col = vrEmuTms9918Palette[scanline[x]];
-      framebuffer[c++] = (col >> 24) & 0xFF;
-      framebuffer[c++] = (col >> 16) & 0xFF;
-      framebuffer[c++] = (col >> 8) & 0xFF;
+void Tms9918::renderIndexed() {
+  // generate all scanlines in one call
+  vrEmuTms9918RenderFrame(t, &indexed[0][0], TMS9918_PIXELS_X);
+}
+
+// the RGB / RGBA frames are converted from palette indexes as each line is
+// generated (see vrEmuTms9918RenderFrameToSurface)
+void Tms9918::renderRgb() {
+  vrEmuTms9918RenderFrameToSurface(t, &rgbOutput, &rgb[0][0][0],
+                                   sizeof(rgb[0]));
+}
+
+void Tms9918::renderRgba() {
+  vrEmuTms9918RenderFrameToSurface(t, &rgbaOutput, &rgba[0][0][0],
+                                   sizeof(rgba[0]));
+}
+
+py::array_t<uint8_t> Tms9918::renderTrace(py::buffer trace, int channels) {
+  if (channels != 1 && channels != 3 && channels != 4) {
+    throw std::invalid_argument("channels must be 1, 3 or 4");
+  }
+
+  py::buffer_info info = trace.request();
+  if (!isContiguous(info) ||
+      (info.size * info.itemsize) % sizeof(TraceRecord) != 0) {
+    throw std::invalid_argument(
+        "expected a contiguous trace of 4 byte (line, op, value) records");
+  }
+
+  // bytes-like traces may not be aligned for TraceRecord
+  const uint8_t *records = static_cast<const uint8_t *>(info.ptr);
+  const size_t numRecords = (info.size * info.itemsize) / sizeof(TraceRecord);
+
+  size_t numFrames = 0;
+  for (size_t i = 0; i < numRecords; ++i) {
+    const uint8_t op = records[i * sizeof(TraceRecord) + offsetof(TraceRecord, op)];
+    if (op == TRACE_FRAME) {
+      ++numFrames;
+    } else if (op != TRACE_DATA && op != TRACE_ADDR && op != TRACE_SKIP) {
+      throw std::invalid_argument("unknown trace op");
     }
   }
-  return framebuffer;
-}
 
-namespace py = pybind11;
+  std::vector<py::ssize_t> shape = {(py::ssize_t)numFrames, TMS9918_PIXELS_Y,
+                                    TMS9918_PIXELS_X};
+  if (channels > 1) {
+    shape.push_back(channels);
+  }
+  py::array_t<uint8_t> frames(shape);
+  uint8_t *out = frames.mutable_data();
+  const size_t frameBytes = sizeof(indexed) * channels;
+
+  {
+    py::gil_scoped_release release;
+    for (size_t i = 0; i < numRecords; ++i) {
+      TraceRecord record;
+      memcpy(&record, records + i * sizeof(TraceRecord), sizeof(record));
+      switch (record.op) {
+      case TRACE_DATA:
+        vrEmuTms9918LogWriteData(t, record.line, record.value);
+        break;
+
+      case TRACE_ADDR:
+        vrEmuTms9918LogWriteAddr(t, record.line, record.value);
+        break;
+
+      case TRACE_SKIP:
+        vrEmuTms9918SkipFrame(t);
+        break;
+
+      default: // TRACE_FRAME
+        if (channels == 1) {
+          vrEmuTms9918RenderFrame(t, out, TMS9918_PIXELS_X);
+        } else {
+          vrEmuTms9918RenderFrameToSurface(
+              t, channels == 3 ? &rgbOutput : &rgbaOutput, out,
+              TMS9918_PIXELS_X * channels);
+        }
+        out += frameBytes;
+        break;
+      }
+    }
+  }
+
+  return frames;
+}
 
 PYBIND11_MODULE(tms9918, m) {
   m.doc() = "Tms9918"; // optional module docstring
   py::class_<Tms9918>(m, "Tms9918")
       .def(py::init<>())
       .def("setReg", &Tms9918::setReg)
-      .def("setRegs", &Tms9918::setRegs)
-      .def("setVram", &Tms9918::setVram)
-      .def("getScreen", &Tms9918::getScreen);
+      .def("setRegs", &Tms9918::setRegs,
+           "set registers 0 to n - 1 from a bytes-like object")
+      .def("setRegs", &Tms9918::setRegsList)
+      .def("setVram", &Tms9918::setVram,
+           "write a bytes-like object to vram at addr")
+      .def("setVram", &Tms9918::setVramList)
+      .def(
+          "getScreenIndexed",
+          [](py::object self) {
+            Tms9918 &tms = self.cast<Tms9918 &>();
+            {
+              py::gil_scoped_release release;
+              tms.renderIndexed();
+            }
+            return py::array_t<uint8_t>({TMS9918_PIXELS_Y, TMS9918_PIXELS_X},
+                                        &tms.indexed[0][0], self);
+          },
+          "render a frame as a (192, 256) array of palette indexes. the "
+          "array is reused (overwritten) by the next call")
+      .def(
+          "getScreen",
+          [](py::object self) {
+            Tms9918 &tms = self.cast<Tms9918 &>();
+            {
+              py::gil_scoped_release release;
+              tms.renderRgb();
+            }
+            return py::array_t<uint8_t>(
+                {TMS9918_PIXELS_Y, TMS9918_PIXELS_X, 3}, &tms.rgb[0][0][0],
+                self);
+          },
+          "render a frame as a (192, 256, 3) RGB array. the array is reused "
+          "(overwritten) by the next call")
+      .def(
+          "getScreenRgba",
+          [](py::object self) {
+            Tms9918 &tms = self.cast<Tms9918 &>();
+            {
+              py::gil_scoped_release release;
+              tms.renderRgba();
+            }
+            return py::array_t<uint8_t>(
+                {TMS9918_PIXELS_Y, TMS9918_PIXELS_X, 4}, &tms.rgba[0][0][0],
+                self);
+          },
+          "render a frame as a (192, 256, 4) RGBA array. the array is reused "
+          "(overwritten) by the next call")
+      .def("renderTrace", &Tms9918::renderTrace, py::arg("trace"),
+           py::arg("channels") = 1,
+           "replay a trace of (line, op, value) records (a traceDtype array "
+           "or equivalent native byte order bytes), returning an (N, 192, 256) array of "
+           "palette indexes (or (N, 192, 256, channels) RGB / RGBA) with a "
+           "frame for each TRACE_FRAME record. TRACE_SKIP records run a "
+           "frame without rendering it");
+
+  PYBIND11_NUMPY_DTYPE(TraceRecord, line, op, value);
+  m.attr("traceDtype") = py::dtype::of<TraceRecord>();
+  m.attr("TRACE_DATA") = (int)TRACE_DATA;
+  m.attr("TRACE_ADDR") = (int)TRACE_ADDR;
+  m.attr("TRACE_FRAME") = (int)TRACE_FRAME;
+  m.attr("TRACE_SKIP") = (int)TRACE_SKIP;
 }
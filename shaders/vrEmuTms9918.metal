@@ -0,0 +1,257 @@
+/*
+ * Troy's TMS9918 Emulator - GPU reference shaders (Metal)
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ * composes a frame from a copy of vram and the registers, pixel for pixel as
+ * vrEmuTms9918RenderFrame(). see vrEmuTms9918Gpu.h for the inputs. draw a
+ * single triangle (3 vertices, no vertex buffers) with tmsVertex and
+ * tmsFragment into a viewport of any size: pixels are scaled
+ * nearest-neighbour
+ */
+
+#include <metal_stdlib>
+using namespace metal;
+
+// vrEmuTms9918GpuUniforms
+struct TmsUniforms
+{
+  uint registers[8];
+  float4 palette[16];
+};
+
+struct TmsVertexOut
+{
+  float4 position [[position]];
+
+  // (0, 0) top left to (256, 192) bottom right
+  float2 screenPos;
+};
+
+// extra parameters of the shared functions below: the fragment function's inputs
+#define TMS_PARAMS texture2d<uint> vram, constant TmsUniforms& uniforms,
+#define TMS_ARGS vram, uniforms,
+
+// vram is TMS9918_GPU_VRAM_WIDTH x TMS9918_GPU_VRAM_HEIGHT MTLPixelFormatR8Uint texels
+uint tmsVramByte(TMS_PARAMS uint addr)
+{
+  addr &= 0x3fffu;
+  return vram.read(uint2(addr & 127u, addr >> 7)).r;
+}
+
+uint tmsReg(TMS_PARAMS uint reg)
+{
+  return uniforms.registers[reg] & 0xffu;
+}
+
+// ---- tms9918 pixel: identical in vrEmuTms9918.frag and vrEmuTms9918.metal ----
+
+#define TMS_MODE_GRAPHICS_I   0u
+#define TMS_MODE_GRAPHICS_II  1u
+#define TMS_MODE_TEXT         2u
+#define TMS_MODE_MULTICOLOR   3u
+
+// a color table color, with transparent showing the backdrop
+uint tmsResolveColor(uint color, uint backdrop)
+{
+  return color == 0u ? backdrop : color;
+}
+
+// the display mode, as tmsMode()
+uint tmsMode(uint r0, uint r1)
+{
+  if ((r0 & 0x02u) != 0u)
+  {
+    return TMS_MODE_GRAPHICS_II;
+  }
+
+  uint bits = (r1 & 0x18u) >> 3;
+  if (bits == 1u) return TMS_MODE_MULTICOLOR;
+  if (bits == 2u) return TMS_MODE_TEXT;
+  return TMS_MODE_GRAPHICS_I;
+}
+
+// the tile layer at (x, y), as the graphics I / II, text and multicolor rows
+uint tmsTilePixel(TMS_PARAMS uint mode, uint x, uint y, uint backdrop)
+{
+  uint nameTableAddr = (tmsReg(TMS_ARGS 2u) & 0x0fu) << 10;
+  uint tileY = y >> 3;
+  uint pattRow = y & 7u;
+
+  if (mode == TMS_MODE_TEXT)
+  {
+    uint fgColor = tmsResolveColor(tmsReg(TMS_ARGS 7u) >> 4, backdrop);
+
+    // 8 pixels of padding either side of 40 6-pixel tiles
+    if (x < 8u || x >= 248u)
+    {
+      return backdrop;
+    }
+
+    uint tileX = (x - 8u) / 6u;
+    uint pattAddr = (tmsReg(TMS_ARGS 4u) & 0x07u) << 11;
+    uint name = tmsVramByte(TMS_ARGS nameTableAddr + tileY * 40u + tileX);
+    uint pattByte = tmsVramByte(TMS_ARGS pattAddr + name * 8u + pattRow);
+
+    return ((pattByte << ((x - 8u) % 6u)) & 0x80u) != 0u ? fgColor : backdrop;
+  }
+
+  uint name = tmsVramByte(TMS_ARGS nameTableAddr + tileY * 32u + (x >> 3));
+  uint pattByte;
+  uint colorByte;
+
+  if (mode == TMS_MODE_MULTICOLOR)
+  {
+    // a 4x4 block of the color pair's high (left) or low (right) nibble
+    uint pattAddr = (tmsReg(TMS_ARGS 4u) & 0x07u) << 11;
+    uint mcRow = ((y / 4u) & 1u) + ((y >> 3) & 3u) * 2u;
+    colorByte = tmsVramByte(TMS_ARGS pattAddr + name * 8u + mcRow);
+
+    return tmsResolveColor((x & 4u) == 0u ? colorByte >> 4 : colorByte & 0x0fu, backdrop);
+  }
+
+  if (mode == TMS_MODE_GRAPHICS_II)
+  {
+    // invalid table masks use the first third, and only the lower 3 bits of the name
+    bool invalid = (tmsReg(TMS_ARGS 4u) & 0x03u) != 0x03u || (tmsReg(TMS_ARGS 3u) & 0x7fu) != 0x7fu;
+    uint pageOffset = invalid ? 0u : ((tileY & 0x18u) >> 3) << 11;
+    uint pattAddr = ((tmsReg(TMS_ARGS 4u) & 0x04u) << 11) + pageOffset;
+    uint colorAddr = ((tmsReg(TMS_ARGS 3u) & 0x80u) << 6) + pageOffset;
+    uint offset = (invalid ? name & 0x07u : name) * 8u + pattRow;
+
+    pattByte = tmsVramByte(TMS_ARGS pattAddr + offset);
+    colorByte = tmsVramByte(TMS_ARGS colorAddr + offset);
+  }
+  else
+  {
+    uint pattAddr = (tmsReg(TMS_ARGS 4u) & 0x07u) << 11;
+    uint colorAddr = tmsReg(TMS_ARGS 3u) << 6;
+
+    pattByte = tmsVramByte(TMS_ARGS pattAddr + name * 8u + pattRow);
+    colorByte = tmsVramByte(TMS_ARGS colorAddr + name / 8u);
+  }
+
+  bool bitSet = ((pattByte << (x & 7u)) & 0x80u) != 0u;
+  return tmsResolveColor(bitSet ? colorByte >> 4 : colorByte & 0x0fu, backdrop);
+}
+
+// the sprite color at (x, y), or 0 for none. as tmsEvaluateSprites() and
+// vrEmuTms9918OutputSprites(): the first 4 sprites on the line (before a
+// 0xd0 y position) are drawn in order, so later sprites overwrite earlier ones
+uint tmsSpritePixel(TMS_PARAMS uint x, uint y)
+{
+  uint r1 = tmsReg(TMS_ARGS 1u);
+  uint attrAddr = (tmsReg(TMS_ARGS 5u) & 0x7fu) << 7;
+  uint spritePattAddr = (tmsReg(TMS_ARGS 6u) & 0x07u) << 11;
+  bool mag = (r1 & 0x01u) != 0u;
+  int sizePx = ((r1 & 0x02u) != 0u ? 16 : 8) * (mag ? 2 : 1);
+
+  int lineY = int(y);
+  int numOnLine = 0;
+  uint color = 0u;
+
+  for (uint i = 0u; i < 32u; ++i)
+  {
+    uint attr = attrAddr + i * 4u;
+    uint attrY = tmsVramByte(TMS_ARGS attr);
+    if (attrY == 0xd0u)
+    {
+      break;
+    }
+
+    // first row is y position + 1, with 0xe1 - 0xff partly above the top
+    int topY = (attrY > 0xe0u ? int(attrY) - 256 : int(attrY)) + 1;
+
+    // a magnified sprite's row (lineY - topY) / 2 rounds towards zero, so it starts a line early
+    if (lineY < (mag ? topY - 1 : topY) || lineY > topY + sizePx - 1)
+    {
+      continue;
+    }
+
+    // the fifth sprite and beyond aren't drawn
+    if (numOnLine == 4)
+    {
+      break;
+    }
+    ++numOnLine;
+
+    uint colorByte = tmsVramByte(TMS_ARGS attr + 3u);
+    int px = int(x) - (int(tmsVramByte(TMS_ARGS attr + 1u)) - ((colorByte & 0x80u) != 0u ? 32 : 0));
+    if (px < 0 || px >= sizePx || (colorByte & 0x0fu) == 0u)
+    {
+      continue;
+    }
+
+    int row = lineY - topY;
+    int col = px;
+    if (mag)
+    {
+      row = row < 0 ? 0 : row / 2;
+      col = col / 2;
+    }
+
+    // 16x16 sprites: the right half is 2 patterns on
+    uint pattAddr = spritePattAddr + tmsVramByte(TMS_ARGS attr + 2u) * 8u + uint(row);
+    if (col >= 8)
+    {
+      pattAddr += 16u;
+      col -= 8;
+    }
+
+    if (((tmsVramByte(TMS_ARGS pattAddr) << uint(col)) & 0x80u) != 0u)
+    {
+      color = colorByte & 0x0fu;
+    }
+  }
+
+  return color;
+}
+
+// the palette index at (x, y) (0 - 255, 0 - 191), as vrEmuTms9918RenderFrame()
+uint tmsPixel(TMS_PARAMS uint x, uint y)
+{
+  // display disabled: black
+  if ((tmsReg(TMS_ARGS 1u) & 0x40u) == 0u)
+  {
+    return 1u;
+  }
+
+  uint mode = tmsMode(tmsReg(TMS_ARGS 0u), tmsReg(TMS_ARGS 1u));
+  uint color = tmsTilePixel(TMS_ARGS mode, x, y, tmsReg(TMS_ARGS 7u) & 0x0fu);
+
+  // no sprites in text mode
+  if (mode != TMS_MODE_TEXT)
+  {
+    uint spriteColor = tmsSpritePixel(TMS_ARGS x, y);
+    if (spriteColor != 0u)
+    {
+      color = spriteColor;
+    }
+  }
+
+  return color;
+}
+
+// ---- end tms9918 pixel ----
+
+vertex TmsVertexOut tmsVertex(uint vertexId [[vertex_id]])
+{
+  float2 uv = float2(float((vertexId << 1) & 2u), float(vertexId & 2u));
+
+  TmsVertexOut out;
+  out.position = float4(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, 0.0, 1.0);
+  out.screenPos = uv * float2(256.0, 192.0);
+  return out;
+}
+
+fragment float4 tmsFragment(TmsVertexOut in [[stage_in]],
+                            texture2d<uint> vram [[texture(0)]],
+                            constant TmsUniforms& uniforms [[buffer(0)]])
+{
+  int2 pos = clamp(int2(floor(in.screenPos)), int2(0, 0), int2(255, 191));
+  return uniforms.palette[tmsPixel(TMS_ARGS uint(pos.x), uint(pos.y))];
+}
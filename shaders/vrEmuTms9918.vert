@@ -0,0 +1,25 @@
+#version 330 core
+
+/*
+ * Troy's TMS9918 Emulator - GPU reference vertex shader (GLSL 3.30)
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ * a triangle covering the viewport, from gl_VertexID alone (no vertex
+ * buffers), for vrEmuTms9918.frag
+ */
+
+// (0, 0) top left to (256, 192) bottom right
+out vec2 tmsScreenPos;
+
+void main()
+{
+  vec2 uv = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+
+  gl_Position = vec4(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, 0.0, 1.0);
+  tmsScreenPos = uv * vec2(256.0, 192.0);
+}
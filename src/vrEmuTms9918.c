@@ -10,39 +10,40 @@
  */
 
 #include "vrEmuTms9918.h"
+#include "vrEmuTms9918Kernels.h"
+#include "vrEmuTms9918Watch.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <memory.h>
 #include <math.h>
 #include <string.h>
 
-#define VRAM_SIZE           (1 << 14) /* 16KB */
-#define VRAM_MASK     (VRAM_SIZE - 1) /* 0x3fff */
+/* define VR_TMS9918_EMU_TILE_CACHE to keep color-resolved pattern rows for
+   graphics I and II (adds ~48KB to each instance) */
 
-#define GRAPHICS_NUM_COLS         32
-#define GRAPHICS_NUM_ROWS         24
-#define GRAPHICS_CHAR_WIDTH        8
-
-#define TEXT_NUM_COLS             40
-#define TEXT_NUM_ROWS             24
-#define TEXT_CHAR_WIDTH            6
-#define TEXT_PADDING_PX            8
+/* define VR_TMS9918_EMU_WRITE_LOG to queue vrEmuTms9918LogWriteAddr() /
+   vrEmuTms9918LogWriteData() writes until their scanline (adds 4 bytes per
+   entry to each instance). without it, logged writes are applied at once */
+#if VR_TMS9918_EMU_WRITE_LOG
+  /* entries in the write log (up to 65535) */
+  #ifndef VR_TMS9918_EMU_WRITE_LOG_SIZE
+    #define VR_TMS9918_EMU_WRITE_LOG_SIZE 4096
+  #endif
 
-#define PATTERN_BYTES              8
-#define GFXI_COLOR_GROUP_SIZE      8
+  #define TMS_WRITE_LOG_PENDING(tms9918) ((tms9918)->writeLogTail != 0)
+#else
+  #define TMS_WRITE_LOG_PENDING(tms9918) false
+#endif
 
-#define MAX_SPRITES               32
+/* vram, tile and sprite constants are in vrEmuTms9918Kernels.h */
+#define GRAPHICS_NUM_ROWS         24
+#define TEXT_NUM_ROWS             24
 
-#define SPRITE_ATTR_Y              0
-#define SPRITE_ATTR_X              1
-#define SPRITE_ATTR_NAME           2
-#define SPRITE_ATTR_COLOR          3
-#define SPRITE_ATTR_BYTES          4
-#define LAST_SPRITE_YPOS        0xD0
-#define MAX_SCANLINE_SPRITES       4
+#define SPRITE_ATTR_TABLE_BYTES  (MAX_SPRITES * SPRITE_ATTR_BYTES)
+#define PATTERN_TABLE_BYTES   (256 * PATTERN_BYTES)
+#define GFXII_NUM_THIRDS           3
 
 #define STATUS_INT              0x80
-#define STATUS_5S               0x40
-#define STATUS_COL              0x20
 
 #define TMS_R0_MODE_GRAPHICS_II 0x02
 #define TMS_R0_EXT_VDP_ENABLE   0x01
@@ -54,6 +55,69 @@
 #define TMS_R1_SPRITE_16        0x02
 #define TMS_R1_SPRITE_MAG2      0x01
 
+/* vrEmuTms9918SaveState() layout. multi-byte values are little endian */
+#define TMS_STATE_MAGIC         "TMS9"
+#define TMS_STATE_OFS_MAGIC          0
+#define TMS_STATE_OFS_VERSION        4
+#define TMS_STATE_OFS_STATUS         5
+#define TMS_STATE_OFS_WRITE_STAGE    6
+#define TMS_STATE_OFS_ADDRESS        8   /* 2 bytes */
+#define TMS_STATE_OFS_REGISTERS     16   /* TMS_NUM_REGISTERS bytes */
+#define TMS_STATE_OFS_VRAM          TMS9918_STATE_VRAM_OFFSET /* VRAM_SIZE bytes */
+#define TMS_STATE_SIZE          (TMS_STATE_OFS_VRAM + VRAM_SIZE)
+
+#define TMS_LINE_DIRTY          0x01  /* line must be regenerated */
+#define TMS_LINE_SPRITES        0x02  /* line had sprites when last generated */
+
+/* performance counters (see vrEmuTms9918Stats) */
+#if VR_TMS9918_EMU_STATS
+  #define TMS_STATS_ADD(tms9918, counter, n) ((tms9918)->stats.counter += (n))
+#else
+  #define TMS_STATS_ADD(tms9918, counter, n) ((void)0)
+#endif
+#define TMS_STATS_INC(tms9918, counter) TMS_STATS_ADD(tms9918, counter, 1)
+
+/* report to the trace observer, if any. the call is kept out of line, so
+   the port functions stay leaf functions without one */
+#if defined(__GNUC__) || defined(__clang__)
+  #define TMS_UNLIKELY(x) __builtin_expect(!!(x), 0)
+  #define TMS_NOINLINE __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+  #define TMS_UNLIKELY(x) (x)
+  #define TMS_NOINLINE __declspec(noinline)
+#else
+  #define TMS_UNLIKELY(x) (x)
+  #define TMS_NOINLINE
+#endif
+
+#define TMS_TRACE(tms9918, op, value) \
+  (TMS_UNLIKELY((tms9918)->traceFn != NULL) ? tmsTrace((tms9918), (op), (value)) : (void)0)
+
+/* record a block write near a watch (before storing it), and report
+   watched changes at a line or frame boundary. likewise out of line */
+#define TMS_WATCH_WRITE(tms9918, addr, data, numBytes) \
+  (TMS_UNLIKELY(tmsWatchHit(&(tms9918)->watches, (addr), (numBytes))) ? \
+    tmsWatchWritten((tms9918), (addr), (data), (numBytes)) : (void)0)
+#define TMS_WATCH_FLUSH(tms9918, frame) \
+  (TMS_UNLIKELY((tms9918)->watches.pending != 0) ? tmsWatchFlush((tms9918), (frame)) : (void)0)
+
+/* kernel specializations (beyond the TMS_KERNEL_SPRITE_* flags) */
+#define TMS_KERNEL_GFXII_INVALID 0x04
+#define TMS_KERNEL_PIXELS_ONLY  0x08  /* no status, stats or cache updates (safe to run concurrently) */
+#define TMS_KERNEL_LAYERS       0x10  /* also output layerMask / layerSpriteMask (see vrEmuTms9918ScanLineLayers) */
+
+/* scanline generator (or sprite output) kernel */
+typedef void (*tmsScanLineFn)(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X]);
+
+ /* a queued port write
+  * ---------------------- */
+typedef struct
+{
+  uint16_t line;  /* apply before generating this scanline */
+  uint8_t isAddr; /* WriteAddr (mode = 1), otherwise WriteData */
+  uint8_t data;
+} tmsLoggedWrite;
+
  /* PRIVATE DATA STRUCTURE
   * ---------------------- */
 struct vrEmuTMS9918_s
@@ -73,16 +137,133 @@ struct vrEmuTMS9918_s
   /* current display mode */
   vrEmuTms9918Mode mode;
 
+  /* kernels for the current mode and sprite settings (selected on register write) */
+  tmsScanLineFn scanLineFn;
+  tmsScanLineFn spritesFn;  /* status only */
+  tmsScanLineFn pixelsFn;   /* TMS_KERNEL_PIXELS_ONLY scanLineFn */
+  tmsScanLineFn layersFn;   /* TMS_KERNEL_LAYERS scanLineFn */
+
+  /* layer mask outputs of the current layersFn call (spriteMask optional) */
+  uint8_t* layerMask;
+  uint8_t* layerSpriteMask;
+
+  /* table base addresses (decoded on register write) */
+  uint16_t nameTableAddr;
+  uint16_t colorTableAddr;
+  uint16_t patternTableAddr;
+  uint16_t spriteAttrTableAddr;
+  uint16_t spritePatternTableAddr;
+
+  /* table sizes (bytes) for the current mode */
+  uint16_t nameTableBytes;
+  uint16_t colorTableBytes;
+  uint16_t patternTableBytes;
+
+  /* color table bytes resolved against the backdrop (rebuilt when R1 or R7 change it) */
+  tmsColorPairs colorPairs;
+
+  /* per-scanline sprite lists (rebuilt when the attribute table or registers change) */
+  tmsSpriteLine spriteLines[TMS9918_PIXELS_Y];
+  bool spriteLinesValid;
+
+  /* changes since the last vrEmuTms9918RenderFrameIncremental() */
+  uint8_t lineFlags[TMS9918_PIXELS_Y];
+  uint8_t patternRowsDirty[GFXII_NUM_THIRDS][256]; /* bit per pattern row */
+  bool patternsDirty;
+  bool spritesDirty;
+
+  /* bit per TMS9918_VRAM_PAGE_BYTES page written since vrEmuTms9918VramPagesWritten() or
+     vrEmuTms9918UploadVram() last took the mask. each also keeps the pages the other took
+     that it hasn't seen yet, so the write paths only update the one mask */
+  uint64_t vramPagesWritten;
+  uint64_t vramPagesUnseenWritten;
+  uint64_t vramPagesUnseenUpload;
+
+#if VR_TMS9918_EMU_TILE_CACHE
+  /* color-resolved graphics I / II pattern rows [third][pattern][row]
+     (graphics I only uses the first third) */
+  uint8_t tileCache[GFXII_NUM_THIRDS][256][PATTERN_BYTES][GRAPHICS_CHAR_WIDTH];
+  uint8_t tileCacheRowsValid[GFXII_NUM_THIRDS][256]; /* bit per pattern row */
+#endif
+
+#if VR_TMS9918_EMU_STATS
+  vrEmuTms9918Stats stats;
+  uint64_t (*statsClockFn)(void);
+  bool frameInProgress; /* generated a line other than the last */
+#endif
+
+  /* port access and frame timing observer (vrEmuTms9918SetTraceFn) */
+  vrEmuTms9918TraceFn traceFn;
+  void* traceContext;
+
+  /* vram watchpoints (vrEmuTms9918AddWatch) */
+  tmsWatchSet watches;
+  vrEmuTms9918WatchFn watchFns[TMS9918_MAX_WATCHES];
+  void* watchContexts[TMS9918_MAX_WATCHES];
+
+#if VR_TMS9918_EMU_WRITE_LOG
+  /* queued writes. writeLog[writeLogHead] to writeLog[writeLogTail - 1] */
+  uint16_t writeLogHead;
+  uint16_t writeLogTail;
+  tmsLoggedWrite writeLog[VR_TMS9918_EMU_WRITE_LOG_SIZE];
+#endif
+
   /* video ram */
   uint8_t vram[VRAM_SIZE];
 };
 
 
+/* Function:  tmsTrace
+ * ----------------------------------------
+ * report to the trace observer
+ */
+static TMS_NOINLINE void tmsTrace(const VrEmuTms9918* tms9918, vrEmuTms9918TraceOp op, uint8_t value)
+{
+  tms9918->traceFn(tms9918->traceContext, op, value);
+}
+
+/* Function:  tmsWatchWritten
+ * ----------------------------------------
+ * record a write near a watch
+ */
+static TMS_NOINLINE void tmsWatchWritten(VrEmuTms9918* tms9918, uint16_t addr, const uint8_t* data, uint16_t numBytes)
+{
+  tmsWatchWrite(&tms9918->watches, tms9918->vram, addr, data, numBytes);
+}
+
+/* Function:  tmsWatchFlush
+ * ----------------------------------------
+ * report the changes of watches due at a line (or frame) boundary
+ */
+static TMS_NOINLINE void tmsWatchFlush(VrEmuTms9918* tms9918, bool frame)
+{
+  const uint8_t due = tmsWatchDue(&tms9918->watches, frame);
+
+  for (uint8_t i = 0; i < TMS9918_MAX_WATCHES; ++i)
+  {
+    /* callbacks may add or remove watches */
+    const uint8_t bit = (uint8_t)(1 << i);
+    if ((due & bit) == 0 || (tms9918->watches.pending & bit) == 0)
+      continue;
+
+    tmsWatch* watch = &tms9918->watches.watches[i];
+
+    vrEmuTms9918VramRange ranges[TMS9918_WATCH_MAX_RANGES];
+    const uint8_t numRanges = watch->numRanges;
+    memcpy(ranges, watch->ranges, numRanges * sizeof(ranges[0]));
+
+    watch->numRanges = 0;
+    tms9918->watches.pending &= (uint8_t)~bit;
+
+    tms9918->watchFns[i](tms9918->watchContexts[i], ranges, numRanges);
+  }
+}
+
 /* Function:  tmsMode
  * ----------------------------------------
  * return the current display mode
  */
-static vrEmuTms9918Mode tmsMode(VrEmuTms9918* tms9918)
+static vrEmuTms9918Mode tmsMode(const VrEmuTms9918* tms9918)
 {
   if (tms9918->registers[TMS_REG_0] & TMS_R0_MODE_GRAPHICS_II)
   {
@@ -109,7 +290,7 @@ static vrEmuTms9918Mode tmsMode(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * sprite size (8 or 16)
  */
-static inline uint8_t tmsSpriteSize(VrEmuTms9918* tms9918)
+static inline uint8_t tmsSpriteSize(const VrEmuTms9918* tms9918)
 {
   return tms9918->registers[TMS_REG_1] & TMS_R1_SPRITE_16 ? 16 : 8;
 }
@@ -118,7 +299,7 @@ static inline uint8_t tmsSpriteSize(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * sprite size (0 = 1x, 1 = 2x)
  */
-static inline bool tmsSpriteMag(VrEmuTms9918* tms9918)
+static inline bool tmsSpriteMag(const VrEmuTms9918* tms9918)
 {
   return tms9918->registers[TMS_REG_1] & TMS_R1_SPRITE_MAG2;
 }
@@ -127,7 +308,7 @@ static inline bool tmsSpriteMag(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * name table base address
  */
-static inline uint16_t tmsNameTableAddr(VrEmuTms9918* tms9918)
+static inline uint16_t tmsNameTableAddr(const VrEmuTms9918* tms9918)
 {
   return (tms9918->registers[TMS_REG_NAME_TABLE] & 0x0f) << 10;
 }
@@ -136,7 +317,7 @@ static inline uint16_t tmsNameTableAddr(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * color table base address
  */
-static inline uint16_t tmsColorTableAddr(VrEmuTms9918* tms9918)
+static inline uint16_t tmsColorTableAddr(const VrEmuTms9918* tms9918)
 {
   const uint8_t mask = (tms9918->mode == TMS_MODE_GRAPHICS_II) ? 0x80 : 0xff;
 
@@ -147,7 +328,7 @@ static inline uint16_t tmsColorTableAddr(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * pattern table base address
  */
-static inline uint16_t tmsPatternTableAddr(VrEmuTms9918* tms9918)
+static inline uint16_t tmsPatternTableAddr(const VrEmuTms9918* tms9918)
 {
   const uint8_t mask = (tms9918->mode == TMS_MODE_GRAPHICS_II) ? 0x04 : 0x07;
 
@@ -158,7 +339,7 @@ static inline uint16_t tmsPatternTableAddr(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * sprite attribute table base address
  */
-static inline uint16_t tmsSpriteAttrTableAddr(VrEmuTms9918* tms9918)
+static inline uint16_t tmsSpriteAttrTableAddr(const VrEmuTms9918* tms9918)
 {
   return (tms9918->registers[TMS_REG_SPRITE_ATTR_TABLE] & 0x7f) << 7;
 }
@@ -167,50 +348,292 @@ static inline uint16_t tmsSpriteAttrTableAddr(VrEmuTms9918* tms9918)
  * ----------------------------------------
  * sprite pattern table base address
  */
-static inline uint16_t tmsSpritePatternTableAddr(VrEmuTms9918* tms9918)
+static inline uint16_t tmsSpritePatternTableAddr(const VrEmuTms9918* tms9918)
 {
   return (tms9918->registers[TMS_REG_SPRITE_PATT_TABLE] & 0x07) << 11;
 }
 
-/* Function:  tmsBgColor
+/* Function:  tmsMainBgColor
  * ----------------------------------------
  * background color
  */
-static inline vrEmuTms9918Color tmsMainBgColor(VrEmuTms9918* tms9918)
+static inline vrEmuTms9918Color tmsMainBgColor(const VrEmuTms9918* tms9918)
 {
-  return (vrEmuTms9918Color)((vrEmuTms9918DisplayEnabled(tms9918) 
+  return (vrEmuTms9918Color)(((tms9918->registers[TMS_REG_1] & TMS_R1_DISP_ACTIVE)
             ? tms9918->registers[TMS_REG_FG_BG_COLOR]
             : TMS_BLACK) & 0x0f);
 }
 
-/* Function:  tmsFgColor
+/* Function:  tmsInvalidGfxII
  * ----------------------------------------
- * foreground color
+ * are the graphics II pattern and color table masks invalid?
  */
-static inline vrEmuTms9918Color tmsMainFgColor(VrEmuTms9918* tms9918)
+static inline bool tmsInvalidGfxII(const VrEmuTms9918* tms9918)
 {
-  const vrEmuTms9918Color c = (vrEmuTms9918Color)(tms9918->registers[TMS_REG_FG_BG_COLOR] >> 4);
-  return c == TMS_TRANSPARENT ? tmsMainBgColor(tms9918) : c;
+  return (tms9918->registers[TMS_REG_PATTERN_TABLE] & 0x03) != 0x03 ||
+         (tms9918->registers[TMS_REG_COLOR_TABLE] & 0x7f) != 0x7f;
 }
 
-/* Function:  tmsFgColor
+/* Function:  tmsInvalidateFrame
  * ----------------------------------------
- * foreground color
+ * mark every line as needing to be regenerated
  */
-static inline vrEmuTms9918Color tmsFgColor(VrEmuTms9918* tms9918, uint8_t colorByte)
+static void tmsInvalidateFrame(VrEmuTms9918* tms9918)
 {
-  const vrEmuTms9918Color c = (vrEmuTms9918Color)(colorByte >> 4);
-  return c == TMS_TRANSPARENT ? tmsMainBgColor(tms9918) : c;
+  for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+  {
+    tms9918->lineFlags[y] |= TMS_LINE_DIRTY;
+  }
 }
 
-/* Function:  tmsBgColor
+static void tmsSelectKernels(VrEmuTms9918* tms9918);
+
+/* Function:  tmsUpdateRegisterState
  * ----------------------------------------
- * background color
+ * update state derived from the registers. called on any register change
+ */
+static void tmsUpdateRegisterState(VrEmuTms9918* tms9918)
+{
+  tms9918->mode = tmsMode(tms9918);
+
+  tms9918->nameTableAddr = tmsNameTableAddr(tms9918);
+  tms9918->colorTableAddr = tmsColorTableAddr(tms9918);
+  tms9918->patternTableAddr = tmsPatternTableAddr(tms9918);
+  tms9918->spriteAttrTableAddr = tmsSpriteAttrTableAddr(tms9918);
+  tms9918->spritePatternTableAddr = tmsSpritePatternTableAddr(tms9918);
+
+  switch (tms9918->mode)
+  {
+    case TMS_MODE_GRAPHICS_II:
+      tms9918->nameTableBytes = GRAPHICS_NUM_COLS * GRAPHICS_NUM_ROWS;
+      tms9918->colorTableBytes = PATTERN_TABLE_BYTES * GFXII_NUM_THIRDS;
+      tms9918->patternTableBytes = PATTERN_TABLE_BYTES * GFXII_NUM_THIRDS;
+      break;
+
+    case TMS_MODE_TEXT:
+      tms9918->nameTableBytes = TEXT_NUM_COLS * TEXT_NUM_ROWS;
+      tms9918->colorTableBytes = 0;
+      tms9918->patternTableBytes = PATTERN_TABLE_BYTES;
+      break;
+
+    case TMS_MODE_MULTICOLOR:
+      tms9918->nameTableBytes = GRAPHICS_NUM_COLS * GRAPHICS_NUM_ROWS;
+      tms9918->colorTableBytes = 0;
+      tms9918->patternTableBytes = PATTERN_TABLE_BYTES;
+      break;
+
+    default:
+      tms9918->nameTableBytes = GRAPHICS_NUM_COLS * GRAPHICS_NUM_ROWS;
+      tms9918->colorTableBytes = 256 / GFXI_COLOR_GROUP_SIZE;
+      tms9918->patternTableBytes = PATTERN_TABLE_BYTES;
+      break;
+  }
+
+  /* only a backdrop change (display blanking or R7) resolves colors differently */
+  if (tms9918->colorPairs.backdrop != tmsMainBgColor(tms9918))
+  {
+    tmsColorPairsInit(&tms9918->colorPairs, tmsMainBgColor(tms9918));
+  }
+
+  tmsSelectKernels(tms9918);
+
+  tms9918->spriteLinesValid = false;
+  tmsInvalidateFrame(tms9918);
+
+#if VR_TMS9918_EMU_TILE_CACHE
+  memset(tms9918->tileCacheRowsValid, 0, sizeof(tms9918->tileCacheRowsValid));
+#endif
+}
+
+/* Function:  tmsWriteRegister
+ * ----------------------------------------
+ * write a register value
+ */
+static inline void tmsWriteRegister(VrEmuTms9918* tms9918, uint8_t reg, uint8_t value)
+{
+  reg &= 0x07;
+  TMS_STATS_INC(tms9918, registerWrites);
+
+  if (tms9918->registers[reg] != value)
+  {
+#if VR_TMS9918_EMU_STATS
+    const vrEmuTms9918Mode oldMode = tms9918->mode;
+#endif
+
+    tms9918->registers[reg] = value;
+    tmsUpdateRegisterState(tms9918);
+
+#if VR_TMS9918_EMU_STATS
+    if (tms9918->mode != oldMode)
+    {
+      TMS_STATS_INC(tms9918, modeSwitches);
+      if (tms9918->frameInProgress)
+      {
+        TMS_STATS_INC(tms9918, midFrameModeSwitches);
+      }
+    }
+#endif
+  }
+}
+
+/* Function:  tmsPatternRowsWritten
+ * ----------------------------------------
+ * pattern (or graphics II color) rows have changed. patt includes the
+ * graphics II third (0 - 767)
+ */
+static inline void tmsPatternRowsWritten(VrEmuTms9918* tms9918, uint16_t patt, uint8_t rows)
+{
+  /* resolved to lines later, from the name table. see tmsResolveDirtyLines() */
+  tms9918->patternRowsDirty[patt >> 8][patt & 0xff] |= rows;
+  tms9918->patternsDirty = true;
+
+#if VR_TMS9918_EMU_TILE_CACHE
+  tms9918->tileCacheRowsValid[patt >> 8][patt & 0xff] &= ~rows;
+#endif
+}
+
+/* Function:  tmsNameRowsWritten
+ * ----------------------------------------
+ * name table rows (firstRow to lastRow inclusive) have changed
+ */
+static inline void tmsNameRowsWritten(VrEmuTms9918* tms9918, uint8_t firstRow, uint8_t lastRow)
+{
+  for (uint8_t y = firstRow * PATTERN_BYTES; y < (lastRow + 1) * PATTERN_BYTES; ++y)
+  {
+    tms9918->lineFlags[y] |= TMS_LINE_DIRTY;
+  }
+}
+
+/* Function:  tmsVramWritten
+ * ----------------------------------------
+ * track a vram write against the active tables
+ */
+static inline void tmsVramWritten(VrEmuTms9918* tms9918, uint16_t addr)
+{
+  tms9918->vramPagesWritten |= (uint64_t)1 << (addr / TMS9918_VRAM_PAGE_BYTES);
+
+  if ((uint16_t)(addr - tms9918->spriteAttrTableAddr) < SPRITE_ATTR_TABLE_BYTES)
+  {
+    tms9918->spriteLinesValid = false;
+    tms9918->spritesDirty = true;
+  }
+  else if ((uint16_t)(addr - tms9918->spritePatternTableAddr) < PATTERN_TABLE_BYTES)
+  {
+    tms9918->spritesDirty = true;
+  }
+
+  const uint16_t nameOffset = addr - tms9918->nameTableAddr;
+  if (nameOffset < tms9918->nameTableBytes)
+  {
+    const uint8_t numCols = (tms9918->mode == TMS_MODE_TEXT) ? TEXT_NUM_COLS : GRAPHICS_NUM_COLS;
+    tmsNameRowsWritten(tms9918, nameOffset / numCols, nameOffset / numCols);
+  }
+
+  const uint16_t pattOffset = addr - tms9918->patternTableAddr;
+  if (pattOffset < tms9918->patternTableBytes)
+  {
+    tmsPatternRowsWritten(tms9918, pattOffset / PATTERN_BYTES, 1 << (pattOffset & 0x07));
+  }
+
+  const uint16_t colorOffset = addr - tms9918->colorTableAddr;
+  if (colorOffset < tms9918->colorTableBytes)
+  {
+    if (tms9918->mode == TMS_MODE_GRAPHICS_II)
+    {
+      tmsPatternRowsWritten(tms9918, colorOffset / PATTERN_BYTES, 1 << (colorOffset & 0x07));
+    }
+    else
+    {
+      for (uint8_t i = 0; i < GFXI_COLOR_GROUP_SIZE; ++i)
+      {
+        tmsPatternRowsWritten(tms9918, colorOffset * GFXI_COLOR_GROUP_SIZE + i, 0xff);
+      }
+    }
+  }
+}
+
+/* Function:  tmsTableOverlap
+ * ----------------------------------------
+ * find the offsets [*first, *last] of a table covered by a block of vram
+ */
+static inline bool tmsTableOverlap(uint16_t addr, uint16_t numBytes, uint16_t tableAddr, uint16_t tableBytes,
+                                   uint16_t* first, uint16_t* last)
+{
+  const uint32_t start = addr > tableAddr ? addr : tableAddr;
+  const uint32_t end = ((uint32_t)addr + numBytes < (uint32_t)tableAddr + tableBytes)
+                         ? (uint32_t)addr + numBytes
+                         : (uint32_t)tableAddr + tableBytes;
+
+  if (start >= end)
+    return false;
+
+  *first = (uint16_t)(start - tableAddr);
+  *last = (uint16_t)(end - 1 - tableAddr);
+  return true;
+}
+
+/* Function:  tmsPatternBlockWritten
+ * ----------------------------------------
+ * pattern (or graphics II color) table offsets [first, last] have changed
+ */
+static void tmsPatternBlockWritten(VrEmuTms9918* tms9918, uint16_t first, uint16_t last)
+{
+  for (uint16_t patt = first / PATTERN_BYTES; patt <= last / PATTERN_BYTES; ++patt)
+  {
+    const uint16_t pattAddr = patt * PATTERN_BYTES;
+    const uint8_t firstRow = (first > pattAddr) ? first - pattAddr : 0;
+    const uint8_t lastRow = (last < pattAddr + PATTERN_BYTES - 1) ? last - pattAddr : PATTERN_BYTES - 1;
+
+    tmsPatternRowsWritten(tms9918, patt, (uint8_t)((0xff << firstRow) & (0xff >> (7 - lastRow))));
+  }
+}
+
+/* Function:  tmsVramBlockWritten
+ * ----------------------------------------
+ * track a block vram write (no wrapping) against the active tables
  */
-static inline vrEmuTms9918Color tmsBgColor(VrEmuTms9918* tms9918, uint8_t colorByte)
+static void tmsVramBlockWritten(VrEmuTms9918* tms9918, uint16_t addr, uint16_t numBytes)
 {
-  const vrEmuTms9918Color c = (vrEmuTms9918Color)(colorByte & 0x0f);
-  return c == TMS_TRANSPARENT ? tmsMainBgColor(tms9918) : c;
+  uint16_t first, last;
+
+  const uint8_t firstPage = addr / TMS9918_VRAM_PAGE_BYTES;
+  const uint8_t lastPage = (addr + numBytes - 1) / TMS9918_VRAM_PAGE_BYTES;
+  tms9918->vramPagesWritten |= (~(uint64_t)0 >> (63 - lastPage)) & (~(uint64_t)0 << firstPage);
+
+  if (tmsTableOverlap(addr, numBytes, tms9918->spriteAttrTableAddr, SPRITE_ATTR_TABLE_BYTES, &first, &last))
+  {
+    tms9918->spriteLinesValid = false;
+    tms9918->spritesDirty = true;
+  }
+
+  if (tmsTableOverlap(addr, numBytes, tms9918->spritePatternTableAddr, PATTERN_TABLE_BYTES, &first, &last))
+  {
+    tms9918->spritesDirty = true;
+  }
+
+  if (tmsTableOverlap(addr, numBytes, tms9918->nameTableAddr, tms9918->nameTableBytes, &first, &last))
+  {
+    const uint8_t numCols = (tms9918->mode == TMS_MODE_TEXT) ? TEXT_NUM_COLS : GRAPHICS_NUM_COLS;
+    tmsNameRowsWritten(tms9918, first / numCols, last / numCols);
+  }
+
+  if (tmsTableOverlap(addr, numBytes, tms9918->patternTableAddr, tms9918->patternTableBytes, &first, &last))
+  {
+    tmsPatternBlockWritten(tms9918, first, last);
+  }
+
+  if (tmsTableOverlap(addr, numBytes, tms9918->colorTableAddr, tms9918->colorTableBytes, &first, &last))
+  {
+    if (tms9918->mode == TMS_MODE_GRAPHICS_II)
+    {
+      tmsPatternBlockWritten(tms9918, first, last);
+    }
+    else
+    {
+      tmsPatternBlockWritten(tms9918, first * GFXI_COLOR_GROUP_SIZE * PATTERN_BYTES,
+                             (last + 1) * GFXI_COLOR_GROUP_SIZE * PATTERN_BYTES - 1);
+    }
+  }
 }
 
 
@@ -220,11 +643,63 @@ static inline vrEmuTms9918Color tmsBgColor(VrEmuTms9918* tms9918, uint8_t colorB
  */
 VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918* vrEmuTms9918New()
 {
-  VrEmuTms9918* tms9918 = (VrEmuTms9918*)malloc(sizeof(VrEmuTms9918));
-  if (tms9918 != NULL)
-  {
-    vrEmuTms9918Reset(tms9918);
- }
+  return vrEmuTms9918Init(malloc(sizeof(VrEmuTms9918)));
+}
+
+/* alignment of VrEmuTms9918 (a C99 alignof) */
+typedef struct { char c; VrEmuTms9918 tms9918; } tmsAlignProbe;
+#define TMS_ALIGNOF offsetof(tmsAlignProbe, tms9918)
+
+/* malloc() (and TMS9918_MAX_ALIGN aligned memory) must be suitable */
+typedef char tmsAlignCheck[(TMS_ALIGNOF <= TMS9918_MAX_ALIGN) ? 1 : -1];
+
+/* Function:  vrEmuTms9918SizeOf
+ * ----------------------------------------
+ * bytes required by vrEmuTms9918Init()
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918SizeOf(void)
+{
+  return sizeof(VrEmuTms9918);
+}
+
+/* Function:  vrEmuTms9918AlignOf
+ * ----------------------------------------
+ * alignment required by vrEmuTms9918Init()
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918AlignOf(void)
+{
+  return TMS_ALIGNOF;
+}
+
+/* Function:  vrEmuTms9918Init
+ * ----------------------------------------
+ * create a TMS9918 in caller provided memory
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918* vrEmuTms9918Init(void* mem)
+{
+  if (mem == NULL || ((uintptr_t)mem % TMS_ALIGNOF) != 0)
+    return NULL;
+
+  VrEmuTms9918* tms9918 = (VrEmuTms9918*)mem;
+
+#if VR_TMS9918_EMU_STATS
+  tms9918->statsClockFn = NULL;
+#endif
+
+  tms9918->traceFn = NULL;
+  tms9918->traceContext = NULL;
+
+  tmsWatchSetInit(&tms9918->watches);
+
+  /* not a backdrop, so the first register update resolves the colors */
+  tms9918->colorPairs.backdrop = 0xff;
+
+  /* vram contents are unknown */
+  tms9918->vramPagesWritten = ~(uint64_t)0;
+  tms9918->vramPagesUnseenWritten = 0;
+  tms9918->vramPagesUnseenUpload = 0;
+
+  vrEmuTms9918Reset(tms9918);
 
   return tms9918;
 }
@@ -244,7 +719,19 @@ VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918Reset(VrEmuTms9918* tms9918)
 
     /* ram intentionally left in unknown state */
 
-    tms9918->mode = tmsMode(tms9918);
+    memset(tms9918->lineFlags, 0, sizeof(tms9918->lineFlags));
+    memset(tms9918->patternRowsDirty, 0, sizeof(tms9918->patternRowsDirty));
+    tms9918->patternsDirty = false;
+    tms9918->spritesDirty = false;
+
+#if VR_TMS9918_EMU_WRITE_LOG
+    tms9918->writeLogHead = 0;
+    tms9918->writeLogTail = 0;
+#endif
+
+    tmsUpdateRegisterState(tms9918);
+
+    vrEmuTms9918ResetStats(tms9918);
   }
 }
 
@@ -273,6 +760,8 @@ VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WriteAddr(VrEmuTms9918* tms9918, uint8
 {
   if (tms9918 == NULL) return;
 
+  TMS_TRACE(tms9918, TMS_TRACE_WRITE_ADDR, data);
+
   if (tms9918->regWriteStage == 0)
   {
     /* first stage byte - either an address LSB or a register value */
@@ -286,9 +775,7 @@ VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WriteAddr(VrEmuTms9918* tms9918, uint8
 
     if (data & 0x80) /* register */
     {
-      tms9918->registers[data & 0x07] = tms9918->currentAddress & 0xff;
-
-      tms9918->mode = tmsMode(tms9918);
+      tmsWriteRegister(tms9918, data, tms9918->currentAddress & 0xff);
     }
     else /* address */
     {
@@ -306,13 +793,30 @@ VR_EMU_TMS9918_DLLEXPORT uint8_t vrEmuTms9918ReadStatus(VrEmuTms9918* tms9918)
 {
   if (tms9918 == NULL) return 0;
 
+  TMS_STATS_INC(tms9918, statusReads);
+
   const uint8_t tmpStatus = tms9918->status;
   tms9918->status = 0;
   tms9918->regWriteStage = 0;
+
+  TMS_TRACE(tms9918, TMS_TRACE_READ_STATUS, tmpStatus);
   return tmpStatus;
 }
 
 
+/* Function:  tmsWatchedWriteData
+ * ----------------------------------------
+ * vrEmuTms9918WriteData() for an address near a watch. out of line (and
+ * a tail call), so the common path stays a leaf function
+ */
+static TMS_NOINLINE void tmsWatchedWriteData(VrEmuTms9918* tms9918, uint16_t addr, uint8_t data)
+{
+  tmsWatchWrite(&tms9918->watches, tms9918->vram, addr, &data, 1);
+  tms9918->vram[addr] = data;
+
+  tmsVramWritten(tms9918, addr);
+}
+
 /* Function:  vrEmuTms9918WriteData
  * ----------------------------------------
  * write data (mode = 0) to the tms9918
@@ -323,7 +827,20 @@ VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WriteData(VrEmuTms9918* tms9918, uint8
 {
   if (tms9918 == NULL) return;
 
-  tms9918->vram[(tms9918->currentAddress++) & VRAM_MASK] = data;
+  TMS_STATS_INC(tms9918, dataWrites);
+  TMS_TRACE(tms9918, TMS_TRACE_WRITE_DATA, data);
+
+  const uint16_t addr = (tms9918->currentAddress++) & VRAM_MASK;
+
+  if (TMS_UNLIKELY(tmsWatchHit(&tms9918->watches, addr, 1)))
+  {
+    tmsWatchedWriteData(tms9918, addr, data);
+    return;
+  }
+
+  tms9918->vram[addr] = data;
+
+  tmsVramWritten(tms9918, addr);
 }
 
 
@@ -335,7 +852,12 @@ VR_EMU_TMS9918_DLLEXPORT uint8_t vrEmuTms9918ReadData(VrEmuTms9918* tms9918)
 {
   if (tms9918 == NULL) return 0;
 
-  return tms9918->vram[(tms9918->currentAddress++) & VRAM_MASK];
+  TMS_STATS_INC(tms9918, dataReads);
+
+  const uint8_t value = tms9918->vram[(tms9918->currentAddress++) & VRAM_MASK];
+
+  TMS_TRACE(tms9918, TMS_TRACE_READ_DATA, value);
+  return value;
 }
 
 /* Function:  vrEmuTms9918ReadDataNoInc
@@ -346,316 +868,1243 @@ VR_EMU_TMS9918_DLLEXPORT uint8_t vrEmuTms9918ReadDataNoInc(VrEmuTms9918* tms9918
 {
   if (tms9918 == NULL) return 0;
 
+  TMS_STATS_INC(tms9918, dataReads);
+
   return tms9918->vram[tms9918->currentAddress & VRAM_MASK];
 }
 
-/* Function:  vrEmuTms9918OutputSprites
+/* Function:  vrEmuTms9918WriteBlock
  * ----------------------------------------
- * Output Sprites to a scanline
+ * write a block of data (mode = 0) to the tms9918
  */
-static void vrEmuTms9918OutputSprites(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WriteBlock(VrEmuTms9918* tms9918, const uint8_t* data, size_t numBytes)
 {
-  const uint8_t spriteSizePx = tmsSpriteSize(tms9918) * (tmsSpriteMag(tms9918) ? 2 : 1);
-  const uint16_t spriteAttrTableAddr = tmsSpriteAttrTableAddr(tms9918);
-  const uint16_t spritePatternAddr = tmsSpritePatternTableAddr(tms9918);
+  if (tms9918 == NULL || data == NULL) return;
 
-  uint8_t rowSpriteBits[TMS9918_PIXELS_X]; /* collision mask */
-  uint8_t spritesShown = 0;
+  TMS_STATS_ADD(tms9918, dataWrites, numBytes);
 
-  if (y == 0)
+  if (tms9918->traceFn)
   {
-    tms9918->status = 0;
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+      tms9918->traceFn(tms9918->traceContext, TMS_TRACE_WRITE_DATA, data[i]);
+    }
   }
 
-  for (uint8_t spriteIdx = 0; spriteIdx < MAX_SPRITES; ++spriteIdx)
-  {
-    const uint16_t spriteAttrAddr = spriteAttrTableAddr + spriteIdx * SPRITE_ATTR_BYTES;
-    const uint8_t *spriteAttr = tms9918->vram + spriteAttrAddr;
-
-    int16_t yPos = spriteAttr[SPRITE_ATTR_Y];
+  /* address is left where byte-wise writes would have left it */
+  uint16_t addr = tms9918->currentAddress;
+  tms9918->currentAddress += (uint16_t)numBytes;
 
-    /* stop processing when yPos == LAST_SPRITE_YPOS */
-    if (yPos == LAST_SPRITE_YPOS)
-    {
-      if ((tms9918->status & STATUS_5S) == 0)
-      {
-        tms9918->status |= spriteIdx;
-      }
-      break;
-    }
+  /* only the final VRAM_SIZE bytes survive */
+  if (numBytes > VRAM_SIZE)
+  {
+    addr += (uint16_t)(numBytes - VRAM_SIZE);
+    data += numBytes - VRAM_SIZE;
+    numBytes = VRAM_SIZE;
+  }
 
-    /* check if sprite position is in the -31 to 0 range and move back to top */
-    if (yPos > (uint8_t)-32)
-    {
-      yPos -= 256;
-    }
+  while (numBytes)
+  {
+    addr &= VRAM_MASK;
 
-    /* first row is YPOS -1 (0xff). 2nd row is YPOS 0 */
-    yPos += 1;
+    uint16_t chunkBytes = VRAM_SIZE - addr;
+    if (chunkBytes > numBytes) chunkBytes = (uint16_t)numBytes;
 
-    int16_t pattRow = y - yPos;
-    if (tmsSpriteMag(tms9918))
-    {
-      pattRow /= 2;
-    }
+    TMS_WATCH_WRITE(tms9918, addr, data, chunkBytes);
+    memcpy(tms9918->vram + addr, data, chunkBytes);
+    tmsVramBlockWritten(tms9918, addr, chunkBytes);
 
-    /* check if sprite is visible on this line */
-    if (pattRow < 0 || pattRow >= tmsSpriteSize(tms9918))
-      continue;
+    addr += chunkBytes;
+    data += chunkBytes;
+    numBytes -= chunkBytes;
+  }
+}
 
-    vrEmuTms9918Color spriteColor = spriteAttr[SPRITE_ATTR_COLOR] & 0x0f;
+/* Function:  vrEmuTms9918ReadBlock
+ * ----------------------------------------
+ * read a block of data (mode = 0) from the tms9918
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918ReadBlock(VrEmuTms9918* tms9918, uint8_t* data, size_t numBytes)
+{
+  if (tms9918 == NULL || data == NULL) return;
 
-    if (spritesShown == 0 && (tms9918->status & STATUS_COL) == 0)
-    {
-      /* if we're showing the first sprite, clear the bit buffer */
-      memset(rowSpriteBits, 0, TMS9918_PIXELS_X);
-    }
+  TMS_STATS_ADD(tms9918, dataReads, numBytes);
 
-    /* have we exceeded the scanline sprite limit? */
-    if (++spritesShown > MAX_SCANLINE_SPRITES)
-    {
-      if ((tms9918->status & STATUS_5S) == 0)
-      {
-        tms9918->status |= STATUS_5S | spriteIdx;
-      }
-      break;
-    }
+  /* address is left where byte-wise reads would have left it */
+  uint16_t addr = tms9918->currentAddress;
+  tms9918->currentAddress += (uint16_t)numBytes;
 
-    /* sprite is visible on this line */
-    const uint8_t pattIdx = spriteAttr[SPRITE_ATTR_NAME];
-    const uint16_t pattOffset = spritePatternAddr + pattIdx * PATTERN_BYTES + (uint16_t)pattRow;
+  while (numBytes)
+  {
+    addr &= VRAM_MASK;
 
-    const int16_t earlyClockOffset = (spriteAttr[SPRITE_ATTR_COLOR] & 0x80) ? -32 : 0;
-    const int16_t xPos = (int16_t)(spriteAttr[SPRITE_ATTR_X]) + earlyClockOffset;
+    uint16_t chunkBytes = VRAM_SIZE - addr;
+    if (chunkBytes > numBytes) chunkBytes = (uint16_t)numBytes;
 
-    uint8_t pattByte = tms9918->vram[pattOffset];
-    uint8_t screenBit = 0, pattBit = 0;
+    memcpy(data, tms9918->vram + addr, chunkBytes);
 
-    for (int16_t screenX = xPos; screenX < (xPos + spriteSizePx); ++screenX, ++screenBit)
+    if (tms9918->traceFn)
     {
-      if (screenX >= TMS9918_PIXELS_X)
-      {
-        break;
-      }
-
-      if (screenX >= 0)
+      for (uint16_t i = 0; i < chunkBytes; ++i)
       {
-        if (pattByte & (0x80 >> pattBit))
-        {
-          /* we still process transparent sprites, since
-             they're used in 5S and collision checks */
-          if (spriteColor != TMS_TRANSPARENT)
-          {
-            pixels[screenX] = spriteColor;
-          }
-
-          if (rowSpriteBits[screenX])
-          {
-            tms9918->status |= STATUS_COL;
-          }
-          rowSpriteBits[screenX] = 1;
-        }
+        tms9918->traceFn(tms9918->traceContext, TMS_TRACE_READ_DATA, data[i]);
       }
+    }
 
-      /* next pattern bit if non-magnified or if odd screen bit */
-      if (!tmsSpriteMag(tms9918) || (screenBit & 0x01))
-      {
-        if (++pattBit == GRAPHICS_CHAR_WIDTH) /* from A -> C or B -> D of large sprite */
-        {
-          pattBit = 0;
-          pattByte = tms9918->vram[pattOffset + PATTERN_BYTES * 2];
-        }
-      }
-    }    
+    addr += chunkBytes;
+    data += chunkBytes;
+    numBytes -= chunkBytes;
   }
-
 }
 
+#if VR_TMS9918_EMU_WRITE_LOG
 
-/* Function:  vrEmuTms9918GraphicsIScanLine
+/* Function:  tmsApplyWriteLog
  * ----------------------------------------
- * generate a Graphics I mode scanline
+ * apply queued writes timestamped up to and including line
  */
-static void vrEmuTms9918GraphicsIScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+static void tmsApplyWriteLog(VrEmuTms9918* tms9918, uint16_t line)
 {
-  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
-  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
-
-  /* address in name table at the start of this row */
-  const uint16_t rowNamesAddr = tmsNameTableAddr(tms9918) + tileY * GRAPHICS_NUM_COLS;
+  while (tms9918->writeLogHead < tms9918->writeLogTail &&
+         tms9918->writeLog[tms9918->writeLogHead].line <= line)
+  {
+    const tmsLoggedWrite* write = &tms9918->writeLog[tms9918->writeLogHead++];
+    if (write->isAddr)
+    {
+      vrEmuTms9918WriteAddr(tms9918, write->data);
+    }
+    else
+    {
+      vrEmuTms9918WriteData(tms9918, write->data);
+    }
+  }
+
+  if (tms9918->writeLogHead == tms9918->writeLogTail)
+  {
+    tms9918->writeLogHead = 0;
+    tms9918->writeLogTail = 0;
+  }
+}
+
+/* Function:  tmsLogWrite
+ * ----------------------------------------
+ * queue a port write
+ */
+static void tmsLogWrite(VrEmuTms9918* tms9918, uint16_t line, bool isAddr, uint8_t data)
+{
+  if (tms9918->writeLogTail == VR_TMS9918_EMU_WRITE_LOG_SIZE)
+  {
+    /* full. timing is lost, but the writes aren't */
+    tmsApplyWriteLog(tms9918, 0xffff);
+    if (isAddr)
+    {
+      vrEmuTms9918WriteAddr(tms9918, data);
+    }
+    else
+    {
+      vrEmuTms9918WriteData(tms9918, data);
+    }
+    return;
+  }
+
+  /* keep the log in order */
+  if (tms9918->writeLogTail && line < tms9918->writeLog[tms9918->writeLogTail - 1].line)
+  {
+    line = tms9918->writeLog[tms9918->writeLogTail - 1].line;
+  }
+
+  tmsLoggedWrite* write = &tms9918->writeLog[tms9918->writeLogTail++];
+  write->line = line;
+  write->isAddr = isAddr;
+  write->data = data;
+}
+
+#else
+
+/* Function:  tmsApplyWriteLog
+ * ----------------------------------------
+ * nothing is ever queued
+ */
+static inline void tmsApplyWriteLog(VrEmuTms9918* tms9918, uint16_t line)
+{
+  (void)tms9918;
+  (void)line;
+}
+
+/* Function:  tmsLogWrite
+ * ----------------------------------------
+ * no write log, so apply the write now
+ */
+static void tmsLogWrite(VrEmuTms9918* tms9918, uint16_t line, bool isAddr, uint8_t data)
+{
+  (void)line;
+
+  if (isAddr)
+  {
+    vrEmuTms9918WriteAddr(tms9918, data);
+  }
+  else
+  {
+    vrEmuTms9918WriteData(tms9918, data);
+  }
+}
+
+#endif
+
+/* Function:  vrEmuTms9918LogWriteAddr
+ * ----------------------------------------
+ * queue an address write (mode = 1), applied before scanline 'line'
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918LogWriteAddr(VrEmuTms9918* tms9918, uint16_t line, uint8_t data)
+{
+  if (tms9918 == NULL) return;
+
+  tmsLogWrite(tms9918, line, true, data);
+}
+
+/* Function:  vrEmuTms9918LogWriteData
+ * ----------------------------------------
+ * queue a data write (mode = 0), applied before scanline 'line'
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918LogWriteData(VrEmuTms9918* tms9918, uint16_t line, uint8_t data)
+{
+  if (tms9918 == NULL) return;
+
+  tmsLogWrite(tms9918, line, false, data);
+}
+
+/* Function:  vrEmuTms9918FlushWriteLog
+ * ----------------------------------------
+ * apply all queued writes
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918FlushWriteLog(VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL) return;
+
+  tmsApplyWriteLog(tms9918, 0xffff);
+}
+
+/* Function:  vrEmuTms9918WriteLogSize
+ * ----------------------------------------
+ * number of queued writes
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918WriteLogSize(const VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL) return 0;
+
+#if VR_TMS9918_EMU_WRITE_LOG
+  return tms9918->writeLogTail - tms9918->writeLogHead;
+#else
+  (void)tms9918;
+  return 0;
+#endif
+}
+
+
+/* Function:  vrEmuTms9918EvaluateSprites
+ * ----------------------------------------
+ * bucket sprites into per-scanline lists. only needs to be re-run when the
+ * sprite attribute table or registers change
+ */
+static void vrEmuTms9918EvaluateSprites(VrEmuTms9918* tms9918)
+{
+  TMS_STATS_INC(tms9918, spriteEvaluations);
+
+  tmsEvaluateSprites(tms9918->vram + tms9918->spriteAttrTableAddr,
+                     tms9918->registers[TMS_REG_1] & TMS_KERNEL_SPRITE_MASK, tms9918->spriteLines);
+
+  tms9918->spriteLinesValid = true;
+}
+
+/* Function:  vrEmuTms9918OutputSprites
+ * ----------------------------------------
+ * Output Sprites to a scanline
+ *
+ * kernelFlags are the (constant) TMS_KERNEL_SPRITE_* specialization. with
+ * TMS_KERNEL_LAYERS, opaque sprite pixels are also cleared from layerMask
+ * (and set in layerSpriteMask)
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918OutputSprites(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                       const uint8_t kernelFlags)
+{
+  if (y == 0)
+  {
+    tms9918->status = 0;
+  }
+
+  if (!tms9918->spriteLinesValid)
+  {
+    vrEmuTms9918EvaluateSprites(tms9918);
+  }
+
+  const tmsSpriteLine* line = &tms9918->spriteLines[y];
+
+  uint64_t rowSpriteBits[TMS9918_PIXELS_X / 64] = { 0 }; /* collision mask (msb first) */
+  uint64_t opaqueBits[TMS9918_PIXELS_X / 64] = { 0 };    /* TMS_KERNEL_LAYERS sprite mask */
+
+  TMS_STATS_ADD(tms9918, spritesProcessed, line->numSprites);
+
+  for (uint8_t i = 0; i < line->numSprites; ++i)
+  {
+    const uint8_t* spriteAttr = tms9918->vram + tms9918->spriteAttrTableAddr + line->sprites[i] * SPRITE_ATTR_BYTES;
+
+    int16_t xPos;
+    const uint32_t spriteBits = tmsSpriteRowBits(tms9918->vram, tms9918->spritePatternTableAddr, spriteAttr, y, &xPos, kernelFlags);
+
+    /* collision check against sprites already on this line */
+    if (tmsSpriteCollision(rowSpriteBits, spriteBits, xPos))
+    {
+      tms9918->status |= STATUS_COL;
+      TMS_STATS_INC(tms9918, spriteCollisions);
+    }
+
+    /* we still process transparent sprites, since
+       they're used in 5S and collision checks */
+    const vrEmuTms9918Color spriteColor = spriteAttr[SPRITE_ATTR_COLOR] & 0x0f;
+    if (spriteColor != TMS_TRANSPARENT)
+    {
+      TMS_STATS_INC(tms9918, spritesDrawn);
+      tmsDrawSprite(pixels, spriteBits, xPos, spriteColor, kernelFlags);
+
+      if (kernelFlags & TMS_KERNEL_LAYERS)
+      {
+        (void)tmsSpriteCollision(opaqueBits, spriteBits, xPos);
+      }
+    }
+  }
+
+  if (kernelFlags & TMS_KERNEL_LAYERS)
+  {
+    for (uint8_t i = 0; i < TMS9918_LINE_MASK_BYTES; ++i)
+    {
+      const uint8_t spriteBits = (uint8_t)(opaqueBits[i / 8] >> (56 - (i % 8) * 8));
+
+      tms9918->layerMask[i] &= (uint8_t)~spriteBits;
+      if (tms9918->layerSpriteMask) tms9918->layerSpriteMask[i] = spriteBits;
+    }
+  }
+
+  /* fifth sprite or LAST_SPRITE_YPOS index */
+  if ((tms9918->status & STATUS_5S) == 0)
+  {
+    if (line->status & STATUS_5S)
+    {
+      TMS_STATS_INC(tms9918, fifthSpriteEvents);
+    }
+    tms9918->status |= line->status;
+  }
+}
+
+/* Function:  vrEmuTms9918SpriteStatus
+ * ----------------------------------------
+ * update the status register for a scanline, as vrEmuTms9918OutputSprites()
+ * without pixels. collision only needs the first overlap, and can't happen
+ * with fewer than two sprites, so most lines never fetch a sprite pattern
+ *
+ * kernelFlags are the (constant) TMS_KERNEL_SPRITE_* specialization
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918SpriteStatus(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                      const uint8_t kernelFlags)
+{
+  (void)pixels;
+
+  if (y == 0)
+  {
+    tms9918->status = 0;
+  }
+
+  if (!tms9918->spriteLinesValid)
+  {
+    vrEmuTms9918EvaluateSprites(tms9918);
+  }
+
+  const tmsSpriteLine* line = &tms9918->spriteLines[y];
+
+  TMS_STATS_ADD(tms9918, spritesProcessed, line->numSprites);
+
+  if ((tms9918->status & STATUS_COL) == 0 && line->numSprites > 1)
+  {
+    uint64_t rowSpriteBits[TMS9918_PIXELS_X / 64] = { 0 }; /* collision mask (msb first) */
+
+    for (uint8_t i = 0; i < line->numSprites; ++i)
+    {
+      const uint8_t* spriteAttr = tms9918->vram + tms9918->spriteAttrTableAddr + line->sprites[i] * SPRITE_ATTR_BYTES;
+
+      int16_t xPos;
+      const uint32_t spriteBits = tmsSpriteRowBits(tms9918->vram, tms9918->spritePatternTableAddr, spriteAttr, y, &xPos, kernelFlags);
+
+      if (tmsSpriteCollision(rowSpriteBits, spriteBits, xPos))
+      {
+        tms9918->status |= STATUS_COL;
+        TMS_STATS_INC(tms9918, spriteCollisions);
+        break;
+      }
+    }
+  }
+
+  /* fifth sprite or LAST_SPRITE_YPOS index */
+  if ((tms9918->status & STATUS_5S) == 0)
+  {
+    if (line->status & STATUS_5S)
+    {
+      TMS_STATS_INC(tms9918, fifthSpriteEvents);
+    }
+    tms9918->status |= line->status;
+  }
+}
+
+/* Function:  tmsSpritePixels
+ * ----------------------------------------
+ * output sprite pixels only to a scanline. doesn't modify any state, so
+ * the sprite lists must already be valid (see vrEmuTms9918UpdateFrameStatus)
+ */
+static TMS_FORCE_INLINE void tmsSpritePixels(const VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                             const uint8_t kernelFlags)
+{
+  const tmsSpriteLine* line = &tms9918->spriteLines[y];
+
+  for (uint8_t i = 0; i < line->numSprites; ++i)
+  {
+    const uint8_t* spriteAttr = tms9918->vram + tms9918->spriteAttrTableAddr + line->sprites[i] * SPRITE_ATTR_BYTES;
+
+    const vrEmuTms9918Color spriteColor = spriteAttr[SPRITE_ATTR_COLOR] & 0x0f;
+    if (spriteColor != TMS_TRANSPARENT)
+    {
+      int16_t xPos;
+      const uint32_t spriteBits = tmsSpriteRowBits(tms9918->vram, tms9918->spritePatternTableAddr, spriteAttr, y, &xPos, kernelFlags);
+      tmsDrawSprite(pixels, spriteBits, xPos, spriteColor, kernelFlags);
+    }
+  }
+}
+
+/* Function:  tmsScanLineSprites
+ * ----------------------------------------
+ * sprites for a scanline kernel (with status, or pixels only)
+ */
+static TMS_FORCE_INLINE void tmsScanLineSprites(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                const uint8_t kernelFlags)
+{
+  if (kernelFlags & TMS_KERNEL_PIXELS_ONLY)
+  {
+    tmsSpritePixels(tms9918, y, pixels, kernelFlags & TMS_KERNEL_SPRITE_MASK);
+  }
+  else
+  {
+    vrEmuTms9918OutputSprites(tms9918, y, pixels, kernelFlags & (TMS_KERNEL_SPRITE_MASK | TMS_KERNEL_LAYERS));
+  }
+}
+
+
+/* Function:  vrEmuTms9918GraphicsIScanLine
+ * ----------------------------------------
+ * generate a Graphics I mode scanline
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918GraphicsIScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                           const uint8_t kernelFlags)
+{
+  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
+  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
+
+  /* address in name table at the start of this row */
+  const uint16_t rowNamesAddr = tms9918->nameTableAddr + tileY * GRAPHICS_NUM_COLS;
+
+  const uint8_t *patternTable = tms9918->vram + tms9918->patternTableAddr;
+  const uint8_t *colorTable = tms9918->vram + tms9918->colorTableAddr;
+
+#if VR_TMS9918_EMU_TILE_CACHE
+
+  uint8_t (*tileRows)[PATTERN_BYTES][GRAPHICS_CHAR_WIDTH] = tms9918->tileCache[0];
+  uint8_t* rowsValid = tms9918->tileCacheRowsValid[0];
+
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    const uint8_t pattIdx = tms9918->vram[rowNamesAddr + tileX];
+    uint8_t* tilePixels = pixels + tileX * GRAPHICS_CHAR_WIDTH;
+
+    if (kernelFlags & TMS_KERNEL_LAYERS)
+    {
+      tms9918->layerMask[tileX] = tmsTransparentBits(patternTable[pattIdx * PATTERN_BYTES + pattRow],
+                                                     colorTable[pattIdx / GFXI_COLOR_GROUP_SIZE]);
+    }
+
+    if (rowsValid[pattIdx] & (1 << pattRow))
+    {
+      memcpy(tilePixels, tileRows[pattIdx][pattRow], GRAPHICS_CHAR_WIDTH);
+    }
+    else
+    {
+      const uint8_t colorByte = colorTable[pattIdx / GFXI_COLOR_GROUP_SIZE];
+
+      /* pixels only kernels can read the cache, but not fill it */
+      uint8_t* rowPixels = (kernelFlags & TMS_KERNEL_PIXELS_ONLY) ? tilePixels : tileRows[pattIdx][pattRow];
+
+      tmsExpandPattern(patternTable[pattIdx * PATTERN_BYTES + pattRow],
+                       tms9918->colorPairs.fg[colorByte], tms9918->colorPairs.bg[colorByte],
+                       rowPixels);
+
+      if ((kernelFlags & TMS_KERNEL_PIXELS_ONLY) == 0)
+      {
+        rowsValid[pattIdx] |= 1 << pattRow;
+        memcpy(tilePixels, rowPixels, GRAPHICS_CHAR_WIDTH);
+      }
+    }
+  }
+
+#else
+
+  tmsGraphicsIRow(tms9918->vram + rowNamesAddr, patternTable, colorTable, pattRow, &tms9918->colorPairs, pixels,
+                  (kernelFlags & TMS_KERNEL_LAYERS) ? tms9918->layerMask : NULL);
+
+#endif
+
+  tmsScanLineSprites(tms9918, y, pixels, kernelFlags);
+}
+
+/* Function:  vrEmuTms9918GraphicsIIScanLine
+ * ----------------------------------------
+ * generate a Graphics II mode scanline
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918GraphicsIIScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                            const uint8_t kernelFlags)
+{
+  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
+  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
+
+  /* address in name table at the start of this row */
+  const uint16_t rowNamesAddr = tms9918->nameTableAddr + tileY * GRAPHICS_NUM_COLS;
+
+  /* see tmsGraphicsIIPageOffset */
+  const bool invalidGfxII = (kernelFlags & TMS_KERNEL_GFXII_INVALID) != 0;
+
+  const uint16_t pageOffset = tmsGraphicsIIPageOffset(tileY, invalidGfxII);
+
+  const uint8_t *patternTable = tms9918->vram + tms9918->patternTableAddr + pageOffset;
+  const uint8_t *colorTable = tms9918->vram + tms9918->colorTableAddr + pageOffset;
+
+#if VR_TMS9918_EMU_TILE_CACHE
+
+  const uint8_t pageThird = (tileY & 0x18) >> 3; /* which page? 0-2 */
+
+  uint8_t (*tileRows)[PATTERN_BYTES][GRAPHICS_CHAR_WIDTH] = tms9918->tileCache[invalidGfxII ? 0 : pageThird];
+  uint8_t* rowsValid = tms9918->tileCacheRowsValid[invalidGfxII ? 0 : pageThird];
+
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    uint8_t pattIdx = tms9918->vram[rowNamesAddr + tileX];
+
+    if (invalidGfxII)
+    {
+      pattIdx &= 0x07;
+    }
+
+    uint8_t* tilePixels = pixels + tileX * GRAPHICS_CHAR_WIDTH;
+    const size_t pattRowOffset = pattIdx * PATTERN_BYTES + pattRow;
+
+    if (kernelFlags & TMS_KERNEL_LAYERS)
+    {
+      tms9918->layerMask[tileX] = tmsTransparentBits(patternTable[pattRowOffset], colorTable[pattRowOffset]);
+    }
+
+    if (rowsValid[pattIdx] & (1 << pattRow))
+    {
+      memcpy(tilePixels, tileRows[pattIdx][pattRow], GRAPHICS_CHAR_WIDTH);
+    }
+    else
+    {
+      const uint8_t colorByte = colorTable[pattRowOffset];
+
+      /* pixels only kernels can read the cache, but not fill it */
+      uint8_t* rowPixels = (kernelFlags & TMS_KERNEL_PIXELS_ONLY) ? tilePixels : tileRows[pattIdx][pattRow];
+
+      tmsExpandPattern(patternTable[pattRowOffset],
+                       tms9918->colorPairs.fg[colorByte], tms9918->colorPairs.bg[colorByte],
+                       rowPixels);
+
+      if ((kernelFlags & TMS_KERNEL_PIXELS_ONLY) == 0)
+      {
+        rowsValid[pattIdx] |= 1 << pattRow;
+        memcpy(tilePixels, rowPixels, GRAPHICS_CHAR_WIDTH);
+      }
+    }
+  }
+
+#else
+
+  tmsGraphicsIIRow(tms9918->vram + rowNamesAddr, patternTable, colorTable, pattRow, invalidGfxII ? 0x07 : 0xff,
+                   &tms9918->colorPairs, pixels, (kernelFlags & TMS_KERNEL_LAYERS) ? tms9918->layerMask : NULL);
+
+#endif
+
+  tmsScanLineSprites(tms9918, y, pixels, kernelFlags);
+}
+
+/* Function:  vrEmuTms9918TextScanLine
+ * ----------------------------------------
+ * generate a Text mode scanline
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918TextScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                      const uint8_t kernelFlags)
+{
+  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
+  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
+
+  /* address in name table at the start of this row */
+  const uint16_t rowNamesAddr = tms9918->nameTableAddr + tileY * TEXT_NUM_COLS;
+  const uint8_t *patternTable = tms9918->vram + tms9918->patternTableAddr;
+
+  /* the background and padding are the backdrop, so only an opaque
+     foreground has pixels to clear from the transparent mask */
+  uint8_t* fgMask = NULL;
+  if (kernelFlags & TMS_KERNEL_LAYERS)
+  {
+    memset(tms9918->layerMask, 0xff, TMS9918_LINE_MASK_BYTES);
+    if (tms9918->layerSpriteMask) memset(tms9918->layerSpriteMask, 0, TMS9918_LINE_MASK_BYTES);
+
+    if ((tms9918->registers[TMS_REG_FG_BG_COLOR] >> 4) != TMS_TRANSPARENT)
+    {
+      fgMask = tms9918->layerMask;
+    }
+  }
+
+  /* R7 is a color byte like any other, with a transparent foreground showing the backdrop */
+  tmsTextRow(tms9918->vram + rowNamesAddr, patternTable, pattRow,
+             tms9918->colorPairs.fg[tms9918->registers[TMS_REG_FG_BG_COLOR]], tms9918->colorPairs.backdrop, pixels,
+             fgMask);
+}
+
+/* Function:  vrEmuTms9918MulticolorScanLine
+ * ----------------------------------------
+ * generate a Multicolor mode scanline
+ */
+static TMS_FORCE_INLINE void vrEmuTms9918MulticolorScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                            const uint8_t kernelFlags)
+{
+  const uint8_t tileY = y >> 3;
+
+  const uint16_t namesAddr = tms9918->nameTableAddr + tileY * GRAPHICS_NUM_COLS;
+  const uint8_t *patternTable = tms9918->vram + tms9918->patternTableAddr;
+
+  tmsMulticolorRow(tms9918->vram + namesAddr, patternTable, tmsMulticolorPattRow(y), &tms9918->colorPairs, pixels,
+                   (kernelFlags & TMS_KERNEL_LAYERS) ? tms9918->layerMask : NULL);
+
+  tmsScanLineSprites(tms9918, y, pixels, kernelFlags);
+}
+
+/* instantiate a kernel from an inline body with constant flags */
+#define TMS_KERNEL(name, body, flags) \
+  static void name(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X]) \
+  { \
+    body(tms9918, y, pixels, (flags)); \
+  }
+
+/* instantiate a kernel for each sprite size / magnification, and a table of
+   them indexed by TMS_KERNEL_SPRITE_MASK bits */
+#define TMS_SPRITE_KERNELS(name, body, flags) \
+  TMS_KERNEL(name##8, body, (flags)) \
+  TMS_KERNEL(name##8Mag, body, (flags) | TMS_KERNEL_SPRITE_MAG2) \
+  TMS_KERNEL(name##16, body, (flags) | TMS_KERNEL_SPRITE_16) \
+  TMS_KERNEL(name##16Mag, body, (flags) | TMS_KERNEL_SPRITE_16 | TMS_KERNEL_SPRITE_MAG2) \
+  static const tmsScanLineFn name##Kernels[TMS_KERNEL_SPRITE_MASK + 1] = { \
+    name##8, name##8Mag, name##16, name##16Mag \
+  };
+
+TMS_SPRITE_KERNELS(tmsSpriteStatus, vrEmuTms9918SpriteStatus, 0)
+TMS_SPRITE_KERNELS(tmsGraphicsIScanLine, vrEmuTms9918GraphicsIScanLine, 0)
+TMS_SPRITE_KERNELS(tmsGraphicsIIScanLine, vrEmuTms9918GraphicsIIScanLine, 0)
+TMS_SPRITE_KERNELS(tmsGraphicsIIInvalidScanLine, vrEmuTms9918GraphicsIIScanLine, TMS_KERNEL_GFXII_INVALID)
+TMS_SPRITE_KERNELS(tmsMulticolorScanLine, vrEmuTms9918MulticolorScanLine, 0)
+
+TMS_SPRITE_KERNELS(tmsGraphicsIPixels, vrEmuTms9918GraphicsIScanLine, TMS_KERNEL_PIXELS_ONLY)
+TMS_SPRITE_KERNELS(tmsGraphicsIIPixels, vrEmuTms9918GraphicsIIScanLine, TMS_KERNEL_PIXELS_ONLY)
+TMS_SPRITE_KERNELS(tmsGraphicsIIInvalidPixels, vrEmuTms9918GraphicsIIScanLine, TMS_KERNEL_PIXELS_ONLY | TMS_KERNEL_GFXII_INVALID)
+TMS_SPRITE_KERNELS(tmsMulticolorPixels, vrEmuTms9918MulticolorScanLine, TMS_KERNEL_PIXELS_ONLY)
+
+TMS_SPRITE_KERNELS(tmsGraphicsILayers, vrEmuTms9918GraphicsIScanLine, TMS_KERNEL_LAYERS)
+TMS_SPRITE_KERNELS(tmsGraphicsIILayers, vrEmuTms9918GraphicsIIScanLine, TMS_KERNEL_LAYERS)
+TMS_SPRITE_KERNELS(tmsGraphicsIIInvalidLayers, vrEmuTms9918GraphicsIIScanLine, TMS_KERNEL_LAYERS | TMS_KERNEL_GFXII_INVALID)
+TMS_SPRITE_KERNELS(tmsMulticolorLayers, vrEmuTms9918MulticolorScanLine, TMS_KERNEL_LAYERS)
+
+/* text mode has no sprites */
+TMS_KERNEL(tmsTextScanLine, vrEmuTms9918TextScanLine, 0)
+TMS_KERNEL(tmsTextLayers, vrEmuTms9918TextScanLine, TMS_KERNEL_LAYERS)
+
+#undef TMS_SPRITE_KERNELS
+#undef TMS_KERNEL
+
+/* Function:  tmsSelectKernels
+ * ----------------------------------------
+ * select the kernels for the current mode and sprite settings
+ */
+static void tmsSelectKernels(VrEmuTms9918* tms9918)
+{
+  const uint8_t spriteKernel = tms9918->registers[TMS_REG_1] & TMS_KERNEL_SPRITE_MASK;
+
+  tms9918->spritesFn = tmsSpriteStatusKernels[spriteKernel];
+
+  switch (tms9918->mode)
+  {
+    case TMS_MODE_GRAPHICS_II:
+      if (tmsInvalidGfxII(tms9918))
+      {
+        tms9918->scanLineFn = tmsGraphicsIIInvalidScanLineKernels[spriteKernel];
+        tms9918->pixelsFn = tmsGraphicsIIInvalidPixelsKernels[spriteKernel];
+        tms9918->layersFn = tmsGraphicsIIInvalidLayersKernels[spriteKernel];
+      }
+      else
+      {
+        tms9918->scanLineFn = tmsGraphicsIIScanLineKernels[spriteKernel];
+        tms9918->pixelsFn = tmsGraphicsIIPixelsKernels[spriteKernel];
+        tms9918->layersFn = tmsGraphicsIILayersKernels[spriteKernel];
+      }
+      break;
+
+    case TMS_MODE_TEXT:
+      /* text mode has no sprites, so never modifies any state */
+      tms9918->scanLineFn = tmsTextScanLine;
+      tms9918->pixelsFn = tmsTextScanLine;
+      tms9918->layersFn = tmsTextLayers;
+      break;
+
+    case TMS_MODE_MULTICOLOR:
+      tms9918->scanLineFn = tmsMulticolorScanLineKernels[spriteKernel];
+      tms9918->pixelsFn = tmsMulticolorPixelsKernels[spriteKernel];
+      tms9918->layersFn = tmsMulticolorLayersKernels[spriteKernel];
+      break;
+
+    default:
+      tms9918->scanLineFn = tmsGraphicsIScanLineKernels[spriteKernel];
+      tms9918->pixelsFn = tmsGraphicsIPixelsKernels[spriteKernel];
+      tms9918->layersFn = tmsGraphicsILayersKernels[spriteKernel];
+      break;
+  }
+}
+
+/* Function:  tmsGenerateLine
+ * ----------------------------------------
+ * generate a scanline with the selected kernel (display enabled)
+ */
+static TMS_FORCE_INLINE void tmsGenerateLine(VrEmuTms9918* tms9918, tmsScanLineFn scanLineFn, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+{
+#if VR_TMS9918_EMU_STATS
+  const uint64_t startTicks = tms9918->statsClockFn ? tms9918->statsClockFn() : 0;
+#endif
+
+  scanLineFn(tms9918, y, pixels);
+
+#if VR_TMS9918_EMU_STATS
+  if (tms9918->statsClockFn)
+  {
+    tms9918->stats.kernelTicks[tms9918->mode] += tms9918->statsClockFn() - startTicks;
+  }
+  ++tms9918->stats.scanLines[tms9918->mode];
+  tms9918->frameInProgress = (y != TMS9918_PIXELS_Y - 1);
+#endif
+}
+
+
+/* Function:  tmsScanLine
+ * ----------------------------------------
+ * generate a scanline with scanLineFn (or blank it). returns false if the
+ * line was blanked
+ */
+static TMS_FORCE_INLINE bool tmsScanLine(VrEmuTms9918* tms9918, tmsScanLineFn scanLineFn, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+{
+  TMS_TRACE(tms9918, TMS_TRACE_SCANLINE, y);
+  TMS_WATCH_FLUSH(tms9918, y == 0);
+
+  if (!vrEmuTms9918DisplayEnabled(tms9918) || y >= TMS9918_PIXELS_Y)
+  {
+    TMS_STATS_INC(tms9918, blankLines);
+    memset(pixels, tmsMainBgColor(tms9918), TMS9918_PIXELS_X);
+    return false;
+  }
+
+  tmsGenerateLine(tms9918, scanLineFn, y, pixels);
+
+  if (y == TMS9918_PIXELS_Y - 1)
+  {
+    tms9918->status |= STATUS_INT;
+  }
+
+  return true;
+}
+
+/* Function:  vrEmuTms9918ScanLine
+ * ----------------------------------------
+ * generate a scanline
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918ScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+{
+  if (tms9918 == NULL)
+    return;
+
+  (void)tmsScanLine(tms9918, tms9918->scanLineFn, y, pixels);
+}
+
+/* Function:  vrEmuTms9918ScanLineLayers
+ * ----------------------------------------
+ * generate a scanline and its layer masks. the TMS_KERNEL_LAYERS kernels
+ * build both masks in the same pass as the pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918ScanLineLayers(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                                         uint8_t transparentMask[TMS9918_LINE_MASK_BYTES], uint8_t* spriteMask)
+{
+  if (tms9918 == NULL || transparentMask == NULL)
+    return;
+
+  tms9918->layerMask = transparentMask;
+  tms9918->layerSpriteMask = spriteMask;
+
+  if (!tmsScanLine(tms9918, tms9918->layersFn, y, pixels))
+  {
+    memset(transparentMask, 0xff, TMS9918_LINE_MASK_BYTES);
+    if (spriteMask) memset(spriteMask, 0, TMS9918_LINE_MASK_BYTES);
+  }
+
+  tms9918->layerMask = NULL;
+  tms9918->layerSpriteMask = NULL;
+}
+
+/* Function:  tmsRenderFrame
+ * ----------------------------------------
+ * generate all scanlines of a frame. each line is either written to
+ * framebuffer, or (with a lineFn) generated into a line buffer and handed
+ * to lineFn. lineFn is constant for each caller, so inlining removes the
+ * unused path
+ */
+static TMS_FORCE_INLINE void tmsRenderFrame(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch,
+                                            vrEmuTms9918LineFn lineFn, void* context)
+{
+  uint8_t lineBuffer[TMS9918_PIXELS_X];
+
+  #define TMS_FRAME_LINE(y) (lineFn ? lineBuffer : framebuffer + (y) * pitch)
+  #define TMS_FRAME_LINE_DONE(y) if (lineFn) lineFn(context, (y), lineBuffer)
+
+  if (TMS_WRITE_LOG_PENDING(tms9918))
+  {
+    /* queued writes can change anything between lines */
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+    {
+      tmsApplyWriteLog(tms9918, y);
+      vrEmuTms9918ScanLine(tms9918, y, TMS_FRAME_LINE(y));
+      TMS_FRAME_LINE_DONE(y);
+    }
+    tmsApplyWriteLog(tms9918, 0xffff);
+    return;
+  }
+
+  /* with queued writes, the frame was traced as scanlines */
+  TMS_TRACE(tms9918, TMS_TRACE_FRAME, 0);
+  TMS_WATCH_FLUSH(tms9918, true);
+
+  if (!vrEmuTms9918DisplayEnabled(tms9918))
+  {
+    const vrEmuTms9918Color bgColor = tmsMainBgColor(tms9918);
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+    {
+      memset(TMS_FRAME_LINE(y), bgColor, TMS9918_PIXELS_X);
+      TMS_FRAME_LINE_DONE(y);
+    }
+    TMS_STATS_ADD(tms9918, blankLines, TMS9918_PIXELS_Y);
+    return;
+  }
+
+  /* mode and table addresses can't change mid-frame */
+  const tmsScanLineFn scanLineFn = tms9918->scanLineFn;
+
+  for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+  {
+    tmsGenerateLine(tms9918, scanLineFn, y, TMS_FRAME_LINE(y));
+    TMS_FRAME_LINE_DONE(y);
+  }
+
+  #undef TMS_FRAME_LINE
+  #undef TMS_FRAME_LINE_DONE
+
+  tms9918->status |= STATUS_INT;
+}
+
+/* Function:  vrEmuTms9918RenderFrame
+ * ----------------------------------------
+ * generate all visible scanlines of a frame
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderFrame(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch)
+{
+  if (tms9918 == NULL || framebuffer == NULL)
+    return;
+
+  tmsRenderFrame(tms9918, framebuffer, pitch, NULL, NULL);
+}
+
+/* Function:  vrEmuTms9918RenderFrameLines
+ * ----------------------------------------
+ * generate all scanlines of a frame, handing each to lineFn
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderFrameLines(VrEmuTms9918* tms9918, vrEmuTms9918LineFn lineFn, void* context)
+{
+  if (tms9918 == NULL || lineFn == NULL)
+    return;
+
+  tmsRenderFrame(tms9918, NULL, 0, lineFn, context);
+}
+
+/* Function:  vrEmuTms9918UpdateFrameStatus
+ * ----------------------------------------
+ * update the status register for a whole frame, without generating pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918UpdateFrameStatus(VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL)
+    return;
+
+  tmsApplyWriteLog(tms9918, 0xffff);
+
+  TMS_TRACE(tms9918, TMS_TRACE_FRAME, 0);
+  TMS_WATCH_FLUSH(tms9918, true);
+
+  if (!vrEmuTms9918DisplayEnabled(tms9918))
+    return;
+
+  if (tms9918->mode != TMS_MODE_TEXT)
+  {
+    const tmsScanLineFn spritesFn = tms9918->spritesFn;
+
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+    {
+      spritesFn(tms9918, y, NULL);
+    }
+    TMS_STATS_ADD(tms9918, statusOnlyLines, TMS9918_PIXELS_Y);
+  }
+
+  tms9918->status |= STATUS_INT;
+}
+
+/* Function:  vrEmuTms9918SkipLine
+ * ----------------------------------------
+ * update the status register as vrEmuTms9918ScanLine() would, without
+ * generating pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918SkipLine(VrEmuTms9918* tms9918, uint8_t y)
+{
+  if (tms9918 == NULL)
+    return;
+
+  TMS_TRACE(tms9918, TMS_TRACE_SCANLINE, y);
+  TMS_WATCH_FLUSH(tms9918, y == 0);
+
+  if (!vrEmuTms9918DisplayEnabled(tms9918) || y >= TMS9918_PIXELS_Y)
+    return;
+
+  if (tms9918->mode != TMS_MODE_TEXT)
+  {
+    tms9918->spritesFn(tms9918, y, NULL);
+    TMS_STATS_INC(tms9918, statusOnlyLines);
+  }
+
+  if (y == TMS9918_PIXELS_Y - 1)
+  {
+    tms9918->status |= STATUS_INT;
+  }
+}
+
+/* Function:  vrEmuTms9918SkipFrame
+ * ----------------------------------------
+ * update the status register as vrEmuTms9918RenderFrame() would, without
+ * generating pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918SkipFrame(VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL)
+    return;
+
+  if (TMS_WRITE_LOG_PENDING(tms9918))
+  {
+    /* queued writes can change anything between lines */
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+    {
+      tmsApplyWriteLog(tms9918, y);
+      vrEmuTms9918SkipLine(tms9918, y);
+    }
+    tmsApplyWriteLog(tms9918, 0xffff);
+    return;
+  }
+
+  vrEmuTms9918UpdateFrameStatus(tms9918);
+}
+
+/* Function:  vrEmuTms9918RenderLines
+ * ----------------------------------------
+ * generate the pixels of a range of scanlines
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderLines(const VrEmuTms9918* tms9918, uint8_t firstLine, uint8_t numLines,
+                                                      uint8_t* framebuffer, size_t pitch)
+{
+  if (tms9918 == NULL || framebuffer == NULL || firstLine >= TMS9918_PIXELS_Y)
+    return;
 
-  const uint8_t *patternTable = tms9918->vram + tmsPatternTableAddr(tms9918);
-  const uint8_t *colorTable = tms9918->vram + tmsColorTableAddr(tms9918);
+  const uint8_t endLine = (numLines < TMS9918_PIXELS_Y - firstLine) ? firstLine + numLines : TMS9918_PIXELS_Y;
 
-  /* iterate over each tile in this row */
-  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  if (!(tms9918->registers[TMS_REG_1] & TMS_R1_DISP_ACTIVE))
   {
-    const uint8_t pattIdx = tms9918->vram[rowNamesAddr + tileX];    
-    const uint8_t pattByte = patternTable[pattIdx * PATTERN_BYTES + pattRow];
-    const uint8_t colorByte = colorTable[pattIdx / GFXI_COLOR_GROUP_SIZE];
-
-    const uint8_t fgColor = tmsFgColor(tms9918, colorByte);
-    const uint8_t bgColor = tmsBgColor(tms9918, colorByte);
-
-    /* iterate over each bit of this pattern byte */
-    for (uint8_t pattBit = 0; pattBit < GRAPHICS_CHAR_WIDTH; ++pattBit)
+    const vrEmuTms9918Color bgColor = tmsMainBgColor(tms9918);
+    for (uint8_t y = firstLine; y < endLine; ++y)
     {
-      const bool pixelBit = (pattByte << pattBit) & 0x80;
-      pixels[tileX * GRAPHICS_CHAR_WIDTH + pattBit] = pixelBit ? fgColor : bgColor;
+      memset(framebuffer + y * pitch, bgColor, TMS9918_PIXELS_X);
     }
+    return;
   }
 
-  vrEmuTms9918OutputSprites(tms9918, y, pixels);
+  /* pixels only kernels never write through tms9918 */
+  const tmsScanLineFn pixelsFn = tms9918->pixelsFn;
+  VrEmuTms9918* const state = (VrEmuTms9918*)tms9918;
+
+  for (uint8_t y = firstLine; y < endLine; ++y)
+  {
+    pixelsFn(state, y, framebuffer + y * pitch);
+  }
 }
 
-/* Function:  vrEmuTms9918GraphicsIIScanLine
+/* a band of lines for vrEmuTms9918RenderFrameParallel() */
+typedef struct
+{
+  const VrEmuTms9918* tms9918;
+  uint8_t* framebuffer;
+  size_t pitch;
+  uint8_t linesPerBand;
+} tmsBandJob;
+
+/* Function:  tmsRenderBand
  * ----------------------------------------
- * generate a Graphics II mode scanline
+ * vrEmuTms9918JobFn generating a band of lines
  */
-static void vrEmuTms9918GraphicsIIScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+static void tmsRenderBand(void* jobData, size_t band)
 {
-  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
-  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
+  const tmsBandJob* job = (const tmsBandJob*)jobData;
+  vrEmuTms9918RenderLines(job->tms9918, (uint8_t)(band * job->linesPerBand), job->linesPerBand, job->framebuffer, job->pitch);
+}
 
-  /* address in name table at the start of this row */
-  const uint16_t rowNamesAddr = tmsNameTableAddr(tms9918) + tileY * GRAPHICS_NUM_COLS;
+/* Function:  vrEmuTms9918RenderFrameParallel
+ * ----------------------------------------
+ * generate all visible scanlines of a frame, as bands of lines
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderFrameParallel(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch,
+                                                              uint8_t numBands, vrEmuTms9918ParallelFor parallelFor, void* pool)
+{
+  if (tms9918 == NULL || framebuffer == NULL)
+    return;
 
-  /* the datasheet says the lower bits of the color and pattern tables must
-     be all 1's for graphics II mode. when they're not, it seems the page
-     offset becomes 0 and only the lower 3 bits of pattern name is used */
-  const bool invalidGfxII = (tms9918->registers[TMS_REG_PATTERN_TABLE] & 0x03) != 0x03 ||
-                            (tms9918->registers[TMS_REG_COLOR_TABLE] & 0x7f) != 0x7f;
+  /* sequential: status register, and the sprite lists the bands read */
+  vrEmuTms9918UpdateFrameStatus(tms9918);
 
-  const uint16_t pageThird = (tileY & 0x18) >> 3; /* which page? 0-2 */
-  const uint16_t pageOffset = (uint16_t)(invalidGfxII ? 0 : pageThird << 11); /* offset (0, 0x800 or 0x1000) */
+  if (numBands == 0) numBands = 1;
+  if (numBands > TMS9918_PIXELS_Y) numBands = TMS9918_PIXELS_Y;
 
-  const uint8_t *patternTable = tms9918->vram + tmsPatternTableAddr(tms9918) + pageOffset;
-  const uint8_t *colorTable = tms9918->vram + tmsColorTableAddr(tms9918) + pageOffset;
+  tmsBandJob job;
+  job.tms9918 = tms9918;
+  job.framebuffer = framebuffer;
+  job.pitch = pitch;
+  job.linesPerBand = (uint8_t)((TMS9918_PIXELS_Y + numBands - 1) / numBands);
 
-  /* iterate over each tile in this row */
-  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
-  {
-    uint8_t pattIdx = tms9918->vram[rowNamesAddr + tileX];
+  const size_t numJobs = (TMS9918_PIXELS_Y + job.linesPerBand - 1) / job.linesPerBand;
 
-    if (invalidGfxII)
+  if (parallelFor != NULL)
+  {
+    parallelFor(pool, numJobs, tmsRenderBand, &job);
+  }
+  else
+  {
+    for (size_t band = 0; band < numJobs; ++band)
     {
-      pattIdx &= 0x07;
+      tmsRenderBand(&job, band);
     }
+  }
 
-    const size_t pattRowOffset = pattIdx * PATTERN_BYTES + pattRow;
-    const uint8_t pattByte = patternTable[pattRowOffset];
-    const uint8_t colorByte = colorTable[pattRowOffset];
+#if VR_TMS9918_EMU_STATS
+  if (vrEmuTms9918DisplayEnabled(tms9918))
+  {
+    tms9918->stats.scanLines[tms9918->mode] += TMS9918_PIXELS_Y;
+  }
+  else
+  {
+    tms9918->stats.blankLines += TMS9918_PIXELS_Y;
+  }
+  tms9918->frameInProgress = false;
+#endif
+}
 
-    const vrEmuTms9918Color fgColor = tmsFgColor(tms9918, colorByte);
-    const vrEmuTms9918Color bgColor = tmsBgColor(tms9918, colorByte);
+/* Function:  tmsResolveDirtyLines
+ * ----------------------------------------
+ * convert pending pattern, color and sprite changes to dirty lines
+ */
+static void tmsResolveDirtyLines(VrEmuTms9918* tms9918)
+{
+  if (tms9918->spritesDirty)
+  {
+    /* lines with sprites before or after the change */
+    if (!tms9918->spriteLinesValid)
+    {
+      vrEmuTms9918EvaluateSprites(tms9918);
+    }
 
-    /* iterate over each bit of this pattern byte */
-    for (uint8_t pattBit = 0; pattBit < GRAPHICS_CHAR_WIDTH; ++pattBit)
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
     {
-      const bool pixelBit = (pattByte << pattBit) & 0x80;
-      pixels[tileX * GRAPHICS_CHAR_WIDTH + pattBit] = (uint8_t)(pixelBit ? fgColor : bgColor);
+      if ((tms9918->lineFlags[y] & TMS_LINE_SPRITES) || tms9918->spriteLines[y].numSprites)
+      {
+        tms9918->lineFlags[y] |= TMS_LINE_DIRTY;
+      }
     }
+    tms9918->spritesDirty = false;
   }
 
-  vrEmuTms9918OutputSprites(tms9918, y, pixels);
+  if (tms9918->patternsDirty)
+  {
+    const vrEmuTms9918Mode mode = tms9918->mode;
+    const bool invalidGfxII = (mode == TMS_MODE_GRAPHICS_II) && tmsInvalidGfxII(tms9918);
+    const uint8_t numCols = (mode == TMS_MODE_TEXT) ? TEXT_NUM_COLS : GRAPHICS_NUM_COLS;
+
+    /* find the pattern rows referenced by each row of the name table */
+    for (uint8_t tileY = 0; tileY < GRAPHICS_NUM_ROWS; ++tileY)
+    {
+      const uint8_t* rowNames = tms9918->vram + tms9918->nameTableAddr + tileY * numCols;
+      const uint8_t pageThird = (mode == TMS_MODE_GRAPHICS_II && !invalidGfxII) ? tileY >> 3 : 0;
+      const uint8_t* rowsDirty = tms9918->patternRowsDirty[pageThird];
+      const uint8_t pattIdxMask = invalidGfxII ? 0x07 : 0xff;
+
+      uint8_t pattRows = 0;
+      for (uint8_t tileX = 0; tileX < numCols; ++tileX)
+      {
+        pattRows |= rowsDirty[rowNames[tileX] & pattIdxMask];
+      }
+
+      uint8_t* lineFlags = tms9918->lineFlags + tileY * PATTERN_BYTES;
+
+      if (mode == TMS_MODE_MULTICOLOR)
+      {
+        /* each tile row uses two pattern rows, four lines each */
+        pattRows >>= (tileY & 0x03) * 2;
+        for (uint8_t i = 0; i < PATTERN_BYTES; ++i)
+        {
+          if (pattRows & (1 << (i / 4)))
+          {
+            lineFlags[i] |= TMS_LINE_DIRTY;
+          }
+        }
+      }
+      else
+      {
+        for (uint8_t i = 0; i < PATTERN_BYTES; ++i)
+        {
+          if (pattRows & (1 << i))
+          {
+            lineFlags[i] |= TMS_LINE_DIRTY;
+          }
+        }
+      }
+    }
+
+    memset(tms9918->patternRowsDirty, 0, sizeof(tms9918->patternRowsDirty));
+    tms9918->patternsDirty = false;
+  }
 }
 
-/* Function:  vrEmuTms9918TextScanLine
+/* Function:  vrEmuTms9918RenderFrameIncremental
  * ----------------------------------------
- * generate a Text mode scanline
+ * regenerate only the lines that have changed since the last call
  */
-static void vrEmuTms9918TextScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderFrameIncremental(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch)
 {
-  const uint8_t tileY = y >> 3;   /* which name table row (0 - 23) */
-  const uint8_t pattRow = y & 0x07;  /* which pattern row (0 - 7) */
+  if (tms9918 == NULL || framebuffer == NULL)
+    return;
 
-  /* address in name table at the start of this row */
-  const uint16_t rowNamesAddr = tmsNameTableAddr(tms9918) + tileY * TEXT_NUM_COLS;
-  const uint8_t *patternTable = tms9918->vram + tmsPatternTableAddr(tms9918);
+  tmsApplyWriteLog(tms9918, 0xffff);
+  tmsResolveDirtyLines(tms9918);
+
+  TMS_TRACE(tms9918, TMS_TRACE_FRAME, 0);
+  TMS_WATCH_FLUSH(tms9918, true);
 
+  const bool displayEnabled = vrEmuTms9918DisplayEnabled(tms9918);
+  const bool hasSprites = displayEnabled && tms9918->mode != TMS_MODE_TEXT;
   const vrEmuTms9918Color bgColor = tmsMainBgColor(tms9918);
-  const vrEmuTms9918Color fgColor = tmsMainFgColor(tms9918);
-  
-  /* fill the first and last 8 pixels with bg color */
-  memset(pixels, bgColor, TEXT_PADDING_PX);
-  memset(pixels + TMS9918_PIXELS_X - TEXT_PADDING_PX, bgColor, TEXT_PADDING_PX);
-  
-  for (uint8_t tileX = 0; tileX < TEXT_NUM_COLS; ++tileX)
-  {
-    const uint8_t pattIdx = tms9918->vram[rowNamesAddr + tileX];
-    const uint8_t pattByte = patternTable[pattIdx * PATTERN_BYTES + pattRow];
+  const tmsScanLineFn scanLineFn = tms9918->scanLineFn;
+  const tmsScanLineFn spritesFn = tms9918->spritesFn;
 
-    for (uint8_t pattBit = 0; pattBit < TEXT_CHAR_WIDTH; ++pattBit)
+  for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+  {
+    if (tms9918->lineFlags[y] & TMS_LINE_DIRTY)
+    {
+      if (displayEnabled)
+      {
+        tmsGenerateLine(tms9918, scanLineFn, y, framebuffer + y * pitch);
+      }
+      else
+      {
+        TMS_STATS_INC(tms9918, blankLines);
+        memset(framebuffer + y * pitch, bgColor, TMS9918_PIXELS_X);
+      }
+    }
+    else if (hasSprites)
     {
-      bool pixelBit = (pattByte << pattBit) & 0x80;
-      pixels[TEXT_PADDING_PX + tileX * TEXT_CHAR_WIDTH + pattBit] = (uint8_t)(pixelBit ? fgColor : bgColor);
+      /* unchanged, but the status register still needs updating */
+      TMS_STATS_INC(tms9918, statusOnlyLines);
+      spritesFn(tms9918, y, NULL);
     }
+
+    tms9918->lineFlags[y] = (hasSprites && tms9918->spriteLines[y].numSprites) ? TMS_LINE_SPRITES : 0;
+  }
+
+  if (displayEnabled)
+  {
+    tms9918->status |= STATUS_INT;
   }
 }
 
-/* Function:  vrEmuTms9918MulticolorScanLine
+/* Function:  vrEmuTms9918DirtyLineRanges
  * ----------------------------------------
- * generate a Multicolor mode scanline
+ * the line ranges the next vrEmuTms9918RenderFrameIncremental() will regenerate
  */
-static void vrEmuTms9918MulticolorScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918DirtyLineRanges(VrEmuTms9918* tms9918, vrEmuTms9918LineRange* ranges, size_t maxRanges)
 {
-  const uint8_t tileY = y >> 3;
-  const uint8_t pattRow = ((y / 4) & 0x01) + (tileY & 0x03) * 2;
+  if (tms9918 == NULL || ranges == NULL || maxRanges == 0)
+    return 0;
 
-  const uint16_t namesAddr = tmsNameTableAddr(tms9918) + tileY * GRAPHICS_NUM_COLS;
-  const uint8_t *patternTable = tms9918->vram + tmsPatternTableAddr(tms9918);
+  tmsApplyWriteLog(tms9918, 0xffff);
+  tmsResolveDirtyLines(tms9918);
 
-  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  size_t numRanges = 0;
+  for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
   {
-    const uint8_t pattIdx = tms9918->vram[namesAddr + tileX];
-    const uint8_t colorByte = patternTable[pattIdx * PATTERN_BYTES + pattRow];
+    if ((tms9918->lineFlags[y] & TMS_LINE_DIRTY) == 0)
+      continue;
 
-    memset(pixels + tileX * 8, tmsFgColor(tms9918, colorByte), 4);
-    memset(pixels + tileX * 8 + 4, tmsBgColor(tms9918, colorByte), 4);
+    if (numRanges && ranges[numRanges - 1].firstLine + ranges[numRanges - 1].numLines == y)
+    {
+      ++ranges[numRanges - 1].numLines;
+    }
+    else if (numRanges < maxRanges)
+    {
+      ranges[numRanges].firstLine = y;
+      ranges[numRanges].numLines = 1;
+      ++numRanges;
+    }
+    else /* out of ranges. extend the last one to cover this line */
+    {
+      ranges[numRanges - 1].numLines = y - ranges[numRanges - 1].firstLine + 1;
+    }
   }
 
-  vrEmuTms9918OutputSprites(tms9918, y, pixels);
+  return numRanges;
 }
 
-
-/* Function:  vrEmuTms9918ScanLine
+/* Function:  vrEmuTms9918InvalidateFrame
  * ----------------------------------------
- * generate a scanline
+ * force the next vrEmuTms9918RenderFrameIncremental() to regenerate every line
  */
-VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918ScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X])
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918InvalidateFrame(VrEmuTms9918* tms9918)
 {
   if (tms9918 == NULL)
     return;
 
-  if (!vrEmuTms9918DisplayEnabled(tms9918) || y >= TMS9918_PIXELS_Y)
-  {
-    memset(pixels, tmsMainBgColor(tms9918), TMS9918_PIXELS_X);
-    return;
-  }
-
-  switch (tms9918->mode)
-  {
-    case TMS_MODE_GRAPHICS_I:
-      vrEmuTms9918GraphicsIScanLine(tms9918, y, pixels);
-      break;
-
-    case TMS_MODE_GRAPHICS_II:
-      vrEmuTms9918GraphicsIIScanLine(tms9918, y, pixels);
-      break;
-
-    case TMS_MODE_TEXT:
-      vrEmuTms9918TextScanLine(tms9918, y, pixels);
-      break;
-
-    case TMS_MODE_MULTICOLOR:
-      vrEmuTms9918MulticolorScanLine(tms9918, y, pixels);
-      break;
-  }
-
-  if (y == TMS9918_PIXELS_Y - 1)
-  {
-    tms9918->status |= STATUS_INT;
-  }
+  tmsInvalidateFrame(tms9918);
 }
 
 /* Function:  vrEmuTms9918RegValue
@@ -680,8 +2129,7 @@ void vrEmuTms9918WriteRegValue(VrEmuTms9918* tms9918, vrEmuTms9918Register reg,
 {
   if (tms9918 != NULL)
   {
-    tms9918->registers[reg & 0x07] = value;
-    tms9918->mode = tmsMode(tms9918);
+    tmsWriteRegister(tms9918, (uint8_t)reg, value);
   }
 }
 
@@ -712,3 +2160,258 @@ bool vrEmuTms9918DisplayEnabled(VrEmuTms9918* tms9918)
 
   return tms9918->registers[TMS_REG_1] & TMS_R1_DISP_ACTIVE;
 }
+
+/* Function:  vrEmuTms9918GetStats
+ * ----------------------------------------
+ * copy the performance counters
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918GetStats(VrEmuTms9918* tms9918, vrEmuTms9918Stats* stats)
+{
+  if (stats == NULL)
+    return false;
+
+#if VR_TMS9918_EMU_STATS
+  if (tms9918 != NULL)
+  {
+    *stats = tms9918->stats;
+    return true;
+  }
+#else
+  (void)tms9918;
+#endif
+
+  memset(stats, 0, sizeof(*stats));
+  return false;
+}
+
+/* Function:  vrEmuTms9918ResetStats
+ * ----------------------------------------
+ * clear the performance counters
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918ResetStats(VrEmuTms9918* tms9918)
+{
+#if VR_TMS9918_EMU_STATS
+  if (tms9918 == NULL)
+    return;
+
+  memset(&tms9918->stats, 0, sizeof(tms9918->stats));
+  tms9918->frameInProgress = false;
+#else
+  (void)tms9918;
+#endif
+}
+
+/* Function:  vrEmuTms9918SetStatsClock
+ * ----------------------------------------
+ * set a clock used to total kernel times
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SetStatsClock(VrEmuTms9918* tms9918, uint64_t (*clockFn)(void))
+{
+#if VR_TMS9918_EMU_STATS
+  if (tms9918 == NULL)
+    return;
+
+  tms9918->statsClockFn = clockFn;
+#else
+  (void)tms9918;
+  (void)clockFn;
+#endif
+}
+
+/* Function:  vrEmuTms9918SetTraceFn
+ * ----------------------------------------
+ * report port accesses, scanlines and frames to traceFn
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SetTraceFn(VrEmuTms9918* tms9918, vrEmuTms9918TraceFn traceFn, void* context)
+{
+  if (tms9918 == NULL)
+    return;
+
+  tms9918->traceFn = traceFn;
+  tms9918->traceContext = context;
+}
+
+/* Function:  vrEmuTms9918AddWatch
+ * ----------------------------------------
+ * watch a range of vram for changes
+ */
+VR_EMU_TMS9918_DLLEXPORT
+int vrEmuTms9918AddWatch(VrEmuTms9918* tms9918, uint16_t addr, uint16_t numBytes, unsigned flags,
+                         vrEmuTms9918WatchFn watchFn, void* context)
+{
+  if (tms9918 == NULL || watchFn == NULL)
+    return -1;
+
+  const int watch = tmsWatchAdd(&tms9918->watches, addr, numBytes, flags);
+  if (watch >= 0)
+  {
+    tms9918->watchFns[watch] = watchFn;
+    tms9918->watchContexts[watch] = context;
+  }
+  return watch;
+}
+
+/* Function:  vrEmuTms9918RemoveWatch
+ * ----------------------------------------
+ * remove a watch
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RemoveWatch(VrEmuTms9918* tms9918, int watch)
+{
+  if (tms9918 == NULL)
+    return;
+
+  tmsWatchRemove(&tms9918->watches, watch);
+}
+
+/* Function:  vrEmuTms9918FlushWatches
+ * ----------------------------------------
+ * report all unreported changes
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918FlushWatches(VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL)
+    return;
+
+  TMS_WATCH_FLUSH(tms9918, true);
+}
+
+/* Function:  vrEmuTms9918StateSize
+ * ----------------------------------------
+ * size of a vrEmuTms9918SaveState() snapshot
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918StateSize(void)
+{
+  return TMS_STATE_SIZE;
+}
+
+/* Function:  vrEmuTms9918SaveState
+ * ----------------------------------------
+ * snapshot the tms9918
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918SaveState(const VrEmuTms9918* tms9918, void* buffer, size_t bufferSize)
+{
+  if (tms9918 == NULL || buffer == NULL || bufferSize < TMS_STATE_SIZE)
+    return 0;
+
+  uint8_t* state = (uint8_t*)buffer;
+  memset(state, 0, TMS_STATE_OFS_VRAM);
+
+  memcpy(state + TMS_STATE_OFS_MAGIC, TMS_STATE_MAGIC, 4);
+  state[TMS_STATE_OFS_VERSION] = TMS9918_STATE_VERSION;
+  state[TMS_STATE_OFS_STATUS] = tms9918->status;
+  state[TMS_STATE_OFS_WRITE_STAGE] = tms9918->regWriteStage;
+  state[TMS_STATE_OFS_ADDRESS] = tms9918->currentAddress & 0xff;
+  state[TMS_STATE_OFS_ADDRESS + 1] = tms9918->currentAddress >> 8;
+  memcpy(state + TMS_STATE_OFS_REGISTERS, tms9918->registers, TMS_NUM_REGISTERS);
+  memcpy(state + TMS_STATE_OFS_VRAM, tms9918->vram, VRAM_SIZE);
+
+  return TMS_STATE_SIZE;
+}
+
+/* Function:  vrEmuTms9918LoadState
+ * ----------------------------------------
+ * restore a vrEmuTms9918SaveState() snapshot
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918LoadState(VrEmuTms9918* tms9918, const void* buffer, size_t bufferSize)
+{
+  if (tms9918 == NULL || buffer == NULL || bufferSize < TMS_STATE_SIZE)
+    return false;
+
+  const uint8_t* state = (const uint8_t*)buffer;
+  if (memcmp(state + TMS_STATE_OFS_MAGIC, TMS_STATE_MAGIC, 4) != 0 ||
+      state[TMS_STATE_OFS_VERSION] != TMS9918_STATE_VERSION)
+    return false;
+
+  tms9918->status = state[TMS_STATE_OFS_STATUS];
+  tms9918->regWriteStage = state[TMS_STATE_OFS_WRITE_STAGE] & 0x01;
+  tms9918->currentAddress = (uint16_t)(state[TMS_STATE_OFS_ADDRESS] | (state[TMS_STATE_OFS_ADDRESS + 1] << 8));
+  memcpy(tms9918->registers, state + TMS_STATE_OFS_REGISTERS, TMS_NUM_REGISTERS);
+  memcpy(tms9918->vram, state + TMS_STATE_OFS_VRAM, VRAM_SIZE);
+
+#if VR_TMS9918_EMU_WRITE_LOG
+  tms9918->writeLogHead = 0;
+  tms9918->writeLogTail = 0;
+#endif
+
+  tms9918->vramPagesWritten = ~(uint64_t)0;
+  tms9918->vramPagesUnseenWritten = 0;
+  tms9918->vramPagesUnseenUpload = 0;
+
+  /* everything derived from registers and vram is stale */
+  memset(tms9918->patternRowsDirty, 0, sizeof(tms9918->patternRowsDirty));
+  tms9918->patternsDirty = false;
+  tms9918->spritesDirty = false;
+  tmsUpdateRegisterState(tms9918);
+
+  return true;
+}
+
+/* Function:  vrEmuTms9918VramPagesWritten
+ * ----------------------------------------
+ * pages of vram written since last cleared
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint64_t vrEmuTms9918VramPagesWritten(VrEmuTms9918* tms9918, bool clear)
+{
+  if (tms9918 == NULL)
+    return 0;
+
+  const uint64_t pages = tms9918->vramPagesWritten | tms9918->vramPagesUnseenWritten;
+  if (clear)
+  {
+    tms9918->vramPagesUnseenUpload |= tms9918->vramPagesWritten;
+    tms9918->vramPagesUnseenWritten = 0;
+    tms9918->vramPagesWritten = 0;
+  }
+  return pages;
+}
+
+/* Function:  vrEmuTms9918UploadVram
+ * ----------------------------------------
+ * hand each run of vram pages written since the last call to upload
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918UploadVram(VrEmuTms9918* tms9918, vrEmuTms9918UploadFn upload, void* context)
+{
+  if (tms9918 == NULL || upload == NULL)
+    return 0;
+
+  const uint64_t pages = tms9918->vramPagesWritten | tms9918->vramPagesUnseenUpload;
+  tms9918->vramPagesUnseenWritten |= tms9918->vramPagesWritten;
+  tms9918->vramPagesUnseenUpload = 0;
+  tms9918->vramPagesWritten = 0;
+
+  size_t numBytes = 0;
+  unsigned page = 0;
+  while (page < TMS9918_VRAM_PAGES)
+  {
+    if (!(pages & ((uint64_t)1 << page)))
+    {
+      ++page;
+      continue;
+    }
+
+    /* one call per run of consecutive pages */
+    const unsigned firstPage = page;
+    while (page < TMS9918_VRAM_PAGES && (pages & ((uint64_t)1 << page)))
+    {
+      ++page;
+    }
+
+    const uint16_t addr = (uint16_t)(firstPage * TMS9918_VRAM_PAGE_BYTES);
+    const size_t runBytes = (size_t)(page - firstPage) * TMS9918_VRAM_PAGE_BYTES;
+    upload(context, addr, tms9918->vram + addr, runBytes);
+    numBytes += runBytes;
+  }
+
+  return numBytes;
+}
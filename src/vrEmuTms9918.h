@@ -37,6 +37,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /* PRIVATE DATA STRUCTURE
  * ---------------------------------------- */
@@ -93,6 +94,99 @@ typedef enum
 #define TMS9918_PIXELS_X 256
 #define TMS9918_PIXELS_Y 192
 
+/* bytes in a 1 bit per pixel scanline mask (see vrEmuTms9918ScanLineLayers) */
+#define TMS9918_LINE_MASK_BYTES (TMS9918_PIXELS_X / 8)
+
+typedef struct
+{
+  uint8_t firstLine;
+  uint8_t numLines;
+} vrEmuTms9918LineRange;
+
+#define TMS9918_NUM_MODES 4
+
+/* maximum vrEmuTms9918AlignOf() */
+#define TMS9918_MAX_ALIGN 16
+
+/* vrEmuTms9918SaveState() snapshot layout version, and where vram starts
+   within a snapshot (TMS9918_VRAM_PAGES * TMS9918_VRAM_PAGE_BYTES bytes) */
+#define TMS9918_STATE_VERSION 1
+#define TMS9918_STATE_VRAM_OFFSET 32
+
+/* vram write tracking granularity (vrEmuTms9918VramPagesWritten) */
+#define TMS9918_VRAM_PAGE_BYTES 256
+#define TMS9918_VRAM_PAGES 64
+
+/* a unit of work for a vrEmuTms9918ParallelFor */
+typedef void (*vrEmuTms9918JobFn)(void* jobData, size_t jobIndex);
+
+/* run job(jobData, i) for i = 0 to numJobs - 1, potentially concurrently,
+   returning once all jobs have completed. pool is caller defined */
+typedef void (*vrEmuTms9918ParallelFor)(void* pool, size_t numJobs, vrEmuTms9918JobFn job, void* jobData);
+
+/* receives each line of a frame from vrEmuTms9918RenderFrameLines() */
+typedef void (*vrEmuTms9918LineFn)(void* context, uint8_t y, const uint8_t pixels[TMS9918_PIXELS_X]);
+
+/* receives each run of changed vram from vrEmuTms9918UploadVram() */
+typedef void (*vrEmuTms9918UploadFn)(void* context, uint16_t addr, const uint8_t* data, size_t numBytes);
+
+/* port accesses and frame timing seen by a vrEmuTms9918TraceFn
+ * ---------------------------------------- */
+typedef enum
+{
+  TMS_TRACE_WRITE_ADDR,   /* value written (mode = 1) */
+  TMS_TRACE_WRITE_DATA,   /* value written (mode = 0) */
+  TMS_TRACE_READ_STATUS,  /* value read (mode = 1) */
+  TMS_TRACE_READ_DATA,    /* value read (mode = 0) */
+  TMS_TRACE_SCANLINE,     /* scanline value generated (vrEmuTms9918ScanLine / SkipLine) */
+  TMS_TRACE_FRAME,        /* a whole frame generated (value is 0) */
+  TMS_NUM_TRACE_OPS
+} vrEmuTms9918TraceOp;
+
+/* receives each port access and generated line / frame once set with
+   vrEmuTms9918SetTraceFn(). block reads and writes are reported byte-wise */
+typedef void (*vrEmuTms9918TraceFn)(void* context, vrEmuTms9918TraceOp op, uint8_t value);
+
+/* vram watchpoints (vrEmuTms9918AddWatch) */
+#define TMS9918_MAX_WATCHES 8
+#define TMS9918_WATCH_MAX_RANGES 8  /* changed ranges reported per callback */
+
+#define TMS_WATCH_FRAME 0x00  /* report changes once per frame */
+#define TMS_WATCH_LINE  0x01  /* report changes once per scanline */
+
+typedef struct
+{
+  uint16_t addr;
+  uint16_t numBytes;
+} vrEmuTms9918VramRange;
+
+/* receives the changed ranges of a watch (see vrEmuTms9918AddWatch) */
+typedef void (*vrEmuTms9918WatchFn)(void* context, const vrEmuTms9918VramRange* ranges, size_t numRanges);
+
+/* performance counters. only collected in builds with VR_TMS9918_EMU_STATS
+ * defined. cleared by vrEmuTms9918Reset() and vrEmuTms9918ResetStats()
+ * ---------------------------------------- */
+typedef struct
+{
+  uint64_t scanLines[TMS9918_NUM_MODES];   /* scanlines generated, by vrEmuTms9918Mode */
+  uint64_t kernelTicks[TMS9918_NUM_MODES]; /* time generating them (see vrEmuTms9918SetStatsClock) */
+  uint64_t blankLines;                     /* scanlines output with the display disabled */
+  uint64_t statusOnlyLines;                /* sprite status only updates (unchanged, banded or skipped lines) */
+
+  uint64_t spriteEvaluations;              /* sprite attribute table scans */
+  uint64_t spritesProcessed;               /* sprites on a scanline (position, 5S and collision checked) */
+  uint64_t spritesDrawn;                   /* sprites on a scanline output to pixels */
+  uint64_t fifthSpriteEvents;              /* times the 5S status flag was raised */
+  uint64_t spriteCollisions;               /* sprites overlapping an earlier sprite on a scanline */
+
+  uint64_t dataWrites;                     /* bytes written to vram */
+  uint64_t dataReads;                      /* bytes read from vram */
+  uint64_t statusReads;
+  uint64_t registerWrites;
+  uint64_t modeSwitches;                   /* display mode changes */
+  uint64_t midFrameModeSwitches;           /* display mode changes while a frame was partially generated */
+} vrEmuTms9918Stats;
+
 
 /* PUBLIC INTERFACE
  * ---------------------------------------- */
@@ -104,6 +198,32 @@ typedef enum
 VR_EMU_TMS9918_DLLEXPORT
 VrEmuTms9918* vrEmuTms9918New();
 
+/* Function:  vrEmuTms9918SizeOf
+ * --------------------
+ * bytes required by vrEmuTms9918Init()
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918SizeOf(void);
+
+/* Function:  vrEmuTms9918AlignOf
+ * --------------------
+ * alignment required by vrEmuTms9918Init(). never more than
+ * TMS9918_MAX_ALIGN, so malloc()ed memory is always suitable
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918AlignOf(void);
+
+/* Function:  vrEmuTms9918Init
+ * --------------------
+ * create a TMS9918 in caller provided memory (eg. static memory or an arena) of
+ * at least vrEmuTms9918SizeOf() bytes, aligned to vrEmuTms9918AlignOf()
+ *
+ * returns NULL if mem is NULL or misaligned. don't vrEmuTms9918Destroy() the
+ * result. the memory can simply be released when no longer required
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918* vrEmuTms9918Init(void* mem);
+
 /* Function:  vrEmuTms9918Reset
   * --------------------
   * reset the new TMS9918
@@ -138,6 +258,15 @@ void vrEmuTms9918WriteAddr(VrEmuTms9918* tms9918, uint8_t data);
 VR_EMU_TMS9918_DLLEXPORT
 void vrEmuTms9918WriteData(VrEmuTms9918* tms9918, uint8_t data);
 
+/* Function:  vrEmuTms9918WriteBlock
+ * --------------------
+ * write a block of data (mode = 0) to the tms9918
+ *
+ * equivalent to numBytes calls to vrEmuTms9918WriteData()
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918WriteBlock(VrEmuTms9918* tms9918, const uint8_t* data, size_t numBytes);
+
 /* Function:  vrEmuTms9918ReadStatus
  * --------------------
  * read from the status register
@@ -160,6 +289,64 @@ uint8_t vrEmuTms9918ReadData(VrEmuTms9918* tms9918);
 VR_EMU_TMS9918_DLLEXPORT
 uint8_t vrEmuTms9918ReadDataNoInc(VrEmuTms9918* tms9918);
 
+/* Function:  vrEmuTms9918ReadBlock
+ * --------------------
+ * read a block of data (mode = 0) from the tms9918
+ *
+ * equivalent to numBytes calls to vrEmuTms9918ReadData()
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918ReadBlock(VrEmuTms9918* tms9918, uint8_t* data, size_t numBytes);
+
+/* Function:  vrEmuTms9918LogWriteAddr
+ * --------------------
+ * queue an address write (mode = 1) in the write log, to be applied by
+ * the next vrEmuTms9918RenderFrame() before scanline 'line' is generated.
+ *
+ * lets the cpu run a whole frame before the frame is generated, while
+ * raster effects still take effect on the right line. lines >=
+ * TMS9918_PIXELS_Y (vblank) are applied once the frame is complete.
+ * timestamps must not decrease (earlier ones are treated as the latest).
+ *
+ * vrEmuTms9918RenderFrameLines() (and so vrEmuTms9918RenderFrameToSurface())
+ * applies it at each line too. vrEmuTms9918SkipFrame(),
+ * vrEmuTms9918UpdateFrameStatus(), vrEmuTms9918RenderFrameParallel(),
+ * vrEmuTms9918RenderFrameIncremental(), vrEmuTms9918DirtyLineRanges() and
+ * vrEmuTms9918GpuBeginFrame() apply the whole log before generating
+ * anything. the line functions (vrEmuTms9918ScanLine(),
+ * vrEmuTms9918ScanLineLayers(), vrEmuTms9918SkipLine() and
+ * vrEmuTms9918RenderLines()) leave it queued, as do reads and direct
+ * writes; call vrEmuTms9918FlushWriteLog() first to apply it. if the log
+ * is full, it is applied immediately, followed by this write
+ *
+ * the log is only built with VR_TMS9918_EMU_WRITE_LOG defined (adding
+ * VR_TMS9918_EMU_WRITE_LOG_SIZE * 4 bytes to each instance). otherwise the
+ * write is applied immediately, and timing is lost
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918LogWriteAddr(VrEmuTms9918* tms9918, uint16_t line, uint8_t data);
+
+/* Function:  vrEmuTms9918LogWriteData
+ * --------------------
+ * queue a data write (mode = 0) in the write log. see vrEmuTms9918LogWriteAddr()
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918LogWriteData(VrEmuTms9918* tms9918, uint16_t line, uint8_t data);
+
+/* Function:  vrEmuTms9918FlushWriteLog
+ * --------------------
+ * apply all queued writes now
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918FlushWriteLog(VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918WriteLogSize
+ * --------------------
+ * number of queued writes
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918WriteLogSize(const VrEmuTms9918* tms9918);
+
 
 /* Function:  vrEmuTms9918ScanLine
  * ----------------------------------------
@@ -170,6 +357,133 @@ uint8_t vrEmuTms9918ReadDataNoInc(VrEmuTms9918* tms9918);
 VR_EMU_TMS9918_DLLEXPORT
 void vrEmuTms9918ScanLine(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X]);
 
+/* Function:  vrEmuTms9918ScanLineLayers
+ * ----------------------------------------
+ * vrEmuTms9918ScanLine(), also producing 1 bit per pixel layer masks for
+ * compositing. masks are TMS9918_LINE_MASK_BYTES, msb first (pixel 0 is
+ * bit 7 of byte 0), and are built from the pattern and color bytes 8
+ * pixels at a time rather than by scanning pixels
+ *
+ * transparentMask: set for pixels showing the backdrop. that is tile and
+ * sprite pixels of color TMS_TRANSPARENT with no opaque sprite in front,
+ * the Text mode background and padding, or the whole line while the display
+ * is blanked. with TMS_R0_EXT_VDP_ENABLE set and a TMS_TRANSPARENT
+ * backdrop, these pixels show the external video
+ *
+ * spriteMask (optional): set for pixels drawn by a sprite
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918ScanLineLayers(VrEmuTms9918* tms9918, uint8_t y, uint8_t pixels[TMS9918_PIXELS_X],
+                                uint8_t transparentMask[TMS9918_LINE_MASK_BYTES], uint8_t* spriteMask);
+
+/* Function:  vrEmuTms9918RenderFrame
+ * ----------------------------------------
+ * generate all TMS9918_PIXELS_Y scanlines of a frame
+ *
+ * equivalent to calling vrEmuTms9918ScanLine() for each line in turn
+ * (including status register updates), but with per-frame state
+ * resolved only once.
+ *
+ * writes queued by vrEmuTms9918LogWriteAddr() / vrEmuTms9918LogWriteData()
+ * are applied as their line is reached
+ *
+ * framebuffer: TMS9918_PIXELS_Y rows of TMS9918_PIXELS_X palette indexes
+ * pitch: bytes between the start of each row (>= TMS9918_PIXELS_X)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderFrame(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch);
+
+/* Function:  vrEmuTms9918RenderFrameLines
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame(), but rather than storing the frame, each line
+ * is handed to lineFn(context, y, pixels) as soon as it's generated (eg.
+ * to convert it straight into a texture, see vrEmuTms9918Output.h).
+ * pixels is only valid during the call
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderFrameLines(VrEmuTms9918* tms9918, vrEmuTms9918LineFn lineFn, void* context);
+
+/* Function:  vrEmuTms9918UpdateFrameStatus
+ * ----------------------------------------
+ * update the status register (5S, fifth sprite, collision and INT) as if a
+ * whole frame had been generated, without generating any pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918UpdateFrameStatus(VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918SkipLine
+ * ----------------------------------------
+ * vrEmuTms9918ScanLine() for a line that won't be displayed: updates the
+ * status register (5S, fifth sprite, collision and INT) exactly as
+ * generating it would, without decoding tiles or writing pixels
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SkipLine(VrEmuTms9918* tms9918, uint8_t y);
+
+/* Function:  vrEmuTms9918SkipFrame
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame() for a frame that won't be displayed (eg. when
+ * fast-forwarding). applies queued writes line by line as rendering would,
+ * so the status register ends up identical
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SkipFrame(VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918RenderLines
+ * ----------------------------------------
+ * generate the pixels of scanlines firstLine to firstLine + numLines - 1
+ * into framebuffer (line y at framebuffer + y * pitch)
+ *
+ * doesn't modify the tms9918, so may be called concurrently for different
+ * lines. call vrEmuTms9918UpdateFrameStatus() once for the frame first, and
+ * don't write to the tms9918 until all lines are complete
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderLines(const VrEmuTms9918* tms9918, uint8_t firstLine, uint8_t numLines,
+                             uint8_t* framebuffer, size_t pitch);
+
+/* Function:  vrEmuTms9918RenderFrameParallel
+ * ----------------------------------------
+ * generate a frame as numBands bands of lines, run via parallelFor
+ *
+ * equivalent to vrEmuTms9918RenderFrame(). the status register is updated
+ * sequentially first. if parallelFor is NULL, the bands are generated in
+ * turn on the calling thread. see vrEmuTms9918Workers.h for a built-in pool
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderFrameParallel(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch,
+                                     uint8_t numBands, vrEmuTms9918ParallelFor parallelFor, void* pool);
+
+/* Function:  vrEmuTms9918RenderFrameIncremental
+ * ----------------------------------------
+ * as vrEmuTms9918RenderFrame(), but only regenerate lines whose inputs
+ * (vram tables, sprites or registers) have changed since the last call.
+ *
+ * framebuffer must hold the output of the previous call. status register
+ * updates are identical to vrEmuTms9918RenderFrame()
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderFrameIncremental(VrEmuTms9918* tms9918, uint8_t* framebuffer, size_t pitch);
+
+/* Function:  vrEmuTms9918DirtyLineRanges
+ * ----------------------------------------
+ * get the line ranges the next vrEmuTms9918RenderFrameIncremental() call
+ * will regenerate (eg. for partial texture uploads)
+ *
+ * returns the number of ranges written. if there are more than maxRanges,
+ * the last range is extended to cover the remainder
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918DirtyLineRanges(VrEmuTms9918* tms9918, vrEmuTms9918LineRange* ranges, size_t maxRanges);
+
+/* Function:  vrEmuTms9918InvalidateFrame
+ * ----------------------------------------
+ * force the next vrEmuTms9918RenderFrameIncremental() to regenerate every
+ * line (eg. when switching to a new framebuffer)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918InvalidateFrame(VrEmuTms9918* tms9918);
+
 /* Function:  vrEmuTms9918RegValue
  * ----------------------------------------
  * return a reigister value
@@ -200,5 +514,126 @@ uint8_t vrEmuTms9918VramValue(VrEmuTms9918* tms9918, uint16_t addr);
 VR_EMU_TMS9918_DLLEXPORT
 bool vrEmuTms9918DisplayEnabled(VrEmuTms9918* tms9918);
 
+/* Function:  vrEmuTms9918GetStats
+ * ----------------------------------------
+ * copy the performance counters
+ *
+ * returns false (and zeroes stats) if built without VR_TMS9918_EMU_STATS
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918GetStats(VrEmuTms9918* tms9918, vrEmuTms9918Stats* stats);
+
+/* Function:  vrEmuTms9918ResetStats
+ * ----------------------------------------
+ * clear the performance counters
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918ResetStats(VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918SetStatsClock
+ * ----------------------------------------
+ * set a clock (eg. a cycle counter or nanosecond timestamp) used to total
+ * vrEmuTms9918Stats::kernelTicks. NULL (the default) disables timing
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SetStatsClock(VrEmuTms9918* tms9918, uint64_t (*clockFn)(void));
+
+/* Function:  vrEmuTms9918SetTraceFn
+ * ----------------------------------------
+ * report every port access, scanline and frame to traceFn(context, ...),
+ * in order (eg. to record a trace, see vrEmuTms9918Trace.h). queued writes
+ * are reported when they are applied. NULL (the default) stops tracing
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918SetTraceFn(VrEmuTms9918* tms9918, vrEmuTms9918TraceFn traceFn, void* context);
+
+/* Function:  vrEmuTms9918AddWatch
+ * ----------------------------------------
+ * watch numBytes of vram from addr (not wrapping) for changes through the
+ * data port (vrEmuTms9918WriteData / WriteBlock, including queued writes).
+ * writes that leave a byte unchanged are ignored. changes are coalesced
+ * into at most TMS9918_WATCH_MAX_RANGES ranges (merged ranges may cover
+ * unchanged bytes) and handed to watchFn(context, ...) at the next frame
+ * boundary (a whole frame call, or scanline 0) or, with TMS_WATCH_LINE,
+ * the next scanline. state loads aren't reported
+ *
+ * writes cost a single test unless they're near a watch
+ *
+ * returns the watch number, or -1 if all TMS9918_MAX_WATCHES are in use
+ */
+VR_EMU_TMS9918_DLLEXPORT
+int vrEmuTms9918AddWatch(VrEmuTms9918* tms9918, uint16_t addr, uint16_t numBytes, unsigned flags,
+                         vrEmuTms9918WatchFn watchFn, void* context);
+
+/* Function:  vrEmuTms9918RemoveWatch
+ * ----------------------------------------
+ * remove a watch. unreported changes are dropped
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RemoveWatch(VrEmuTms9918* tms9918, int watch);
+
+/* Function:  vrEmuTms9918FlushWatches
+ * ----------------------------------------
+ * report all unreported changes now (eg. when a debugger pauses mid-frame)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918FlushWatches(VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918StateSize
+ * ----------------------------------------
+ * size in bytes of a vrEmuTms9918SaveState() snapshot
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918StateSize(void);
+
+/* Function:  vrEmuTms9918SaveState
+ * ----------------------------------------
+ * snapshot the registers, status, address, write stage and vram
+ *
+ * the snapshot is a flat, versioned (TMS9918_STATE_VERSION) block of
+ * vrEmuTms9918StateSize() bytes that can be copied or compared with
+ * memcpy / memcmp. queued (logged) writes aren't included
+ *
+ * returns the number of bytes written, or 0 if buffer is too small
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918SaveState(const VrEmuTms9918* tms9918, void* buffer, size_t bufferSize);
+
+/* Function:  vrEmuTms9918LoadState
+ * ----------------------------------------
+ * restore a vrEmuTms9918SaveState() snapshot. queued writes are discarded
+ *
+ * returns false (leaving the tms9918 unchanged) if the snapshot is too
+ * small or isn't a TMS9918_STATE_VERSION snapshot
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918LoadState(VrEmuTms9918* tms9918, const void* buffer, size_t bufferSize);
+
+/* Function:  vrEmuTms9918VramPagesWritten
+ * ----------------------------------------
+ * bit mask of the TMS9918_VRAM_PAGE_BYTES pages of vram written (bit n for
+ * page n) since the mask was last cleared. all pages are set initially and
+ * after vrEmuTms9918LoadState()
+ *
+ * clear: reset the mask once read
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint64_t vrEmuTms9918VramPagesWritten(VrEmuTms9918* tms9918, bool clear);
+
+/* Function:  vrEmuTms9918UploadVram
+ * ----------------------------------------
+ * call upload(context, addr, data, numBytes) for each run of whole
+ * TMS9918_VRAM_PAGE_BYTES pages written since the last call (all of vram
+ * on the first call and after vrEmuTms9918LoadState()). eg. to keep a GPU
+ * copy of vram up to date (see vrEmuTms9918Gpu.h). data points into vram
+ * and is only valid during the call
+ *
+ * tracked independently of vrEmuTms9918VramPagesWritten()
+ *
+ * returns the number of bytes passed to upload
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918UploadVram(VrEmuTms9918* tms9918, vrEmuTms9918UploadFn upload, void* context);
+
 
 #endif // _VR_EMU_TMS9918_H_
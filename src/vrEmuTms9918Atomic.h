@@ -0,0 +1,48 @@
+/*
+ * Troy's TMS9918 Emulator - Atomics (internal)
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_ATOMIC_H_
+#define _VR_EMU_TMS9918_ATOMIC_H_
+
+/* the minimum needed for the lock-free hand offs between an emulation
+   thread and a display / cpu thread (vrEmuTms9918Frames.c,
+   vrEmuTms9918PortQueue.c and the VideoDisplayProcessor library's
+   equivalents). loads acquire, stores release and exchanges do both */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+
+  /* Interlocked functions are full barriers */
+  typedef volatile LONG tmsAtomicU32;
+
+  #define tmsAtomicInit(a, v)       (*(a) = (LONG)(v))
+  #define tmsAtomicLoad(a)          ((uint32_t)InterlockedCompareExchange((a), 0, 0))
+  #define tmsAtomicStore(a, v)      ((void)InterlockedExchange((a), (LONG)(v)))
+  #define tmsAtomicExchange(a, v)   ((uint32_t)InterlockedExchange((a), (LONG)(v)))
+
+  #define tmsThreadYield()          SwitchToThread()
+#else
+  #include <sched.h>
+  #include <stdatomic.h>
+
+  typedef _Atomic uint32_t tmsAtomicU32;
+
+  #define tmsAtomicInit(a, v)       atomic_init((a), (v))
+  #define tmsAtomicLoad(a)          atomic_load_explicit((a), memory_order_acquire)
+  #define tmsAtomicStore(a, v)      atomic_store_explicit((a), (v), memory_order_release)
+  #define tmsAtomicExchange(a, v)   atomic_exchange_explicit((a), (v), memory_order_acq_rel)
+
+  #define tmsThreadYield()          sched_yield()
+#endif
+
+#endif // _VR_EMU_TMS9918_ATOMIC_H_
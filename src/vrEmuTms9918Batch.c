@@ -0,0 +1,214 @@
+/*
+ * Troy's TMS9918 Emulator - Multi-instance batch
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Batch.h"
+#include <stdlib.h>
+
+/* instances don't share cache lines, so neighbours can render concurrently */
+#define BATCH_CACHE_LINE       64
+
+/* instances per parallelFor job */
+#define BATCH_INSTANCES_PER_JOB 8
+
+ /* PRIVATE DATA STRUCTURE
+  * ---------------------- */
+struct vrEmuTms9918Batch_s
+{
+  /* the allocation, and the first (cache line aligned) instance within it */
+  void* allocation;
+  uint8_t* instances;
+
+  /* bytes between instances */
+  size_t stride;
+
+  size_t numInstances;
+};
+
+ /* a vrEmuTms9918BatchRenderFrames() call
+  * ---------------------- */
+typedef struct
+{
+  VrEmuTms9918Batch* batch;
+  uint8_t* framebuffers;
+  size_t frameStride;
+  size_t pitch;
+} tmsBatchRenderJob;
+
+
+/* Function:  tmsBatchInstance
+ * ----------------------------------------
+ * instance at index (unchecked)
+ */
+static inline VrEmuTms9918* tmsBatchInstance(VrEmuTms9918Batch* batch, size_t index)
+{
+  return (VrEmuTms9918*)(batch->instances + index * batch->stride);
+}
+
+/* Function:  tmsBatchRender
+ * ----------------------------------------
+ * vrEmuTms9918JobFn rendering a group of instances
+ */
+static void tmsBatchRender(void* jobData, size_t jobIndex)
+{
+  const tmsBatchRenderJob* job = (const tmsBatchRenderJob*)jobData;
+
+  size_t end = (jobIndex + 1) * BATCH_INSTANCES_PER_JOB;
+  if (end > job->batch->numInstances) end = job->batch->numInstances;
+
+  for (size_t i = jobIndex * BATCH_INSTANCES_PER_JOB; i < end; ++i)
+  {
+    vrEmuTms9918RenderFrame(tmsBatchInstance(job->batch, i), job->framebuffers + i * job->frameStride, job->pitch);
+  }
+}
+
+
+/* Function:  vrEmuTms9918BatchNew
+ * ----------------------------------------
+ * create a batch of instances
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918Batch* vrEmuTms9918BatchNew(size_t numInstances)
+{
+  const size_t stride = (vrEmuTms9918SizeOf() + BATCH_CACHE_LINE - 1) & ~(size_t)(BATCH_CACHE_LINE - 1);
+
+  if (numInstances == 0 || numInstances > (SIZE_MAX - BATCH_CACHE_LINE) / stride)
+    return NULL;
+
+  VrEmuTms9918Batch* batch = (VrEmuTms9918Batch*)malloc(sizeof(VrEmuTms9918Batch));
+  if (batch == NULL)
+    return NULL;
+
+  /* cache line multiples also satisfy vrEmuTms9918AlignOf() (<= TMS9918_MAX_ALIGN) */
+  batch->stride = stride;
+  batch->numInstances = numInstances;
+
+  batch->allocation = malloc(numInstances * batch->stride + BATCH_CACHE_LINE);
+  if (batch->allocation == NULL)
+  {
+    free(batch);
+    return NULL;
+  }
+
+  batch->instances = (uint8_t*)(((uintptr_t)batch->allocation + BATCH_CACHE_LINE - 1) & ~(uintptr_t)(BATCH_CACHE_LINE - 1));
+
+  for (size_t i = 0; i < numInstances; ++i)
+  {
+    vrEmuTms9918Init(tmsBatchInstance(batch, i));
+  }
+
+  return batch;
+}
+
+/* Function:  vrEmuTms9918BatchDestroy
+ * ----------------------------------------
+ * destroy a batch
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918BatchDestroy(VrEmuTms9918Batch* batch)
+{
+  if (batch == NULL)
+    return;
+
+  free(batch->allocation);
+  free(batch);
+}
+
+/* Function:  vrEmuTms9918BatchSize
+ * ----------------------------------------
+ * number of instances in the batch
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918BatchSize(const VrEmuTms9918Batch* batch)
+{
+  return batch ? batch->numInstances : 0;
+}
+
+/* Function:  vrEmuTms9918BatchInstance
+ * ----------------------------------------
+ * an instance of the batch
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918* vrEmuTms9918BatchInstance(VrEmuTms9918Batch* batch, size_t index)
+{
+  if (batch == NULL || index >= batch->numInstances)
+    return NULL;
+
+  return tmsBatchInstance(batch, index);
+}
+
+/* Function:  vrEmuTms9918BatchWrite
+ * ----------------------------------------
+ * queue port writes for instances in the batch
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918BatchWrite(VrEmuTms9918Batch* batch, const vrEmuTms9918PortWrite* writes, size_t numWrites)
+{
+  if (batch == NULL || writes == NULL)
+    return;
+
+  for (size_t i = 0; i < numWrites; ++i)
+  {
+    const vrEmuTms9918PortWrite* write = &writes[i];
+    if (write->instance >= batch->numInstances)
+      continue;
+
+    VrEmuTms9918* tms9918 = tmsBatchInstance(batch, write->instance);
+    if (write->mode)
+    {
+      vrEmuTms9918LogWriteAddr(tms9918, write->line, write->data);
+    }
+    else
+    {
+      vrEmuTms9918LogWriteData(tms9918, write->line, write->data);
+    }
+  }
+}
+
+/* Function:  vrEmuTms9918BatchRenderFrames
+ * ----------------------------------------
+ * render a frame for every instance
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918BatchRenderFrames(VrEmuTms9918Batch* batch, uint8_t* framebuffers, size_t frameStride, size_t pitch,
+                                                            vrEmuTms9918ParallelFor parallelFor, void* pool)
+{
+  if (batch == NULL || framebuffers == NULL)
+    return;
+
+  tmsBatchRenderJob job;
+  job.batch = batch;
+  job.framebuffers = framebuffers;
+  job.frameStride = frameStride;
+  job.pitch = pitch;
+
+  const size_t numJobs = (batch->numInstances + BATCH_INSTANCES_PER_JOB - 1) / BATCH_INSTANCES_PER_JOB;
+
+  if (parallelFor != NULL)
+  {
+    parallelFor(pool, numJobs, tmsBatchRender, &job);
+  }
+  else
+  {
+    for (size_t i = 0; i < numJobs; ++i)
+    {
+      tmsBatchRender(&job, i);
+    }
+  }
+}
+
+/* Function:  vrEmuTms9918BatchReadStatus
+ * ----------------------------------------
+ * read the status register of every instance
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918BatchReadStatus(VrEmuTms9918Batch* batch, uint8_t* status)
+{
+  if (batch == NULL || status == NULL)
+    return;
+
+  for (size_t i = 0; i < batch->numInstances; ++i)
+  {
+    status[i] = vrEmuTms9918ReadStatus(tmsBatchInstance(batch, i));
+  }
+}
@@ -0,0 +1,95 @@
+/*
+ * Troy's TMS9918 Emulator - Multi-instance batch
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_BATCH_H_
+#define _VR_EMU_TMS9918_BATCH_H_
+
+#include "vrEmuTms9918.h"
+
+/* PRIVATE DATA STRUCTURE
+ * ---------------------------------------- */
+struct vrEmuTms9918Batch_s;
+typedef struct vrEmuTms9918Batch_s VrEmuTms9918Batch;
+
+/* a port write destined for one instance of a batch
+ * ---------------------------------------- */
+typedef struct
+{
+  uint32_t instance;  /* instance index */
+  uint16_t line;      /* scanline it occurred on (see vrEmuTms9918LogWriteAddr) */
+  uint8_t mode;       /* 1 = address / register (WriteAddr), 0 = data (WriteData) */
+  uint8_t data;
+} vrEmuTms9918PortWrite;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918BatchNew
+ * ----------------------------------------
+ * create numInstances TMS9918s in a single contiguous allocation. each
+ * instance starts on its own cache line
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Batch* vrEmuTms9918BatchNew(size_t numInstances);
+
+/* Function:  vrEmuTms9918BatchDestroy
+ * ----------------------------------------
+ * destroy a batch and all of its instances
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918BatchDestroy(VrEmuTms9918Batch* batch);
+
+/* Function:  vrEmuTms9918BatchSize
+ * ----------------------------------------
+ * number of instances in the batch
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918BatchSize(const VrEmuTms9918Batch* batch);
+
+/* Function:  vrEmuTms9918BatchInstance
+ * ----------------------------------------
+ * an instance of the batch, for use with any vrEmuTms9918 function
+ * (except vrEmuTms9918Destroy). NULL if index is out of range
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918* vrEmuTms9918BatchInstance(VrEmuTms9918Batch* batch, size_t index);
+
+/* Function:  vrEmuTms9918BatchWrite
+ * ----------------------------------------
+ * queue port writes for any instances in the batch. each is added to its
+ * instance's write log, so it's applied at its line by the next
+ * vrEmuTms9918BatchRenderFrames() (in builds with VR_TMS9918_EMU_WRITE_LOG,
+ * otherwise immediately). writes for an out of range instance are ignored
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918BatchWrite(VrEmuTms9918Batch* batch, const vrEmuTms9918PortWrite* writes, size_t numWrites);
+
+/* Function:  vrEmuTms9918BatchRenderFrames
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame() for every instance. instance i renders to
+ * framebuffers + i * frameStride (rows pitch bytes apart)
+ *
+ * instances are shared between parallelFor jobs (NULL to render on the
+ * calling thread). see vrEmuTms9918Workers.h for a built-in pool
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918BatchRenderFrames(VrEmuTms9918Batch* batch, uint8_t* framebuffers, size_t frameStride, size_t pitch,
+                                   vrEmuTms9918ParallelFor parallelFor, void* pool);
+
+/* Function:  vrEmuTms9918BatchReadStatus
+ * ----------------------------------------
+ * vrEmuTms9918ReadStatus() for every instance. status[i] for instance i
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918BatchReadStatus(VrEmuTms9918Batch* batch, uint8_t* status);
+
+#endif // _VR_EMU_TMS9918_BATCH_H_
@@ -0,0 +1,136 @@
+/*
+ * Troy's TMS9918 Emulator - Triple-buffered frame output
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Frames.h"
+#include "vrEmuTms9918Atomic.h"
+#include <stdlib.h>
+
+#define FRAME_BUFFERS       3
+#define FRAME_BYTES         (TMS9918_PIXELS_X * TMS9918_PIXELS_Y)
+
+/* set in the shared slot when it holds a frame the display thread hasn't seen */
+#define FRAME_SLOT_FRESH    0x04
+#define FRAME_SLOT_INDEX    0x03
+
+ /* PRIVATE DATA STRUCTURE
+  * ---------------------- */
+struct vrEmuTms9918Frames_s
+{
+  uint8_t pixels[FRAME_BUFFERS][FRAME_BYTES];
+
+  /* number of the frame in each buffer. written by whichever thread owns
+     the buffer, so it's handed over with the buffer by the exchange */
+  uint64_t frameNumbers[FRAME_BUFFERS];
+
+  /* emulation thread only */
+  uint32_t back;
+  uint64_t published;
+
+  /* display thread only */
+  uint32_t front;
+
+  /* the latest finished frame: buffer index | FRAME_SLOT_FRESH */
+  tmsAtomicU32 shared;
+};
+
+
+/* Function:  vrEmuTms9918FramesNew
+ * ----------------------------------------
+ * create a set of frame buffers
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918Frames* vrEmuTms9918FramesNew(void)
+{
+  VrEmuTms9918Frames* frames = (VrEmuTms9918Frames*)calloc(1, sizeof(VrEmuTms9918Frames));
+  if (frames == NULL)
+    return NULL;
+
+  frames->back = 0;
+  frames->front = 1;
+  tmsAtomicInit(&frames->shared, 2);
+
+  return frames;
+}
+
+/* Function:  vrEmuTms9918FramesDestroy
+ * ----------------------------------------
+ * destroy a set of frame buffers
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918FramesDestroy(VrEmuTms9918Frames* frames)
+{
+  free(frames);
+}
+
+/* Function:  vrEmuTms9918FramesBackBuffer
+ * ----------------------------------------
+ * the buffer to render the next frame into
+ */
+VR_EMU_TMS9918_DLLEXPORT uint8_t* vrEmuTms9918FramesBackBuffer(VrEmuTms9918Frames* frames)
+{
+  if (frames == NULL)
+    return NULL;
+
+  return frames->pixels[frames->back];
+}
+
+/* Function:  vrEmuTms9918FramesPublish
+ * ----------------------------------------
+ * make the back buffer the latest finished frame
+ */
+VR_EMU_TMS9918_DLLEXPORT uint64_t vrEmuTms9918FramesPublish(VrEmuTms9918Frames* frames)
+{
+  if (frames == NULL)
+    return 0;
+
+  frames->frameNumbers[frames->back] = ++frames->published;
+
+  /* whatever was in the shared slot (seen or not) becomes the new back buffer */
+  frames->back = tmsAtomicExchange(&frames->shared, frames->back | FRAME_SLOT_FRESH) & FRAME_SLOT_INDEX;
+
+  return frames->published;
+}
+
+/* Function:  vrEmuTms9918FramesRender
+ * ----------------------------------------
+ * render a frame into the back buffer and publish it
+ */
+VR_EMU_TMS9918_DLLEXPORT uint64_t vrEmuTms9918FramesRender(VrEmuTms9918Frames* frames, VrEmuTms9918* tms9918)
+{
+  if (frames == NULL || tms9918 == NULL)
+    return 0;
+
+  vrEmuTms9918RenderFrame(tms9918, frames->pixels[frames->back], TMS9918_PIXELS_X);
+
+  return vrEmuTms9918FramesPublish(frames);
+}
+
+/* Function:  vrEmuTms9918FramesAcquire
+ * ----------------------------------------
+ * the latest finished frame
+ */
+VR_EMU_TMS9918_DLLEXPORT const uint8_t* vrEmuTms9918FramesAcquire(VrEmuTms9918Frames* frames, uint64_t* frameNumber)
+{
+  if (frames == NULL)
+    return NULL;
+
+  /* only the emulation thread sets FRAME_SLOT_FRESH, so once seen it stays
+     set until the exchange below */
+  if (tmsAtomicLoad(&frames->shared) & FRAME_SLOT_FRESH)
+  {
+    frames->front = tmsAtomicExchange(&frames->shared, frames->front) & FRAME_SLOT_INDEX;
+  }
+
+  if (frameNumber)
+  {
+    *frameNumber = frames->frameNumbers[frames->front];
+  }
+
+  return frames->pixels[frames->front];
+}
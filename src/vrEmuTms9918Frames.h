@@ -0,0 +1,93 @@
+/*
+ * Troy's TMS9918 Emulator - Triple-buffered frame output
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_FRAMES_H_
+#define _VR_EMU_TMS9918_FRAMES_H_
+
+#include "vrEmuTms9918.h"
+
+/* PRIVATE DATA STRUCTURE
+ * ---------------------------------------- */
+struct vrEmuTms9918Frames_s;
+typedef struct vrEmuTms9918Frames_s VrEmuTms9918Frames;
+
+
+/* PUBLIC INTERFACE
+ * ----------------------------------------
+ *
+ * three frames of TMS9918_PIXELS_Y rows of TMS9918_PIXELS_X palette
+ * indexes: a back buffer owned by the emulation thread, a front buffer
+ * owned by the display thread, and the latest finished frame between
+ * them. publishing and acquiring swap buffer indexes atomically, so
+ * neither thread waits for the other and no pixels are copied
+ *
+ * one thread may render / publish while one other thread acquires
+ */
+
+/* Function:  vrEmuTms9918FramesNew
+ * ----------------------------------------
+ * create a set of frame buffers. every buffer starts at index 0
+ * (TMS_TRANSPARENT)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Frames* vrEmuTms9918FramesNew(void);
+
+/* Function:  vrEmuTms9918FramesDestroy
+ * ----------------------------------------
+ * destroy a set of frame buffers. neither thread may be using them
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918FramesDestroy(VrEmuTms9918Frames* frames);
+
+/* Function:  vrEmuTms9918FramesBackBuffer
+ * ----------------------------------------
+ * the buffer to render the next frame into (rows TMS9918_PIXELS_X bytes
+ * apart). emulation thread only. it changes with each publish
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint8_t* vrEmuTms9918FramesBackBuffer(VrEmuTms9918Frames* frames);
+
+/* Function:  vrEmuTms9918FramesPublish
+ * ----------------------------------------
+ * make the back buffer the latest finished frame, and take a new back
+ * buffer. emulation thread only. returns the frame's number (1 for the
+ * first frame published)
+ *
+ * a frame that was never acquired is recycled as the new back buffer
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint64_t vrEmuTms9918FramesPublish(VrEmuTms9918Frames* frames);
+
+/* Function:  vrEmuTms9918FramesRender
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame() into the back buffer, then publish it.
+ * returns the frame's number
+ *
+ * the frame is published by the time this returns, so raise the host's
+ * vsync interrupt (the 0x80 bit of vrEmuTms9918ReadStatus()) after
+ * the call rather than during it
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint64_t vrEmuTms9918FramesRender(VrEmuTms9918Frames* frames, VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918FramesAcquire
+ * ----------------------------------------
+ * the latest finished frame (rows TMS9918_PIXELS_X bytes apart). display
+ * thread only. it stays valid and unchanged until the next acquire
+ *
+ * frameNumber (may be NULL) is set to its number, 0 if no frame has
+ * been published yet. when nothing new has been published, the same
+ * frame is returned again
+ */
+VR_EMU_TMS9918_DLLEXPORT
+const uint8_t* vrEmuTms9918FramesAcquire(VrEmuTms9918Frames* frames, uint64_t* frameNumber);
+
+#endif // _VR_EMU_TMS9918_FRAMES_H_
@@ -0,0 +1,59 @@
+/*
+ * Troy's TMS9918 Emulator - GPU rendering backend
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Gpu.h"
+#include "vrEmuTms9918Util.h"
+#include <string.h>
+
+/* Function:  vrEmuTms9918GpuInitUniforms
+ * ----------------------------------------
+ * set up uniforms with a palette
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918GpuInitUniforms(vrEmuTms9918GpuUniforms* uniforms, const uint32_t* palette)
+{
+  if (uniforms == NULL)
+    return;
+
+  if (palette == NULL)
+    palette = vrEmuTms9918Palette;
+
+  memset(uniforms->registers, 0, sizeof(uniforms->registers));
+
+  for (int i = 0; i < 16; ++i)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      uniforms->palette[i][c] = (float)((palette[i] >> (24 - c * 8)) & 0xff) / 255.0f;
+    }
+  }
+}
+
+/* Function:  vrEmuTms9918GpuBeginFrame
+ * ----------------------------------------
+ * the cpu's part of a frame rendered on the GPU
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918GpuBeginFrame(VrEmuTms9918* tms9918, vrEmuTms9918UploadFn upload, void* context,
+                                                          vrEmuTms9918GpuUniforms* uniforms)
+{
+  if (tms9918 == NULL || upload == NULL || uniforms == NULL)
+    return 0;
+
+  /* applies the write log first, so vram and the registers are as the
+     shaders will draw them */
+  vrEmuTms9918UpdateFrameStatus(tms9918);
+
+  for (int i = 0; i < TMS_NUM_REGISTERS; ++i)
+  {
+    uniforms->registers[i] = vrEmuTms9918RegValue(tms9918, (vrEmuTms9918Register)i);
+  }
+
+  return vrEmuTms9918UploadVram(tms9918, upload, context);
+}
@@ -0,0 +1,70 @@
+/*
+ * Troy's TMS9918 Emulator - GPU rendering backend
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_GPU_H_
+#define _VR_EMU_TMS9918_GPU_H_
+
+#include "vrEmuTms9918.h"
+
+/* frames are composed on the GPU by the reference shaders in shaders/
+ * (vrEmuTms9918.vert / .frag for GLSL 3.30, vrEmuTms9918.metal), which
+ * reproduce the vrEmuTms9918RenderFrame() tile and sprite kernels pixel for
+ * pixel from a copy of vram and the registers. the status register is still
+ * computed on the cpu: vrEmuTms9918GpuBeginFrame() runs the sequential
+ * status pass (vrEmuTms9918UpdateFrameStatus()) in place of the frame.
+ *
+ * queued writes (vrEmuTms9918LogWriteData() etc.) are applied before the
+ * frame, so mid-frame changes show from the top of the frame */
+
+/* the vram texture the shaders read: single channel 8-bit unsigned integer
+   texels (GL_R8UI, MTLPixelFormatR8Uint), vram address a at
+   (a % TMS9918_GPU_VRAM_WIDTH, a / TMS9918_GPU_VRAM_WIDTH). a
+   TMS9918_VRAM_PAGE_BYTES page is 2 rows, so uploads are always whole rows */
+#define TMS9918_GPU_VRAM_WIDTH   128
+#define TMS9918_GPU_VRAM_HEIGHT  128
+
+/* the shaders' uniforms. the layout matches the Metal TmsUniforms buffer.
+ * for GLSL, set tmsRegisters with glUniform1uiv() and tmsPalette with
+ * glUniform4fv()
+ * ---------------------------------------- */
+typedef struct
+{
+  uint32_t registers[TMS_NUM_REGISTERS];
+  float palette[16][4];                   /* RGBA, 0.0 to 1.0 */
+} vrEmuTms9918GpuUniforms;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918GpuInitUniforms
+ * ----------------------------------------
+ * set up uniforms with a palette of 16 RGBA colors (0xRRGGBBAA, as
+ * vrEmuTms9918Palette, which is used if NULL)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918GpuInitUniforms(vrEmuTms9918GpuUniforms* uniforms, const uint32_t* palette);
+
+/* Function:  vrEmuTms9918GpuBeginFrame
+ * ----------------------------------------
+ * do the cpu's part of a frame rendered on the GPU, in place of
+ * vrEmuTms9918RenderFrame(): apply queued writes, update the status
+ * register, upload the vram changed since the last call (see
+ * vrEmuTms9918UploadVram(), eg. with glTexSubImage2D() at row
+ * addr / TMS9918_GPU_VRAM_WIDTH) and copy the registers to uniforms
+ *
+ * returns the number of vram bytes uploaded
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918GpuBeginFrame(VrEmuTms9918* tms9918, vrEmuTms9918UploadFn upload, void* context,
+                                 vrEmuTms9918GpuUniforms* uniforms);
+
+#endif // _VR_EMU_TMS9918_GPU_H_
@@ -0,0 +1,664 @@
+/*
+ * Troy's TMS9918 Emulator - Shared scanline kernels
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_KERNELS_H_
+#define _VR_EMU_TMS9918_KERNELS_H_
+
+/* inline building blocks of the scanline kernels: pattern expansion, tile
+ * rows for each mode and the per-scanline sprite lists. they only see raw
+ * vram and table pointers, so the same code renders vrEmuTms9918 and the
+ * VideoDisplayProcessor library */
+
+#include "vrEmuTms9918.h"
+#include <string.h>
+
+/* build-time selection of the vectorized pattern expansion.
+   define VR_TMS9918_EMU_NO_SIMD to force the portable path */
+#if !VR_TMS9918_EMU_NO_SIMD
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TMS_SIMD_SSE2 1
+  #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define TMS_SIMD_NEON 1
+  #elif defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define TMS_SIMD_WASM 1
+  #endif
+#endif
+
+/* specialized kernels are instantiated from inline bodies with
+   constant flags, so they must be inlined to be specialized */
+#if defined(_MSC_VER)
+  #define TMS_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+  #define TMS_FORCE_INLINE inline __attribute__((always_inline))
+#else
+  #define TMS_FORCE_INLINE inline
+#endif
+
+#define VRAM_SIZE           (1 << 14) /* 16KB */
+#define VRAM_MASK     (VRAM_SIZE - 1) /* 0x3fff */
+
+#define GRAPHICS_NUM_COLS         32
+#define GRAPHICS_CHAR_WIDTH        8
+
+#define TEXT_NUM_COLS             40
+#define TEXT_CHAR_WIDTH            6
+#define TEXT_PADDING_PX            8
+
+#define PATTERN_BYTES              8
+#define GFXI_COLOR_GROUP_SIZE      8
+
+#define MAX_SPRITES               32
+
+#define SPRITE_ATTR_Y              0
+#define SPRITE_ATTR_X              1
+#define SPRITE_ATTR_NAME           2
+#define SPRITE_ATTR_COLOR          3
+#define SPRITE_ATTR_BYTES          4
+#define LAST_SPRITE_YPOS        0xD0
+#define MAX_SCANLINE_SPRITES       4
+
+#define STATUS_5S               0x40
+#define STATUS_COL              0x20
+
+/* sprite kernel flags (the register 1 size and magnification bits) */
+#define TMS_KERNEL_SPRITE_MAG2  0x01
+#define TMS_KERNEL_SPRITE_16    0x02
+#define TMS_KERNEL_SPRITE_MASK  (TMS_KERNEL_SPRITE_16 | TMS_KERNEL_SPRITE_MAG2)
+
+ /* sprites visible on a scanline
+  * ---------------------- */
+typedef struct
+{
+  /* number of sprites to output (up to MAX_SCANLINE_SPRITES) */
+  uint8_t numSprites;
+
+  /* sprite indexes, in attribute table order */
+  uint8_t sprites[MAX_SCANLINE_SPRITES];
+
+  /* status bits once the line is processed (unless STATUS_5S is already
+     set): STATUS_5S | fifth sprite index, or the LAST_SPRITE_YPOS index */
+  uint8_t status;
+} tmsSpriteLine;
+
+
+/* pattern byte -> 8 byte pixel mask (0xff for set bits, msb first) */
+#define TMS_MASK_BIT(n, b) (((n) & (0x80 >> (b))) ? 0xff : 0x00)
+#define TMS_MASK_1(n)   { TMS_MASK_BIT(n, 0), TMS_MASK_BIT(n, 1), TMS_MASK_BIT(n, 2), TMS_MASK_BIT(n, 3), \
+                          TMS_MASK_BIT(n, 4), TMS_MASK_BIT(n, 5), TMS_MASK_BIT(n, 6), TMS_MASK_BIT(n, 7) }
+#define TMS_MASK_4(n)   TMS_MASK_1(n), TMS_MASK_1(n + 1), TMS_MASK_1(n + 2), TMS_MASK_1(n + 3)
+#define TMS_MASK_16(n)  TMS_MASK_4(n), TMS_MASK_4(n + 4), TMS_MASK_4(n + 8), TMS_MASK_4(n + 12)
+#define TMS_MASK_64(n)  TMS_MASK_16(n), TMS_MASK_16(n + 16), TMS_MASK_16(n + 32), TMS_MASK_16(n + 48)
+
+static const uint8_t tmsPatternMasks[256][GRAPHICS_CHAR_WIDTH] = {
+  TMS_MASK_64(0), TMS_MASK_64(64), TMS_MASK_64(128), TMS_MASK_64(192)
+};
+
+#define TMS_REPEAT_8(b) ((uint64_t)(b) * 0x0101010101010101ULL)
+
+/* Function:  tmsExpandPattern
+ * ----------------------------------------
+ * expand one pattern byte to 8 pixels (set bits fgColor, clear bits bgColor)
+ *
+ * writes 8 bytes regardless of how many are used (text mode uses 6)
+ */
+static inline void tmsExpandPattern(uint8_t pattByte, uint8_t fgColor, uint8_t bgColor, uint8_t* pixels)
+{
+  uint64_t mask;
+  memcpy(&mask, tmsPatternMasks[pattByte], sizeof(mask));
+
+  const uint64_t bg = TMS_REPEAT_8(bgColor);
+  const uint64_t out = bg ^ (TMS_REPEAT_8(fgColor ^ bgColor) & mask);
+  memcpy(pixels, &out, sizeof(out));
+}
+
+#if TMS_SIMD_SSE2
+
+/* set/clear mask for 2 tiles whose pattern bytes have been repeated 8 times each */
+#define TMS_SSE2_BLEND(p, b, x, bits) \
+  _mm_xor_si128(b, _mm_and_si128(x, _mm_cmpeq_epi8(_mm_and_si128(p, bits), bits)))
+
+#endif
+
+/* Function:  tmsExpandTiles
+ * ----------------------------------------
+ * expand a row of GRAPHICS_NUM_COLS pattern bytes, each with its own
+ * foreground and background color
+ */
+static inline void tmsExpandTiles(const uint8_t pattBytes[GRAPHICS_NUM_COLS],
+                                  const uint8_t fgColors[GRAPHICS_NUM_COLS],
+                                  const uint8_t bgColors[GRAPHICS_NUM_COLS],
+                                  uint8_t pixels[TMS9918_PIXELS_X])
+{
+#if TMS_SIMD_SSE2
+
+  const __m128i bits = _mm_set_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+                                    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80);
+
+  /* 16 tiles at a time. each is repeated 8 times (three rounds of
+     unpacking with itself) to produce 2 tiles per 16-byte output */
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; tileX += 16)
+  {
+    const __m128i p = _mm_loadu_si128((const __m128i*)(pattBytes + tileX));
+    const __m128i b = _mm_loadu_si128((const __m128i*)(bgColors + tileX));
+    const __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(fgColors + tileX)), b);
+
+    __m128i* out = (__m128i*)(pixels + tileX * GRAPHICS_CHAR_WIDTH);
+
+    for (int i = 0; i < 2; ++i)
+    {
+      const __m128i p2 = i ? _mm_unpackhi_epi8(p, p) : _mm_unpacklo_epi8(p, p);
+      const __m128i b2 = i ? _mm_unpackhi_epi8(b, b) : _mm_unpacklo_epi8(b, b);
+      const __m128i x2 = i ? _mm_unpackhi_epi8(x, x) : _mm_unpacklo_epi8(x, x);
+
+      for (int j = 0; j < 2; ++j)
+      {
+        const __m128i p4 = j ? _mm_unpackhi_epi16(p2, p2) : _mm_unpacklo_epi16(p2, p2);
+        const __m128i b4 = j ? _mm_unpackhi_epi16(b2, b2) : _mm_unpacklo_epi16(b2, b2);
+        const __m128i x4 = j ? _mm_unpackhi_epi16(x2, x2) : _mm_unpacklo_epi16(x2, x2);
+
+        _mm_storeu_si128(out++, TMS_SSE2_BLEND(_mm_unpacklo_epi32(p4, p4),
+                                               _mm_unpacklo_epi32(b4, b4),
+                                               _mm_unpacklo_epi32(x4, x4), bits));
+        _mm_storeu_si128(out++, TMS_SSE2_BLEND(_mm_unpackhi_epi32(p4, p4),
+                                               _mm_unpackhi_epi32(b4, b4),
+                                               _mm_unpackhi_epi32(x4, x4), bits));
+      }
+    }
+  }
+
+#elif TMS_SIMD_NEON
+
+  static const uint8_t bitsArr[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                       0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+  const uint8x16_t bits = vld1q_u8(bitsArr);
+
+  /* 16 tiles at a time. each is repeated 8 times (three rounds of
+     zipping with itself) to produce 2 tiles per 16-byte output */
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; tileX += 16)
+  {
+    const uint8x16_t p = vld1q_u8(pattBytes + tileX);
+    const uint8x16_t f = vld1q_u8(fgColors + tileX);
+    const uint8x16_t b = vld1q_u8(bgColors + tileX);
+
+    const uint8x16x2_t p2 = vzipq_u8(p, p);
+    const uint8x16x2_t f2 = vzipq_u8(f, f);
+    const uint8x16x2_t b2 = vzipq_u8(b, b);
+
+    uint8_t* out = pixels + tileX * GRAPHICS_CHAR_WIDTH;
+
+    for (int i = 0; i < 2; ++i)
+    {
+      const uint16x8x2_t p4 = vzipq_u16(vreinterpretq_u16_u8(p2.val[i]), vreinterpretq_u16_u8(p2.val[i]));
+      const uint16x8x2_t f4 = vzipq_u16(vreinterpretq_u16_u8(f2.val[i]), vreinterpretq_u16_u8(f2.val[i]));
+      const uint16x8x2_t b4 = vzipq_u16(vreinterpretq_u16_u8(b2.val[i]), vreinterpretq_u16_u8(b2.val[i]));
+
+      for (int j = 0; j < 2; ++j)
+      {
+        const uint32x4x2_t p8 = vzipq_u32(vreinterpretq_u32_u16(p4.val[j]), vreinterpretq_u32_u16(p4.val[j]));
+        const uint32x4x2_t f8 = vzipq_u32(vreinterpretq_u32_u16(f4.val[j]), vreinterpretq_u32_u16(f4.val[j]));
+        const uint32x4x2_t b8 = vzipq_u32(vreinterpretq_u32_u16(b4.val[j]), vreinterpretq_u32_u16(b4.val[j]));
+
+        for (int k = 0; k < 2; ++k)
+        {
+          const uint8x16_t mask = vtstq_u8(vreinterpretq_u8_u32(p8.val[k]), bits);
+          vst1q_u8(out, vbslq_u8(mask, vreinterpretq_u8_u32(f8.val[k]), vreinterpretq_u8_u32(b8.val[k])));
+          out += 16;
+        }
+      }
+    }
+  }
+
+#elif TMS_SIMD_WASM
+
+  const v128_t bits = wasm_i8x16_const(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                       0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+/* repeat tiles t and t + 1 of a 16 tile vector 8 times each */
+#define TMS_WASM_REPEAT(v, t) wasm_i8x16_shuffle(v, v, t, t, t, t, t, t, t, t, \
+                              t + 1, t + 1, t + 1, t + 1, t + 1, t + 1, t + 1, t + 1)
+#define TMS_WASM_EXPAND(t) \
+  wasm_v128_store(out + t * GRAPHICS_CHAR_WIDTH, wasm_v128_bitselect(TMS_WASM_REPEAT(f, t), TMS_WASM_REPEAT(b, t), \
+                  wasm_i8x16_eq(wasm_v128_and(TMS_WASM_REPEAT(p, t), bits), bits)))
+
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; tileX += 16)
+  {
+    const v128_t p = wasm_v128_load(pattBytes + tileX);
+    const v128_t f = wasm_v128_load(fgColors + tileX);
+    const v128_t b = wasm_v128_load(bgColors + tileX);
+
+    uint8_t* out = pixels + tileX * GRAPHICS_CHAR_WIDTH;
+
+    TMS_WASM_EXPAND(0);  TMS_WASM_EXPAND(2);  TMS_WASM_EXPAND(4);  TMS_WASM_EXPAND(6);
+    TMS_WASM_EXPAND(8);  TMS_WASM_EXPAND(10); TMS_WASM_EXPAND(12); TMS_WASM_EXPAND(14);
+  }
+
+#undef TMS_WASM_EXPAND
+#undef TMS_WASM_REPEAT
+
+#else
+
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    tmsExpandPattern(pattBytes[tileX], fgColors[tileX], bgColors[tileX], pixels + tileX * GRAPHICS_CHAR_WIDTH);
+  }
+
+#endif
+}
+
+/* Function:  tmsResolveColor
+ * ----------------------------------------
+ * a color table color, with transparent showing the backdrop
+ */
+static inline uint8_t tmsResolveColor(uint8_t color, uint8_t backdrop)
+{
+  return color == TMS_TRANSPARENT ? backdrop : color;
+}
+
+ /* color table bytes resolved against the backdrop
+  * ---------------------- */
+typedef struct tmsColorPairs
+{
+  /* colors for the set (fg) and clear (bg) pattern bits of a graphics I / II
+     color byte. equally the left (fg) and right (bg) block colors of a
+     multicolor pattern byte */
+  uint8_t fg[256];
+  uint8_t bg[256];
+
+  /* the backdrop they were resolved against */
+  uint8_t backdrop;
+} tmsColorPairs;
+
+/* Function:  tmsColorPairsInit
+ * ----------------------------------------
+ * resolve every color byte against backdrop. only needed when the backdrop
+ * changes, so the kernels don't resolve transparency per tile
+ */
+static inline void tmsColorPairsInit(tmsColorPairs* colors, uint8_t backdrop)
+{
+  uint8_t resolved[16];
+
+  for (uint8_t i = 0; i < 16; ++i)
+  {
+    resolved[i] = tmsResolveColor(i, backdrop);
+  }
+
+  for (int i = 0; i < 256; ++i)
+  {
+    colors->fg[i] = resolved[i >> 4];
+    colors->bg[i] = resolved[i & 0x0f];
+  }
+
+  colors->backdrop = backdrop;
+}
+
+/* Function:  tmsTransparentBits
+ * ----------------------------------------
+ * the pixels of a pattern byte (msb first) whose color is TMS_TRANSPARENT,
+ * so show the backdrop
+ */
+static inline uint8_t tmsTransparentBits(uint8_t pattByte, uint8_t colorByte)
+{
+  return (uint8_t)(((colorByte >> 4) == TMS_TRANSPARENT ? pattByte : 0) |
+                   ((colorByte & 0x0f) == TMS_TRANSPARENT ? ~pattByte : 0));
+}
+
+/* Function:  tmsGraphicsIRow
+ * ----------------------------------------
+ * a row of Graphics I tiles. names is the start of the row in the name table
+ *
+ * mask (optional) receives the row's tmsTransparentBits() from the same
+ * gather. pass a constant NULL to compile it out
+ */
+static TMS_FORCE_INLINE void tmsGraphicsIRow(const uint8_t* names, const uint8_t* patternTable, const uint8_t* colorTable,
+                                             uint8_t pattRow, const tmsColorPairs* colors, uint8_t pixels[TMS9918_PIXELS_X],
+                                             uint8_t* mask)
+{
+  uint8_t pattBytes[GRAPHICS_NUM_COLS];
+  uint8_t fgColors[GRAPHICS_NUM_COLS];
+  uint8_t bgColors[GRAPHICS_NUM_COLS];
+
+  /* gather pattern and colors for each tile in this row */
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    const uint8_t pattIdx = names[tileX];
+    const uint8_t colorByte = colorTable[pattIdx / GFXI_COLOR_GROUP_SIZE];
+
+    pattBytes[tileX] = patternTable[pattIdx * PATTERN_BYTES + pattRow];
+    fgColors[tileX] = colors->fg[colorByte];
+    bgColors[tileX] = colors->bg[colorByte];
+
+    if (mask)
+    {
+      mask[tileX] = tmsTransparentBits(pattBytes[tileX], colorByte);
+    }
+  }
+
+  tmsExpandTiles(pattBytes, fgColors, bgColors, pixels);
+}
+
+/* Function:  tmsGraphicsIIPageOffset
+ * ----------------------------------------
+ * pattern and color table offset for the third of the screen holding
+ * tile row tileY
+ *
+ * the datasheet says the lower bits of the color and pattern tables must
+ * be all 1's for graphics II mode. when they're not, it seems the page
+ * offset becomes 0 and only the lower 3 bits of pattern name is used
+ */
+static inline uint16_t tmsGraphicsIIPageOffset(uint8_t tileY, bool invalidGfxII)
+{
+  return (uint16_t)(invalidGfxII ? 0 : ((tileY & 0x18) >> 3) << 11); /* offset (0, 0x800 or 0x1000) */
+}
+
+/* Function:  tmsGraphicsIIRow
+ * ----------------------------------------
+ * a row of Graphics II tiles. patternTable and colorTable include the
+ * tmsGraphicsIIPageOffset(). nameMask is 0x07 for invalid table masks.
+ * mask (optional) as for tmsGraphicsIRow()
+ */
+static TMS_FORCE_INLINE void tmsGraphicsIIRow(const uint8_t* names, const uint8_t* patternTable, const uint8_t* colorTable,
+                                              uint8_t pattRow, uint8_t nameMask, const tmsColorPairs* colors,
+                                              uint8_t pixels[TMS9918_PIXELS_X], uint8_t* mask)
+{
+  uint8_t pattBytes[GRAPHICS_NUM_COLS];
+  uint8_t fgColors[GRAPHICS_NUM_COLS];
+  uint8_t bgColors[GRAPHICS_NUM_COLS];
+
+  /* gather pattern and colors for each tile in this row */
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    const uint8_t pattIdx = names[tileX] & nameMask;
+
+    const size_t pattRowOffset = pattIdx * PATTERN_BYTES + pattRow;
+    const uint8_t colorByte = colorTable[pattRowOffset];
+
+    pattBytes[tileX] = patternTable[pattRowOffset];
+    fgColors[tileX] = colors->fg[colorByte];
+    bgColors[tileX] = colors->bg[colorByte];
+
+    if (mask)
+    {
+      mask[tileX] = tmsTransparentBits(pattBytes[tileX], colorByte);
+    }
+  }
+
+  tmsExpandTiles(pattBytes, fgColors, bgColors, pixels);
+}
+
+/* Function:  tmsMulticolorPattRow
+ * ----------------------------------------
+ * the pattern byte (color pair) used for scanline y in Multicolor mode
+ */
+static inline uint8_t tmsMulticolorPattRow(uint8_t y)
+{
+  return ((y / 4) & 0x01) + ((y >> 3) & 0x03) * 2;
+}
+
+/* Function:  tmsMulticolorRow
+ * ----------------------------------------
+ * a row of Multicolor tiles (4x4 pixel blocks). mask (optional) as for
+ * tmsGraphicsIRow()
+ */
+static TMS_FORCE_INLINE void tmsMulticolorRow(const uint8_t* names, const uint8_t* patternTable, uint8_t pattRow,
+                                              const tmsColorPairs* colors, uint8_t pixels[TMS9918_PIXELS_X],
+                                              uint8_t* mask)
+{
+  for (uint8_t tileX = 0; tileX < GRAPHICS_NUM_COLS; ++tileX)
+  {
+    const uint8_t colorByte = patternTable[names[tileX] * PATTERN_BYTES + pattRow];
+
+    memset(pixels + tileX * GRAPHICS_CHAR_WIDTH, colors->fg[colorByte], 4);
+    memset(pixels + tileX * GRAPHICS_CHAR_WIDTH + 4, colors->bg[colorByte], 4);
+
+    if (mask)
+    {
+      /* the left block is the foreground nibble */
+      mask[tileX] = tmsTransparentBits(0xf0, colorByte);
+    }
+  }
+}
+
+/* Function:  tmsTextRow
+ * ----------------------------------------
+ * a row of Text mode tiles, including the left and right padding
+ *
+ * fgMask (optional) has the foreground pixels cleared, for an opaque
+ * foreground over an already set transparent mask. pass a constant NULL
+ * to compile it out
+ */
+static TMS_FORCE_INLINE void tmsTextRow(const uint8_t* names, const uint8_t* patternTable, uint8_t pattRow,
+                                        uint8_t fgColor, uint8_t bgColor, uint8_t pixels[TMS9918_PIXELS_X],
+                                        uint8_t* fgMask)
+{
+  /* fill the first 8 pixels with bg color */
+  memset(pixels, bgColor, TEXT_PADDING_PX);
+
+  /* each tile writes 8 pixels, the last 2 are overwritten by the next tile */
+  for (uint8_t tileX = 0; tileX < TEXT_NUM_COLS; ++tileX)
+  {
+    const uint8_t pattByte = patternTable[names[tileX] * PATTERN_BYTES + pattRow];
+
+    tmsExpandPattern(pattByte, fgColor, bgColor, pixels + TEXT_PADDING_PX + tileX * TEXT_CHAR_WIDTH);
+
+    if (fgMask)
+    {
+      /* the 6 used pattern bits, straddling two mask bytes */
+      const uint16_t x = TEXT_PADDING_PX + tileX * TEXT_CHAR_WIDTH;
+      const uint16_t bits = (uint16_t)((pattByte & 0xfc) << 8) >> (x & 7);
+
+      fgMask[x >> 3] &= (uint8_t)~(bits >> 8);
+      fgMask[(x >> 3) + 1] &= (uint8_t)~bits;
+    }
+  }
+
+  /* fill the last 8 pixels with bg color (after the overspill of the last tile) */
+  memset(pixels + TMS9918_PIXELS_X - TEXT_PADDING_PX, bgColor, TEXT_PADDING_PX);
+}
+
+
+/* Function:  tmsSpriteTopY
+ * ----------------------------------------
+ * first scanline of a sprite (may be negative), from its attribute yPos
+ */
+static inline int16_t tmsSpriteTopY(uint8_t attrY)
+{
+  int16_t yPos = attrY;
+
+  /* check if sprite position is in the -31 to 0 range and move back to top */
+  if (yPos > (uint8_t)-32)
+  {
+    yPos -= 256;
+  }
+
+  /* first row is YPOS -1 (0xff). 2nd row is YPOS 0 */
+  return yPos + 1;
+}
+
+/* Function:  tmsDoubleBits
+ * ----------------------------------------
+ * double each bit of a pattern byte (for magnified sprites)
+ */
+static inline uint16_t tmsDoubleBits(uint8_t pattByte)
+{
+  uint16_t x = pattByte;
+  x = (x | (x << 4)) & 0x0f0f;
+  x = (x | (x << 2)) & 0x3333;
+  x = (x | (x << 1)) & 0x5555;
+  return x | (x << 1);
+}
+
+/* Function:  tmsEvaluateSprites
+ * ----------------------------------------
+ * bucket sprites into per-scanline lists. only needs to be re-run when the
+ * sprite attribute table or registers change
+ *
+ * spriteFlags are the TMS_KERNEL_SPRITE_MASK bits of register 1
+ */
+static inline void tmsEvaluateSprites(const uint8_t* spriteAttrTable, uint8_t spriteFlags,
+                                      tmsSpriteLine spriteLines[TMS9918_PIXELS_Y])
+{
+  const bool spriteMag = (spriteFlags & TMS_KERNEL_SPRITE_MAG2) != 0;
+  const int16_t spriteSizePx = ((spriteFlags & TMS_KERNEL_SPRITE_16) ? 16 : 8) * (spriteMag ? 2 : 1);
+
+  memset(spriteLines, 0, sizeof(tmsSpriteLine) * TMS9918_PIXELS_Y);
+
+  /* processing stops at the first yPos == LAST_SPRITE_YPOS */
+  uint8_t numSprites = 0;
+  while (numSprites < MAX_SPRITES && spriteAttrTable[numSprites * SPRITE_ATTR_BYTES + SPRITE_ATTR_Y] != LAST_SPRITE_YPOS)
+  {
+    ++numSprites;
+  }
+
+  if (numSprites < MAX_SPRITES)
+  {
+    for (uint8_t y = 0; y < TMS9918_PIXELS_Y; ++y)
+    {
+      spriteLines[y].status = numSprites;
+    }
+  }
+
+  for (uint8_t spriteIdx = 0; spriteIdx < numSprites; ++spriteIdx)
+  {
+    const int16_t yPos = tmsSpriteTopY(spriteAttrTable[spriteIdx * SPRITE_ATTR_BYTES + SPRITE_ATTR_Y]);
+
+    /* a magnified sprite's pattern row is (y - yPos) / 2, which rounds
+       towards zero, so it is also visible on the line above yPos */
+    int16_t firstY = spriteMag ? yPos - 1 : yPos;
+    int16_t lastY = yPos + spriteSizePx - 1;
+
+    if (firstY < 0) firstY = 0;
+    if (lastY >= TMS9918_PIXELS_Y) lastY = TMS9918_PIXELS_Y - 1;
+
+    for (int16_t y = firstY; y <= lastY; ++y)
+    {
+      tmsSpriteLine* line = &spriteLines[y];
+
+      if (line->status & STATUS_5S)
+      {
+        continue;
+      }
+
+      /* have we exceeded the scanline sprite limit? */
+      if (line->numSprites == MAX_SCANLINE_SPRITES)
+      {
+        line->status = STATUS_5S | spriteIdx;
+      }
+      else
+      {
+        line->sprites[line->numSprites++] = spriteIdx;
+      }
+    }
+  }
+}
+
+/* Function:  tmsSpriteRowBits
+ * ----------------------------------------
+ * a sprite's pixels on scanline y as bits (leftmost pixel in the msb),
+ * clipped to the left edge. *xPos is the (clipped) screen position
+ *
+ * kernelFlags are the (constant) TMS_KERNEL_SPRITE_* specialization
+ */
+static TMS_FORCE_INLINE uint32_t tmsSpriteRowBits(const uint8_t* vram, uint16_t spritePatternTableAddr, const uint8_t* spriteAttr,
+                                                  uint8_t y, int16_t* xPos, const uint8_t kernelFlags)
+{
+  const bool spriteMag = (kernelFlags & TMS_KERNEL_SPRITE_MAG2) != 0;
+  const bool sprite16 = (kernelFlags & TMS_KERNEL_SPRITE_16) != 0;
+  const uint8_t spriteSizePx = (sprite16 ? 16 : 8) * (spriteMag ? 2 : 1);
+
+  int16_t pattRow = y - tmsSpriteTopY(spriteAttr[SPRITE_ATTR_Y]);
+  if (spriteMag)
+  {
+    pattRow /= 2;
+  }
+
+  /* sprite is visible on this line */
+  const uint8_t pattIdx = spriteAttr[SPRITE_ATTR_NAME];
+  const uint16_t pattOffset = spritePatternTableAddr + pattIdx * PATTERN_BYTES + (uint16_t)pattRow;
+
+  uint32_t spriteBits = vram[pattOffset & VRAM_MASK];
+  if (sprite16) /* from A -> C or B -> D of large sprite */
+  {
+    spriteBits = (spriteBits << 8) | vram[(pattOffset + PATTERN_BYTES * 2) & VRAM_MASK];
+  }
+  if (spriteMag)
+  {
+    spriteBits = sprite16 ? ((uint32_t)tmsDoubleBits(spriteBits >> 8) << 16) | tmsDoubleBits(spriteBits & 0xff)
+                          : tmsDoubleBits(spriteBits);
+  }
+  spriteBits <<= 32 - spriteSizePx;
+
+  const int16_t earlyClockOffset = (spriteAttr[SPRITE_ATTR_COLOR] & 0x80) ? -32 : 0;
+  *xPos = (int16_t)(spriteAttr[SPRITE_ATTR_X]) + earlyClockOffset;
+
+  /* clip to the left edge */
+  if (*xPos < 0)
+  {
+    spriteBits = (-*xPos < 32) ? spriteBits << -*xPos : 0;
+    *xPos = 0;
+  }
+
+  return spriteBits;
+}
+
+/* Function:  tmsSpriteCollision
+ * ----------------------------------------
+ * add a sprite's row bits to a scanline's collision mask (msb first),
+ * returning true if they overlap sprites already on the line. anything
+ * beyond the right edge is shifted out
+ */
+static TMS_FORCE_INLINE bool tmsSpriteCollision(uint64_t rowSpriteBits[TMS9918_PIXELS_X / 64], uint32_t spriteBits, int16_t xPos)
+{
+  const uint64_t bits = (uint64_t)spriteBits << 32;
+  const uint8_t word = xPos >> 6;
+  const uint8_t shift = xPos & 63;
+  const uint64_t bitsLo = bits >> shift;
+  const uint64_t bitsHi = (shift && word < 3) ? bits << (64 - shift) : 0;
+
+  const bool collision = (rowSpriteBits[word] & bitsLo) || (word < 3 && (rowSpriteBits[word + 1] & bitsHi));
+
+  rowSpriteBits[word] |= bitsLo;
+  if (word < 3)
+  {
+    rowSpriteBits[word + 1] |= bitsHi;
+  }
+
+  return collision;
+}
+
+/* Function:  tmsDrawSprite
+ * ----------------------------------------
+ * output a sprite's pixel bits to a scanline
+ */
+static TMS_FORCE_INLINE void tmsDrawSprite(uint8_t pixels[TMS9918_PIXELS_X], uint32_t spriteBits, int16_t xPos,
+                                           uint8_t spriteColor, const uint8_t kernelFlags)
+{
+  const uint8_t spriteSizePx = ((kernelFlags & TMS_KERNEL_SPRITE_16) ? 16 : 8) *
+                               ((kernelFlags & TMS_KERNEL_SPRITE_MAG2) ? 2 : 1);
+
+  /* clip to the right edge, so the loop below has a constant trip count */
+  if (xPos > TMS9918_PIXELS_X - spriteSizePx)
+  {
+    spriteBits &= ~(0xffffffffu >> (TMS9918_PIXELS_X - xPos));
+  }
+
+  for (uint8_t px = 0; px < spriteSizePx; ++px)
+  {
+    if (spriteBits & (0x80000000u >> px))
+    {
+      pixels[xPos + px] = spriteColor;
+    }
+  }
+}
+
+#endif // _VR_EMU_TMS9918_KERNELS_H_
@@ -0,0 +1,422 @@
+/*
+ * Troy's TMS9918 Emulator - Pixel format conversion and scaling
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Output.h"
+#include "vrEmuTms9918Util.h"
+#include <string.h>
+
+/* selection of the vectorized conversion. each palette byte plane is a
+   16 entry table, looked up with a byte shuffle (which SSE2 lacks, so x86
+   needs SSSE3). x86-64 builds only assume SSE2, so unless SSSE3 is enabled
+   for the whole build, the SSSE3 path is compiled on its own and chosen at
+   run time (TMS_OUTPUT_DISPATCH). define VR_TMS9918_EMU_NO_SIMD to force
+   the portable path */
+#if !VR_TMS9918_EMU_NO_SIMD
+  #if defined(__SSSE3__) || defined(__AVX__)
+    #include <tmmintrin.h>
+    #define TMS_OUTPUT_SSSE3 1
+  #elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #include <tmmintrin.h>
+    #define TMS_OUTPUT_SSSE3 1
+    #define TMS_OUTPUT_DISPATCH 1
+    #define TMS_OUTPUT_TARGET __attribute__((target("ssse3")))
+  #elif defined(_M_X64)
+    #include <intrin.h>
+    #include <tmmintrin.h>
+    #define TMS_OUTPUT_SSSE3 1
+    #define TMS_OUTPUT_DISPATCH 1
+  #elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define TMS_OUTPUT_NEON 1
+  #elif defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define TMS_OUTPUT_WASM 1
+  #endif
+#endif
+
+#define TMS_OUTPUT_SIMD (TMS_OUTPUT_SSSE3 || TMS_OUTPUT_NEON || TMS_OUTPUT_WASM)
+
+/* attributes of the vectorized row conversion */
+#ifndef TMS_OUTPUT_TARGET
+  #define TMS_OUTPUT_TARGET
+#endif
+
+/* source pixels converted at a time when scaling (the converted chunk is
+   then copied to each output row, so the surface is only ever written) */
+#define OUTPUT_CHUNK_PIXELS   TMS9918_PIXELS_X
+
+#if TMS_OUTPUT_SSSE3
+
+typedef __m128i tmsVec;
+
+#define tmsVecLoad(p)         _mm_loadu_si128((const __m128i*)(p))
+#define tmsVecLookup(t, i)    _mm_shuffle_epi8((t), (i))
+#define tmsVecLowNibbles(v)   _mm_and_si128((v), _mm_set1_epi8(0x0f))
+
+/* interleave 16 pixels of 4 byte planes */
+static inline uint8_t* tmsVecStore4(tmsVec p0, tmsVec p1, tmsVec p2, tmsVec p3, uint8_t* out)
+{
+  const __m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+  const __m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+  const __m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+  const __m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+
+  _mm_storeu_si128((__m128i*)(out +  0), _mm_unpacklo_epi16(lo01, lo23));
+  _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi16(lo01, lo23));
+  _mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi16(hi01, hi23));
+  _mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi16(hi01, hi23));
+  return out + 64;
+}
+
+/* interleave 16 pixels of 2 byte planes */
+static inline uint8_t* tmsVecStore2(tmsVec p0, tmsVec p1, uint8_t* out)
+{
+  _mm_storeu_si128((__m128i*)(out +  0), _mm_unpacklo_epi8(p0, p1));
+  _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(p0, p1));
+  return out + 32;
+}
+
+#elif TMS_OUTPUT_NEON
+
+typedef uint8x16_t tmsVec;
+
+#define tmsVecLoad(p)         vld1q_u8(p)
+#define tmsVecLookup(t, i)    vqtbl1q_u8((t), (i))
+#define tmsVecLowNibbles(v)   vandq_u8((v), vdupq_n_u8(0x0f))
+
+static inline uint8_t* tmsVecStore4(tmsVec p0, tmsVec p1, tmsVec p2, tmsVec p3, uint8_t* out)
+{
+  uint8x16x4_t planes = { { p0, p1, p2, p3 } };
+  vst4q_u8(out, planes);
+  return out + 64;
+}
+
+static inline uint8_t* tmsVecStore2(tmsVec p0, tmsVec p1, uint8_t* out)
+{
+  uint8x16x2_t planes = { { p0, p1 } };
+  vst2q_u8(out, planes);
+  return out + 32;
+}
+
+#elif TMS_OUTPUT_WASM
+
+typedef v128_t tmsVec;
+
+#define tmsVecLoad(p)         wasm_v128_load(p)
+#define tmsVecLookup(t, i)    wasm_i8x16_swizzle((t), (i))
+#define tmsVecLowNibbles(v)   wasm_v128_and((v), wasm_i8x16_splat(0x0f))
+
+#define TMS_WASM_ZIP8_LO(a, b)  wasm_i8x16_shuffle(a, b, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23)
+#define TMS_WASM_ZIP8_HI(a, b)  wasm_i8x16_shuffle(a, b, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31)
+#define TMS_WASM_ZIP16_LO(a, b) wasm_i16x8_shuffle(a, b, 0, 8, 1, 9, 2, 10, 3, 11)
+#define TMS_WASM_ZIP16_HI(a, b) wasm_i16x8_shuffle(a, b, 4, 12, 5, 13, 6, 14, 7, 15)
+
+static inline uint8_t* tmsVecStore4(tmsVec p0, tmsVec p1, tmsVec p2, tmsVec p3, uint8_t* out)
+{
+  const v128_t lo01 = TMS_WASM_ZIP8_LO(p0, p1);
+  const v128_t hi01 = TMS_WASM_ZIP8_HI(p0, p1);
+  const v128_t lo23 = TMS_WASM_ZIP8_LO(p2, p3);
+  const v128_t hi23 = TMS_WASM_ZIP8_HI(p2, p3);
+
+  wasm_v128_store(out +  0, TMS_WASM_ZIP16_LO(lo01, lo23));
+  wasm_v128_store(out + 16, TMS_WASM_ZIP16_HI(lo01, lo23));
+  wasm_v128_store(out + 32, TMS_WASM_ZIP16_LO(hi01, hi23));
+  wasm_v128_store(out + 48, TMS_WASM_ZIP16_HI(hi01, hi23));
+  return out + 64;
+}
+
+static inline uint8_t* tmsVecStore2(tmsVec p0, tmsVec p1, uint8_t* out)
+{
+  wasm_v128_store(out +  0, TMS_WASM_ZIP8_LO(p0, p1));
+  wasm_v128_store(out + 16, TMS_WASM_ZIP8_HI(p0, p1));
+  return out + 32;
+}
+
+#endif
+
+
+#if TMS_OUTPUT_SIMD
+
+/* Function:  tmsOutputRowSimd
+ * ----------------------------------------
+ * convert whole 16 pixel blocks of numPixels indexes (bytesPerPixel 2 or
+ * 4) to out. returns the number of pixels converted
+ */
+static TMS_OUTPUT_TARGET size_t tmsOutputRowSimd(const vrEmuTms9918Output* output, const uint8_t* pixels,
+                                                 size_t numPixels, uint8_t* out)
+{
+  const unsigned bpp = output->bytesPerPixel;
+  const unsigned scale = output->scale;
+  size_t i = 0;
+
+  tmsVec planes[4];
+  tmsVec scaleIndexes[TMS9918_OUTPUT_MAX_SCALE];
+  for (unsigned b = 0; b < 4; ++b) planes[b] = tmsVecLoad(output->planes[b]);
+  for (unsigned v = 0; v < scale; ++v) scaleIndexes[v] = tmsVecLoad(output->scaleIndexes[v]);
+
+  for (; i + 16 <= numPixels; i += 16)
+  {
+    const tmsVec indexes = tmsVecLowNibbles(tmsVecLoad(pixels + i));
+
+    for (unsigned v = 0; v < scale; ++v)
+    {
+      const tmsVec scaled = (scale == 1) ? indexes : tmsVecLookup(indexes, scaleIndexes[v]);
+
+      if (bpp == 4)
+      {
+        out = tmsVecStore4(tmsVecLookup(planes[0], scaled), tmsVecLookup(planes[1], scaled),
+                           tmsVecLookup(planes[2], scaled), tmsVecLookup(planes[3], scaled), out);
+      }
+      else
+      {
+        out = tmsVecStore2(tmsVecLookup(planes[0], scaled), tmsVecLookup(planes[1], scaled), out);
+      }
+    }
+  }
+
+  return i;
+}
+
+/* Function:  tmsOutputSimdSupported
+ * ----------------------------------------
+ * can the vectorized conversion run on this cpu?
+ */
+static bool tmsOutputSimdSupported(void)
+{
+#if TMS_OUTPUT_DISPATCH
+  /* checked once. racing threads all store the same answer */
+  static int supported = -1;
+
+  if (supported < 0)
+  {
+  #if defined(_M_X64)
+    int info[4];
+    __cpuid(info, 1);
+    supported = (info[2] & (1 << 9)) != 0;
+  #else
+    supported = __builtin_cpu_supports("ssse3") != 0;
+  #endif
+  }
+  return supported != 0;
+#else
+  return true;
+#endif
+}
+
+#endif
+
+/* Function:  tmsOutputRow
+ * ----------------------------------------
+ * convert numPixels indexes to one row of numPixels * scale pixels
+ */
+static void tmsOutputRow(const vrEmuTms9918Output* output, const uint8_t* pixels, size_t numPixels, uint8_t* out)
+{
+  const unsigned bpp = output->bytesPerPixel;
+  const unsigned scale = output->scale;
+  size_t i = 0;
+
+#if TMS_OUTPUT_SIMD
+  if (bpp != 3 && tmsOutputSimdSupported())
+  {
+    i = tmsOutputRowSimd(output, pixels, numPixels, out);
+    out += i * scale * bpp;
+  }
+#endif
+
+  /* the remaining (or, without SIMD, all) pixels. a constant size copy
+     per format compiles to a single store */
+  switch (bpp)
+  {
+    case 4:
+      for (; i < numPixels; ++i)
+      {
+        const uint8_t* color = output->colors[pixels[i] & 0x0f];
+        for (unsigned v = 0; v < scale; ++v, out += 4) memcpy(out, color, 4);
+      }
+      break;
+
+    case 2:
+      for (; i < numPixels; ++i)
+      {
+        const uint8_t* color = output->colors[pixels[i] & 0x0f];
+        for (unsigned v = 0; v < scale; ++v, out += 2) memcpy(out, color, 2);
+      }
+      break;
+
+    default:
+      for (; i < numPixels; ++i)
+      {
+        const uint8_t* color = output->colors[pixels[i] & 0x0f];
+        for (unsigned v = 0; v < scale; ++v, out += 3) memcpy(out, color, 3);
+      }
+      break;
+  }
+}
+
+/* Function:  tmsOutputFrameLine
+ * ----------------------------------------
+ * vrEmuTms9918LineFn for vrEmuTms9918RenderFrameToSurface()
+ */
+typedef struct
+{
+  const vrEmuTms9918Output* output;
+  uint8_t* surface;
+  size_t pitch;
+} tmsOutputFrame;
+
+static void tmsOutputFrameLine(void* context, uint8_t y, const uint8_t pixels[TMS9918_PIXELS_X])
+{
+  const tmsOutputFrame* frame = (const tmsOutputFrame*)context;
+
+  vrEmuTms9918OutputLine(frame->output, pixels, TMS9918_PIXELS_X,
+                         frame->surface + (size_t)y * frame->output->scale * frame->pitch, frame->pitch);
+}
+
+
+/* Function:  vrEmuTms9918OutputInit
+ * ----------------------------------------
+ * set up a conversion
+ */
+VR_EMU_TMS9918_DLLEXPORT bool vrEmuTms9918OutputInit(vrEmuTms9918Output* output, vrEmuTms9918PixelFormat format, unsigned scale,
+                                                     const uint32_t* palette)
+{
+  if (output == NULL || format >= TMS_NUM_PIXEL_FORMATS || scale < 1 || scale > TMS9918_OUTPUT_MAX_SCALE)
+    return false;
+
+  if (palette == NULL)
+    palette = vrEmuTms9918Palette;
+
+  memset(output, 0, sizeof(*output));
+  output->format = format;
+  output->scale = (uint8_t)scale;
+
+  for (int i = 0; i < 16; ++i)
+  {
+    const uint8_t r = (palette[i] >> 24) & 0xff;
+    const uint8_t g = (palette[i] >> 16) & 0xff;
+    const uint8_t b = (palette[i] >> 8) & 0xff;
+    const uint8_t a = palette[i] & 0xff;
+    uint8_t* color = output->colors[i];
+
+    switch (format)
+    {
+      case TMS_PIXEL_RGBA8888:
+        color[0] = r; color[1] = g; color[2] = b; color[3] = a;
+        output->bytesPerPixel = 4;
+        break;
+
+      case TMS_PIXEL_BGRA8888:
+        color[0] = b; color[1] = g; color[2] = r; color[3] = a;
+        output->bytesPerPixel = 4;
+        break;
+
+      case TMS_PIXEL_ARGB8888:
+        color[0] = a; color[1] = r; color[2] = g; color[3] = b;
+        output->bytesPerPixel = 4;
+        break;
+
+      case TMS_PIXEL_RGB565:
+      {
+        const uint16_t rgb565 = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        memcpy(color, &rgb565, sizeof(rgb565));
+        output->bytesPerPixel = 2;
+        break;
+      }
+
+      default: /* TMS_PIXEL_RGB888 */
+        color[0] = r; color[1] = g; color[2] = b;
+        output->bytesPerPixel = 3;
+        break;
+    }
+  }
+
+  for (unsigned i = 0; i < 16; ++i)
+  {
+    for (unsigned b = 0; b < 4; ++b)
+    {
+      output->planes[b][i] = output->colors[i][b];
+    }
+    for (unsigned v = 0; v < scale; ++v)
+    {
+      output->scaleIndexes[v][i] = (uint8_t)((v * 16 + i) / scale);
+    }
+  }
+
+  return true;
+}
+
+/* Function:  vrEmuTms9918OutputSimd
+ * ----------------------------------------
+ * the vectorized conversion in use
+ */
+VR_EMU_TMS9918_DLLEXPORT const char* vrEmuTms9918OutputSimd(void)
+{
+#if TMS_OUTPUT_SSSE3
+  return tmsOutputSimdSupported() ? "ssse3" : "none";
+#elif TMS_OUTPUT_NEON
+  return "neon";
+#elif TMS_OUTPUT_WASM
+  return "wasm";
+#else
+  return "none";
+#endif
+}
+
+/* Function:  vrEmuTms9918OutputLine
+ * ----------------------------------------
+ * convert a line of palette indexes to scale rows of a surface
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918OutputLine(const vrEmuTms9918Output* output, const uint8_t* pixels, size_t numPixels,
+                                                     void* surface, size_t pitch)
+{
+  if (output == NULL || pixels == NULL || surface == NULL)
+    return;
+
+  uint8_t* row = (uint8_t*)surface;
+
+  if (output->scale == 1)
+  {
+    tmsOutputRow(output, pixels, numPixels, row);
+    return;
+  }
+
+  uint8_t chunk[OUTPUT_CHUNK_PIXELS * TMS9918_OUTPUT_MAX_SCALE * 4];
+  const size_t pixelBytes = (size_t)output->scale * output->bytesPerPixel;
+
+  for (size_t i = 0; i < numPixels; i += OUTPUT_CHUNK_PIXELS)
+  {
+    const size_t chunkPixels = (numPixels - i < OUTPUT_CHUNK_PIXELS) ? numPixels - i : OUTPUT_CHUNK_PIXELS;
+    tmsOutputRow(output, pixels + i, chunkPixels, chunk);
+
+    for (unsigned v = 0; v < output->scale; ++v)
+    {
+      memcpy(row + v * pitch + i * pixelBytes, chunk, chunkPixels * pixelBytes);
+    }
+  }
+}
+
+/* Function:  vrEmuTms9918RenderFrameToSurface
+ * ----------------------------------------
+ * render a frame straight into a surface
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RenderFrameToSurface(VrEmuTms9918* tms9918, const vrEmuTms9918Output* output,
+                                                               void* surface, size_t pitch)
+{
+  if (tms9918 == NULL || output == NULL || surface == NULL)
+    return;
+
+  tmsOutputFrame frame;
+  frame.output = output;
+  frame.surface = (uint8_t*)surface;
+  frame.pitch = pitch;
+
+  vrEmuTms9918RenderFrameLines(tms9918, tmsOutputFrameLine, &frame);
+}
@@ -0,0 +1,97 @@
+/*
+ * Troy's TMS9918 Emulator - Pixel format conversion and scaling
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_OUTPUT_H_
+#define _VR_EMU_TMS9918_OUTPUT_H_
+
+#include "vrEmuTms9918.h"
+
+/* largest integer scale factor */
+#define TMS9918_OUTPUT_MAX_SCALE 4
+
+/* output pixel formats, named in memory byte order
+ * ---------------------------------------- */
+typedef enum
+{
+  TMS_PIXEL_RGBA8888,   /* bytes R, G, B, A (SDL_PIXELFORMAT_RGBA32, MTLPixelFormatRGBA8Unorm) */
+  TMS_PIXEL_BGRA8888,   /* bytes B, G, R, A (SDL_PIXELFORMAT_BGRA32, kCVPixelFormatType_32BGRA) */
+  TMS_PIXEL_ARGB8888,   /* bytes A, R, G, B (SDL_PIXELFORMAT_ARGB32, kCVPixelFormatType_32ARGB) */
+  TMS_PIXEL_RGB565,     /* native endian uint16_t, red in the top 5 bits (SDL_PIXELFORMAT_RGB565) */
+  TMS_PIXEL_RGB888,     /* bytes R, G, B (SDL_PIXELFORMAT_RGB24) */
+  TMS_NUM_PIXEL_FORMATS
+} vrEmuTms9918PixelFormat;
+
+/* a conversion from palette indexes to a pixel format, at a scale.
+ * set up with vrEmuTms9918OutputInit()
+ * ---------------------------------------- */
+typedef struct
+{
+  vrEmuTms9918PixelFormat format;
+  uint8_t scale;                  /* 1 to TMS9918_OUTPUT_MAX_SCALE */
+  uint8_t bytesPerPixel;          /* of format */
+
+  /* each palette entry in format, in memory order */
+  uint8_t colors[16][4];
+
+  /* private: colors as byte planes (planes[b][i] = colors[i][b]) and the
+     indexes that repeat 16 pixels scale times, for the vectorized path */
+  uint8_t planes[4][16];
+  uint8_t scaleIndexes[TMS9918_OUTPUT_MAX_SCALE][16];
+} vrEmuTms9918Output;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918OutputInit
+ * ----------------------------------------
+ * set up a conversion to format with nearest-neighbour scaling by scale
+ * in both directions
+ *
+ * palette: 16 RGBA colors (0xRRGGBBAA, as vrEmuTms9918Palette, which is
+ * used if NULL)
+ *
+ * returns false if format or scale is out of range
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918OutputInit(vrEmuTms9918Output* output, vrEmuTms9918PixelFormat format, unsigned scale,
+                            const uint32_t* palette);
+
+/* Function:  vrEmuTms9918OutputSimd
+ * ----------------------------------------
+ * the vectorized conversion used on this cpu: "ssse3", "neon", "wasm" or
+ * "none" for the portable path (also used for RGB888). x86-64 builds
+ * without SSSE3 enabled check for it at run time
+ */
+VR_EMU_TMS9918_DLLEXPORT
+const char* vrEmuTms9918OutputSimd(void);
+
+/* Function:  vrEmuTms9918OutputLine
+ * ----------------------------------------
+ * convert numPixels palette indexes to scale rows of numPixels * scale
+ * pixels at surface, pitch bytes apart (eg. straight into a locked
+ * texture or pixel buffer)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918OutputLine(const vrEmuTms9918Output* output, const uint8_t* pixels, size_t numPixels,
+                            void* surface, size_t pitch);
+
+/* Function:  vrEmuTms9918RenderFrameToSurface
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame(), converting each line straight into surface
+ * as it's generated. surface holds TMS9918_PIXELS_Y * scale rows of
+ * TMS9918_PIXELS_X * scale pixels, pitch bytes apart
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RenderFrameToSurface(VrEmuTms9918* tms9918, const vrEmuTms9918Output* output,
+                                      void* surface, size_t pitch);
+
+#endif // _VR_EMU_TMS9918_OUTPUT_H_
@@ -0,0 +1,149 @@
+/*
+ * Troy's TMS9918 Emulator - Lock-free port queue
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918PortQueue.h"
+#include "vrEmuTms9918PortRing.h"
+#include <stdlib.h>
+
+ /* PRIVATE DATA STRUCTURE
+  * ---------------------- */
+struct vrEmuTms9918PortQueue_s
+{
+  VrEmuTms9918* tms9918;
+  tmsPortRing ring;
+};
+
+
+/* Function:  tmsPortWriteAddr, tmsPortWriteData, tmsPortReadStatus, tmsPortReadData
+ * ----------------------------------------
+ * the instance's ports, as applied by tmsPortRingDrain()
+ */
+static void tmsPortWriteAddr(void* tms9918, uint8_t data)
+{
+  vrEmuTms9918WriteAddr((VrEmuTms9918*)tms9918, data);
+}
+
+static void tmsPortWriteData(void* tms9918, uint8_t data)
+{
+  vrEmuTms9918WriteData((VrEmuTms9918*)tms9918, data);
+}
+
+static uint8_t tmsPortReadStatus(void* tms9918)
+{
+  return vrEmuTms9918ReadStatus((VrEmuTms9918*)tms9918);
+}
+
+static uint8_t tmsPortReadData(void* tms9918)
+{
+  return vrEmuTms9918ReadData((VrEmuTms9918*)tms9918);
+}
+
+static const tmsPortTarget tmsPorts = {
+  tmsPortWriteAddr, tmsPortWriteData, tmsPortReadStatus, tmsPortReadData
+};
+
+
+/* Function:  vrEmuTms9918PortQueueNew
+ * ----------------------------------------
+ * create a queue
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918PortQueue* vrEmuTms9918PortQueueNew(VrEmuTms9918* tms9918, size_t capacity)
+{
+  if (tms9918 == NULL)
+    return NULL;
+
+  VrEmuTms9918PortQueue* queue = (VrEmuTms9918PortQueue*)calloc(1, sizeof(VrEmuTms9918PortQueue));
+  if (queue == NULL)
+    return NULL;
+
+  if (!tmsPortRingInit(&queue->ring, capacity))
+  {
+    free(queue);
+    return NULL;
+  }
+
+  queue->tms9918 = tms9918;
+
+  return queue;
+}
+
+/* Function:  vrEmuTms9918PortQueueDestroy
+ * ----------------------------------------
+ * destroy a queue
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918PortQueueDestroy(VrEmuTms9918PortQueue* queue)
+{
+  if (queue == NULL)
+    return;
+
+  tmsPortRingFree(&queue->ring);
+  free(queue);
+}
+
+/* Function:  vrEmuTms9918PortQueueWriteAddr
+ * ----------------------------------------
+ * queue an address / register write
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918PortQueueWriteAddr(VrEmuTms9918PortQueue* queue, uint8_t data)
+{
+  if (queue == NULL)
+    return;
+
+  tmsPortRingPush(&queue->ring, TMS_PORT_WRITE_ADDR, data);
+}
+
+/* Function:  vrEmuTms9918PortQueueWriteData
+ * ----------------------------------------
+ * queue a data write
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918PortQueueWriteData(VrEmuTms9918PortQueue* queue, uint8_t data)
+{
+  if (queue == NULL)
+    return;
+
+  tmsPortRingPush(&queue->ring, TMS_PORT_WRITE_DATA, data);
+}
+
+/* Function:  vrEmuTms9918PortQueueReadStatus
+ * ----------------------------------------
+ * read the status register through the queue
+ */
+VR_EMU_TMS9918_DLLEXPORT uint8_t vrEmuTms9918PortQueueReadStatus(VrEmuTms9918PortQueue* queue)
+{
+  if (queue == NULL)
+    return 0;
+
+  return tmsPortRingRead(&queue->ring, TMS_PORT_READ_STATUS);
+}
+
+/* Function:  vrEmuTms9918PortQueueReadData
+ * ----------------------------------------
+ * read data through the queue
+ */
+VR_EMU_TMS9918_DLLEXPORT uint8_t vrEmuTms9918PortQueueReadData(VrEmuTms9918PortQueue* queue)
+{
+  if (queue == NULL)
+    return 0;
+
+  return tmsPortRingRead(&queue->ring, TMS_PORT_READ_DATA);
+}
+
+/* Function:  vrEmuTms9918PortQueueDrain
+ * ----------------------------------------
+ * apply every queued operation
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918PortQueueDrain(VrEmuTms9918PortQueue* queue)
+{
+  if (queue == NULL)
+    return 0;
+
+  return tmsPortRingDrain(&queue->ring, &tmsPorts, queue->tms9918);
+}
@@ -0,0 +1,99 @@
+/*
+ * Troy's TMS9918 Emulator - Lock-free port queue
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_PORT_QUEUE_H_
+#define _VR_EMU_TMS9918_PORT_QUEUE_H_
+
+#include "vrEmuTms9918.h"
+
+/* PRIVATE DATA STRUCTURE
+ * ---------------------------------------- */
+struct vrEmuTms9918PortQueue_s;
+typedef struct vrEmuTms9918PortQueue_s VrEmuTms9918PortQueue;
+
+
+/* PUBLIC INTERFACE
+ * ----------------------------------------
+ *
+ * a single producer / single consumer ring of port operations, so the
+ * cpu emulation (producer) and the VDP (consumer) can run on separate
+ * threads. the cpu thread calls the vrEmuTms9918PortQueue* port functions
+ * instead of vrEmuTms9918WriteAddr() etc. the VDP thread applies them in
+ * order with vrEmuTms9918PortQueueDrain() before generating each
+ * scanline, and is the only thread to call any other vrEmuTms9918
+ * function on the instance
+ */
+
+/* Function:  vrEmuTms9918PortQueueNew
+ * ----------------------------------------
+ * create a queue of (at least) capacity operations for tms9918
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918PortQueue* vrEmuTms9918PortQueueNew(VrEmuTms9918* tms9918, size_t capacity);
+
+/* Function:  vrEmuTms9918PortQueueDestroy
+ * ----------------------------------------
+ * destroy a queue (not the instance). neither thread may be using it
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918PortQueueDestroy(VrEmuTms9918PortQueue* queue);
+
+/* Function:  vrEmuTms9918PortQueueWriteAddr
+ * ----------------------------------------
+ * queue vrEmuTms9918WriteAddr(). cpu thread only. if the queue is full,
+ * waits for the VDP thread to drain it
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918PortQueueWriteAddr(VrEmuTms9918PortQueue* queue, uint8_t data);
+
+/* Function:  vrEmuTms9918PortQueueWriteData
+ * ----------------------------------------
+ * queue vrEmuTms9918WriteData(). cpu thread only. if the queue is full,
+ * waits for the VDP thread to drain it
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918PortQueueWriteData(VrEmuTms9918PortQueue* queue, uint8_t data);
+
+/* Function:  vrEmuTms9918PortQueueReadStatus
+ * ----------------------------------------
+ * vrEmuTms9918ReadStatus() through the queue. cpu thread only
+ *
+ * a synchronization point: the read is queued behind every earlier write
+ * and performed by the VDP thread's next vrEmuTms9918PortQueueDrain(),
+ * which this waits for. the status is as of the line being drained for
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint8_t vrEmuTms9918PortQueueReadStatus(VrEmuTms9918PortQueue* queue);
+
+/* Function:  vrEmuTms9918PortQueueReadData
+ * ----------------------------------------
+ * vrEmuTms9918ReadData() through the queue. cpu thread only
+ *
+ * a synchronization point, as for vrEmuTms9918PortQueueReadStatus(). being
+ * ordered with the writes, the read-ahead buffer and address increment
+ * behave exactly as they would with direct port access
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint8_t vrEmuTms9918PortQueueReadData(VrEmuTms9918PortQueue* queue);
+
+/* Function:  vrEmuTms9918PortQueueDrain
+ * ----------------------------------------
+ * apply every queued operation, in order. VDP thread only. returns the
+ * number applied
+ *
+ * call before each scanline. while the cpu thread waits on a read (or a
+ * full queue) it waits for this, so the VDP thread should keep draining
+ * while it's otherwise idle, eg. waiting for the next frame
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918PortQueueDrain(VrEmuTms9918PortQueue* queue);
+
+#endif // _VR_EMU_TMS9918_PORT_QUEUE_H_
@@ -0,0 +1,203 @@
+/*
+ * Troy's TMS9918 Emulator - Shared lock-free port ring
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_PORT_RING_H_
+#define _VR_EMU_TMS9918_PORT_RING_H_
+
+/* the single producer / single consumer ring behind vrEmuTms9918PortQueue*
+ * and VDPPortQueue*. the producer pushes port operations (waiting on reads),
+ * and the consumer applies them through the owner's tmsPortTarget */
+
+#include "vrEmuTms9918Atomic.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* the producer and consumer fields don't share cache lines */
+#define TMS_PORT_RING_CACHE_LINE    64
+
+#define TMS_PORT_RING_MAX_CAPACITY  ((size_t)1 << 30)
+
+typedef enum
+{
+  TMS_PORT_WRITE_ADDR,
+  TMS_PORT_WRITE_DATA,
+  TMS_PORT_READ_STATUS,
+  TMS_PORT_READ_DATA
+} tmsPortOpType;
+
+/* a queued operation. for reads, data is the read's sequence number
+ * ---------------------------------------- */
+typedef struct
+{
+  uint8_t type;
+  uint8_t data;
+} tmsPortOp;
+
+/* the ports a drain applies operations to
+ * ---------------------------------------- */
+typedef struct
+{
+  void (*writeAddr)(void* target, uint8_t data);
+  void (*writeData)(void* target, uint8_t data);
+  uint8_t (*readStatus)(void* target);
+  uint8_t (*readData)(void* target);
+} tmsPortTarget;
+
+/* the ring
+ * ---------------------------------------- */
+typedef struct
+{
+  /* set up once */
+  tmsPortOp* ops;
+  uint32_t mask;
+
+  uint8_t pad0[TMS_PORT_RING_CACHE_LINE];
+
+  /* written by the producer: ops[head & mask] to ops[(tail - 1) & mask]
+     are queued */
+  tmsAtomicU32 tail;
+
+  /* producer only. the last head seen, and the last read's sequence */
+  uint32_t headSeen;
+  uint8_t readSeq;
+
+  uint8_t pad1[TMS_PORT_RING_CACHE_LINE];
+
+  /* written by the consumer */
+  tmsAtomicU32 head;
+
+  /* the last read: (sequence << 8) | value */
+  tmsAtomicU32 readResult;
+} tmsPortRing;
+
+
+/* Function:  tmsPortRingInit
+ * ----------------------------------------
+ * allocate room for (at least) capacity operations. false if capacity is
+ * 0, too large or can't be allocated
+ */
+static inline bool tmsPortRingInit(tmsPortRing* ring, size_t capacity)
+{
+  if (capacity == 0 || capacity > TMS_PORT_RING_MAX_CAPACITY)
+    return false;
+
+  size_t size = 2;
+  while (size < capacity) size <<= 1;
+
+  ring->ops = (tmsPortOp*)malloc(size * sizeof(tmsPortOp));
+  if (ring->ops == NULL)
+    return false;
+
+  ring->mask = (uint32_t)(size - 1);
+  ring->headSeen = 0;
+  ring->readSeq = 0;
+  tmsAtomicInit(&ring->tail, 0);
+  tmsAtomicInit(&ring->head, 0);
+  tmsAtomicInit(&ring->readResult, 0);
+
+  return true;
+}
+
+/* Function:  tmsPortRingFree
+ * ----------------------------------------
+ * free the operations. neither thread may be using the ring
+ */
+static inline void tmsPortRingFree(tmsPortRing* ring)
+{
+  free(ring->ops);
+  ring->ops = NULL;
+}
+
+/* Function:  tmsPortRingPush
+ * ----------------------------------------
+ * queue an operation, waiting for space if the ring is full. producer only
+ */
+static inline void tmsPortRingPush(tmsPortRing* ring, tmsPortOpType type, uint8_t data)
+{
+  /* only the producer writes tail */
+  const uint32_t tail = tmsAtomicLoad(&ring->tail);
+
+  while (tail - ring->headSeen > ring->mask)
+  {
+    ring->headSeen = tmsAtomicLoad(&ring->head);
+    if (tail - ring->headSeen > ring->mask)
+    {
+      tmsThreadYield();
+    }
+  }
+
+  tmsPortOp* op = &ring->ops[tail & ring->mask];
+  op->type = (uint8_t)type;
+  op->data = data;
+
+  tmsAtomicStore(&ring->tail, tail + 1);
+}
+
+/* Function:  tmsPortRingRead
+ * ----------------------------------------
+ * queue a read and wait for the consumer to perform it. producer only
+ */
+static inline uint8_t tmsPortRingRead(tmsPortRing* ring, tmsPortOpType type)
+{
+  /* only one read is ever outstanding, so it only has to differ from the last */
+  const uint8_t seq = ++ring->readSeq;
+  tmsPortRingPush(ring, type, seq);
+
+  uint32_t result;
+  while (((result = tmsAtomicLoad(&ring->readResult)) >> 8) != seq)
+  {
+    tmsThreadYield();
+  }
+
+  return result & 0xff;
+}
+
+/* Function:  tmsPortRingDrain
+ * ----------------------------------------
+ * apply every queued operation to target, in order. consumer only.
+ * returns the number applied
+ */
+static inline size_t tmsPortRingDrain(tmsPortRing* ring, const tmsPortTarget* ports, void* target)
+{
+  /* only the consumer writes head */
+  const uint32_t head = tmsAtomicLoad(&ring->head);
+  const uint32_t tail = tmsAtomicLoad(&ring->tail);
+
+  for (uint32_t i = head; i != tail; ++i)
+  {
+    const tmsPortOp* op = &ring->ops[i & ring->mask];
+    switch (op->type)
+    {
+      case TMS_PORT_WRITE_ADDR:
+        ports->writeAddr(target, op->data);
+        break;
+
+      case TMS_PORT_WRITE_DATA:
+        ports->writeData(target, op->data);
+        break;
+
+      case TMS_PORT_READ_STATUS:
+        tmsAtomicStore(&ring->readResult, ((uint32_t)op->data << 8) | ports->readStatus(target));
+        break;
+
+      default: /* TMS_PORT_READ_DATA */
+        tmsAtomicStore(&ring->readResult, ((uint32_t)op->data << 8) | ports->readData(target));
+        break;
+    }
+  }
+
+  /* a full ring has room again */
+  tmsAtomicStore(&ring->head, tail);
+
+  return tail - head;
+}
+
+#endif // _VR_EMU_TMS9918_PORT_RING_H_
@@ -0,0 +1,332 @@
+/*
+ * Troy's TMS9918 Emulator - Rewind buffer
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* a recorded frame holds what is needed to step back from the following
+   (newer) frame: [page mask][state header][pages of vram in the mask] */
+#define REWIND_MASK_BYTES    sizeof(uint64_t)
+#define REWIND_HEADER_BYTES  (REWIND_MASK_BYTES + TMS9918_STATE_VRAM_OFFSET)
+
+ /* a frame in the ring
+  * ---------------------- */
+typedef struct
+{
+  size_t offset;
+  size_t size;
+} tmsRewindRecord;
+
+ /* PRIVATE DATA STRUCTURE
+  * ---------------------- */
+struct vrEmuTms9918Rewind_s
+{
+  /* recorded frames, oldest first. records[first] to records[first + count - 1] (wrapping) */
+  uint8_t* ring;
+  size_t ringBytes;
+  size_t bytesUsed;
+
+  tmsRewindRecord* records;
+  size_t maxRecords;
+  size_t first;
+  size_t count;
+
+  /* full snapshot of the most recently pushed frame */
+  uint8_t* current;
+  bool hasCurrent;
+
+  /* snapshot being pushed */
+  uint8_t* scratch;
+
+  unsigned keyframeInterval;
+  unsigned sinceKeyframe;
+};
+
+
+/* Function:  tmsRewindRecordAt
+ * ----------------------------------------
+ * record index (0 = oldest)
+ */
+static inline tmsRewindRecord* tmsRewindRecordAt(VrEmuTms9918Rewind* rewind, size_t index)
+{
+  return &rewind->records[(rewind->first + index) % rewind->maxRecords];
+}
+
+/* Function:  tmsRewindDropOldest
+ * ----------------------------------------
+ * discard the oldest record
+ */
+static void tmsRewindDropOldest(VrEmuTms9918Rewind* rewind)
+{
+  rewind->bytesUsed -= tmsRewindRecordAt(rewind, 0)->size;
+  rewind->first = (rewind->first + 1) % rewind->maxRecords;
+  --rewind->count;
+}
+
+/* Function:  tmsRewindAlloc
+ * ----------------------------------------
+ * find contiguous space for a new (newest) record, dropping the oldest
+ * records as needed. returns false if it can never fit
+ */
+static bool tmsRewindAlloc(VrEmuTms9918Rewind* rewind, size_t size, size_t* offset)
+{
+  if (size > rewind->ringBytes)
+    return false;
+
+  for (;;)
+  {
+    if (rewind->count == 0)
+    {
+      rewind->first = 0;
+      *offset = 0;
+      return true;
+    }
+
+    if (rewind->count < rewind->maxRecords)
+    {
+      const tmsRewindRecord* oldest = tmsRewindRecordAt(rewind, 0);
+      const tmsRewindRecord* newest = tmsRewindRecordAt(rewind, rewind->count - 1);
+      const size_t head = oldest->offset;
+      const size_t tail = newest->offset + newest->size;
+
+      if (newest->offset >= head) /* [head, tail) in use */
+      {
+        if (rewind->ringBytes - tail >= size)
+        {
+          *offset = tail;
+          return true;
+        }
+        if (head >= size)
+        {
+          *offset = 0;
+          return true;
+        }
+      }
+      else if (head - tail >= size) /* wrapped. [tail, head) free */
+      {
+        *offset = tail;
+        return true;
+      }
+    }
+
+    tmsRewindDropOldest(rewind);
+  }
+}
+
+
+/* Function:  vrEmuTms9918RewindNew
+ * ----------------------------------------
+ * create a rewind buffer
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918Rewind* vrEmuTms9918RewindNew(size_t maxBytes, unsigned keyframeInterval)
+{
+  VrEmuTms9918Rewind* rewind = (VrEmuTms9918Rewind*)calloc(1, sizeof(VrEmuTms9918Rewind));
+  if (rewind == NULL)
+    return NULL;
+
+  rewind->ringBytes = maxBytes;
+  rewind->maxRecords = maxBytes / REWIND_HEADER_BYTES + 1;
+  rewind->keyframeInterval = keyframeInterval;
+
+  rewind->ring = (uint8_t*)malloc(maxBytes ? maxBytes : 1);
+  rewind->records = (tmsRewindRecord*)malloc(rewind->maxRecords * sizeof(tmsRewindRecord));
+  rewind->current = (uint8_t*)malloc(vrEmuTms9918StateSize());
+  rewind->scratch = (uint8_t*)malloc(vrEmuTms9918StateSize());
+
+  if (rewind->ring == NULL || rewind->records == NULL || rewind->current == NULL || rewind->scratch == NULL)
+  {
+    vrEmuTms9918RewindDestroy(rewind);
+    return NULL;
+  }
+
+  return rewind;
+}
+
+/* Function:  vrEmuTms9918RewindDestroy
+ * ----------------------------------------
+ * destroy a rewind buffer
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RewindDestroy(VrEmuTms9918Rewind* rewind)
+{
+  if (rewind == NULL)
+    return;
+
+  free(rewind->scratch);
+  free(rewind->current);
+  free(rewind->records);
+  free(rewind->ring);
+  free(rewind);
+}
+
+/* Function:  vrEmuTms9918RewindPush
+ * ----------------------------------------
+ * record the current state of tms9918
+ */
+VR_EMU_TMS9918_DLLEXPORT bool vrEmuTms9918RewindPush(VrEmuTms9918Rewind* rewind, VrEmuTms9918* tms9918)
+{
+  if (rewind == NULL || tms9918 == NULL)
+    return false;
+
+  vrEmuTms9918SaveState(tms9918, rewind->scratch, vrEmuTms9918StateSize());
+
+  if (rewind->hasCurrent)
+  {
+    const uint8_t* oldVram = rewind->current + TMS9918_STATE_VRAM_OFFSET;
+    const uint8_t* newVram = rewind->scratch + TMS9918_STATE_VRAM_OFFSET;
+
+    /* the pages that changed since the previous frame. compared against the previous
+       snapshot, so nothing else touching the instance can hide a change */
+    uint64_t pages = 0;
+
+    if (rewind->keyframeInterval && ++rewind->sinceKeyframe >= rewind->keyframeInterval)
+    {
+      rewind->sinceKeyframe = 0;
+      pages = ~(uint64_t)0;
+    }
+    else
+    {
+      for (unsigned page = 0; page < TMS9918_VRAM_PAGES; ++page)
+      {
+        const size_t pageOffset = page * TMS9918_VRAM_PAGE_BYTES;
+        if (memcmp(oldVram + pageOffset, newVram + pageOffset, TMS9918_VRAM_PAGE_BYTES) != 0)
+        {
+          pages |= (uint64_t)1 << page;
+        }
+      }
+    }
+
+    size_t size = REWIND_HEADER_BYTES;
+    for (unsigned page = 0; page < TMS9918_VRAM_PAGES; ++page)
+    {
+      if (pages & ((uint64_t)1 << page)) size += TMS9918_VRAM_PAGE_BYTES;
+    }
+
+    size_t offset = 0;
+    if (!tmsRewindAlloc(rewind, size, &offset))
+    {
+      /* the previous frame can't be kept, so there's no history before this one */
+      vrEmuTms9918RewindClear(rewind);
+      memcpy(rewind->current, rewind->scratch, vrEmuTms9918StateSize());
+      rewind->hasCurrent = true;
+      return false;
+    }
+
+    /* the previous frame, as a delta from this one */
+    uint8_t* record = rewind->ring + offset;
+    memcpy(record, &pages, REWIND_MASK_BYTES);
+    memcpy(record + REWIND_MASK_BYTES, rewind->current, TMS9918_STATE_VRAM_OFFSET);
+    record += REWIND_HEADER_BYTES;
+
+    for (unsigned page = 0; page < TMS9918_VRAM_PAGES; ++page)
+    {
+      if (pages & ((uint64_t)1 << page))
+      {
+        memcpy(record, oldVram + page * TMS9918_VRAM_PAGE_BYTES, TMS9918_VRAM_PAGE_BYTES);
+        record += TMS9918_VRAM_PAGE_BYTES;
+      }
+    }
+
+    tmsRewindRecord* newest = tmsRewindRecordAt(rewind, rewind->count++);
+    newest->offset = offset;
+    newest->size = size;
+    rewind->bytesUsed += size;
+  }
+
+  uint8_t* tmp = rewind->current;
+  rewind->current = rewind->scratch;
+  rewind->scratch = tmp;
+  rewind->hasCurrent = true;
+
+  return true;
+}
+
+/* Function:  vrEmuTms9918RewindStepBack
+ * ----------------------------------------
+ * restore and remove the most recently pushed state
+ */
+VR_EMU_TMS9918_DLLEXPORT bool vrEmuTms9918RewindStepBack(VrEmuTms9918Rewind* rewind, VrEmuTms9918* tms9918)
+{
+  if (rewind == NULL || tms9918 == NULL || !rewind->hasCurrent)
+    return false;
+
+  vrEmuTms9918LoadState(tms9918, rewind->current, vrEmuTms9918StateSize());
+
+  if (rewind->count == 0)
+  {
+    rewind->hasCurrent = false;
+    return true;
+  }
+
+  /* rebuild the previous frame from the newest delta */
+  const tmsRewindRecord* newest = tmsRewindRecordAt(rewind, rewind->count - 1);
+  const uint8_t* record = rewind->ring + newest->offset;
+
+  uint64_t pages;
+  memcpy(&pages, record, REWIND_MASK_BYTES);
+  memcpy(rewind->current, record + REWIND_MASK_BYTES, TMS9918_STATE_VRAM_OFFSET);
+  record += REWIND_HEADER_BYTES;
+
+  uint8_t* vram = rewind->current + TMS9918_STATE_VRAM_OFFSET;
+  for (unsigned page = 0; page < TMS9918_VRAM_PAGES; ++page)
+  {
+    if (pages & ((uint64_t)1 << page))
+    {
+      memcpy(vram + page * TMS9918_VRAM_PAGE_BYTES, record, TMS9918_VRAM_PAGE_BYTES);
+      record += TMS9918_VRAM_PAGE_BYTES;
+    }
+  }
+
+  rewind->bytesUsed -= newest->size;
+  --rewind->count;
+
+  return true;
+}
+
+/* Function:  vrEmuTms9918RewindFrames
+ * ----------------------------------------
+ * number of frames that can be stepped back
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918RewindFrames(const VrEmuTms9918Rewind* rewind)
+{
+  if (rewind == NULL || !rewind->hasCurrent)
+    return 0;
+
+  return rewind->count + 1;
+}
+
+/* Function:  vrEmuTms9918RewindBytesUsed
+ * ----------------------------------------
+ * bytes of history in use
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918RewindBytesUsed(const VrEmuTms9918Rewind* rewind)
+{
+  if (rewind == NULL)
+    return 0;
+
+  return rewind->bytesUsed;
+}
+
+/* Function:  vrEmuTms9918RewindClear
+ * ----------------------------------------
+ * discard all history
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918RewindClear(VrEmuTms9918Rewind* rewind)
+{
+  if (rewind == NULL)
+    return;
+
+  rewind->first = 0;
+  rewind->count = 0;
+  rewind->bytesUsed = 0;
+  rewind->hasCurrent = false;
+  rewind->sinceKeyframe = 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Troy's TMS9918 Emulator - Rewind buffer
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_REWIND_H_
+#define _VR_EMU_TMS9918_REWIND_H_
+
+#include "vrEmuTms9918.h"
+
+/* PRIVATE DATA STRUCTURE
+ * ---------------------------------------- */
+struct vrEmuTms9918Rewind_s;
+typedef struct vrEmuTms9918Rewind_s VrEmuTms9918Rewind;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918RewindNew
+ * ----------------------------------------
+ * create a rewind buffer holding up to maxBytes of history
+ *
+ * each frame pushed stores the registers, status and address, plus only the
+ * vram pages that changed since the previous push (found by comparing with
+ * it, so vrEmuTms9918VramPagesWritten() is free for other uses). when
+ * full, the oldest frames are dropped
+ *
+ * keyframeInterval (0 for none) stores all of vram every keyframeInterval
+ * frames. since deltas are exact, a keyframe resyncs nothing and only
+ * costs 16KB of history each time. pass 0 unless a fixed full copy cadence
+ * is wanted
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Rewind* vrEmuTms9918RewindNew(size_t maxBytes, unsigned keyframeInterval);
+
+/* Function:  vrEmuTms9918RewindDestroy
+ * ----------------------------------------
+ * destroy a rewind buffer
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RewindDestroy(VrEmuTms9918Rewind* rewind);
+
+/* Function:  vrEmuTms9918RewindPush
+ * ----------------------------------------
+ * record the current state of tms9918 (eg. once per frame)
+ *
+ * returns false if maxBytes is too small to keep the previous frame. the
+ * history is then dropped, but this frame is still kept as the current
+ * state, so vrEmuTms9918RewindFrames() is 1 and later pushes build on it
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918RewindPush(VrEmuTms9918Rewind* rewind, VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918RewindStepBack
+ * ----------------------------------------
+ * restore the most recently pushed state into tms9918 and remove it from
+ * the buffer. constant time regardless of history length
+ *
+ * returns false if the buffer is empty
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918RewindStepBack(VrEmuTms9918Rewind* rewind, VrEmuTms9918* tms9918);
+
+/* Function:  vrEmuTms9918RewindFrames
+ * ----------------------------------------
+ * number of frames that can be stepped back
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918RewindFrames(const VrEmuTms9918Rewind* rewind);
+
+/* Function:  vrEmuTms9918RewindBytesUsed
+ * ----------------------------------------
+ * bytes of history in use (up to maxBytes)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918RewindBytesUsed(const VrEmuTms9918Rewind* rewind);
+
+/* Function:  vrEmuTms9918RewindClear
+ * ----------------------------------------
+ * discard all history
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918RewindClear(VrEmuTms9918Rewind* rewind);
+
+#endif // _VR_EMU_TMS9918_REWIND_H_
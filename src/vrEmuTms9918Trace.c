@@ -0,0 +1,498 @@
+/*
+ * Troy's TMS9918 Emulator - Port trace recording and replay
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 200112L /* mmap, posix_madvise */
+#endif
+
+#include "vrEmuTms9918Trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define TRACE_MAGIC             "TMS9918T"
+#define TRACE_OP_BITS           3
+#define TRACE_OP_MASK           ((1 << TRACE_OP_BITS) - 1)
+#define TRACE_INLINE_TIME_MAX   31    /* in the op byte. this value means a varint follows */
+#define TRACE_MAX_RECORD_BYTES  12    /* op byte, 10 byte varint, value */
+
+#define TRACE_BUFFER_BYTES      65536
+
+typedef char tmsTraceOpsCheck[(TMS_NUM_TRACE_OPS <= TRACE_OP_MASK + 1) ? 1 : -1];
+
+ /* PRIVATE DATA STRUCTURES
+  * ---------------------- */
+struct vrEmuTms9918TraceRecorder_s
+{
+  VrEmuTms9918* tms9918;
+  FILE* file;
+  bool ok;
+
+  vrEmuTms9918TraceClockFn clockFn;
+  void* clockContext;
+  uint64_t lastTime;
+
+  /* records not yet written */
+  size_t bufferUsed;
+  uint8_t buffer[TRACE_BUFFER_BYTES];
+};
+
+struct vrEmuTms9918Trace_s
+{
+  const uint8_t* data;
+  size_t numBytes;
+
+  const uint8_t* snapshot;
+  size_t snapshotBytes;
+
+  /* set if data is mapped (by vrEmuTms9918TraceOpen) */
+  bool mapped;
+#if defined(_WIN32)
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+
+/* Function:  tmsTraceWrite32
+ * ----------------------------------------
+ * store a little endian uint32_t
+ */
+static void tmsTraceWrite32(uint8_t* dest, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    dest[i] = (uint8_t)(value >> (i * 8));
+  }
+}
+
+/* Function:  tmsTraceRead32
+ * ----------------------------------------
+ * load a little endian uint32_t
+ */
+static uint32_t tmsTraceRead32(const uint8_t* src)
+{
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/* Function:  tmsTraceRecord
+ * ----------------------------------------
+ * the vrEmuTms9918TraceFn: append a record
+ */
+static void tmsTraceRecord(void* context, vrEmuTms9918TraceOp op, uint8_t value)
+{
+  VrEmuTms9918TraceRecorder* recorder = (VrEmuTms9918TraceRecorder*)context;
+
+  if (recorder->bufferUsed > TRACE_BUFFER_BYTES - TRACE_MAX_RECORD_BYTES)
+  {
+    vrEmuTms9918TraceRecorderFlush(recorder);
+  }
+
+  uint64_t time = 0;
+  if (recorder->clockFn)
+  {
+    const uint64_t now = recorder->clockFn(recorder->clockContext);
+    time = (now > recorder->lastTime) ? now - recorder->lastTime : 0;
+    recorder->lastTime = now;
+  }
+
+  uint8_t* out = recorder->buffer + recorder->bufferUsed;
+
+  if (time < TRACE_INLINE_TIME_MAX)
+  {
+    *out++ = (uint8_t)(op | (time << TRACE_OP_BITS));
+  }
+  else
+  {
+    *out++ = (uint8_t)(op | (TRACE_INLINE_TIME_MAX << TRACE_OP_BITS));
+    while (time >= 0x80)
+    {
+      *out++ = (uint8_t)(time | 0x80);
+      time >>= 7;
+    }
+    *out++ = (uint8_t)time;
+  }
+
+  if (op != TMS_TRACE_FRAME)
+  {
+    *out++ = value;
+  }
+
+  recorder->bufferUsed = (size_t)(out - recorder->buffer);
+}
+
+/* Function:  vrEmuTms9918TraceRecorderNew
+ * ----------------------------------------
+ * start recording to file
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918TraceRecorder* vrEmuTms9918TraceRecorderNew(VrEmuTms9918* tms9918, FILE* file,
+                                                        vrEmuTms9918TraceClockFn clockFn, void* clockContext)
+{
+  if (tms9918 == NULL || file == NULL)
+    return NULL;
+
+  VrEmuTms9918TraceRecorder* recorder = (VrEmuTms9918TraceRecorder*)malloc(sizeof(VrEmuTms9918TraceRecorder));
+  if (recorder == NULL)
+    return NULL;
+
+  recorder->tms9918 = tms9918;
+  recorder->file = file;
+  recorder->ok = true;
+  recorder->clockFn = clockFn;
+  recorder->clockContext = clockContext;
+  recorder->lastTime = clockFn ? clockFn(clockContext) : 0;
+
+  /* the header and snapshot are well within the buffer */
+  const size_t snapshotBytes = vrEmuTms9918StateSize();
+  memcpy(recorder->buffer, TRACE_MAGIC, 8);
+  tmsTraceWrite32(recorder->buffer + 8, TMS9918_TRACE_VERSION);
+  tmsTraceWrite32(recorder->buffer + 12, (uint32_t)snapshotBytes);
+  vrEmuTms9918SaveState(tms9918, recorder->buffer + TMS9918_TRACE_HEADER_BYTES, snapshotBytes);
+  recorder->bufferUsed = TMS9918_TRACE_HEADER_BYTES + snapshotBytes;
+
+  if (!vrEmuTms9918TraceRecorderFlush(recorder))
+  {
+    free(recorder);
+    return NULL;
+  }
+
+  vrEmuTms9918SetTraceFn(tms9918, tmsTraceRecord, recorder);
+
+  return recorder;
+}
+
+/* Function:  vrEmuTms9918TraceRecorderFlush
+ * ----------------------------------------
+ * write buffered records
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918TraceRecorderFlush(VrEmuTms9918TraceRecorder* recorder)
+{
+  if (recorder == NULL)
+    return false;
+
+  if (recorder->bufferUsed &&
+      fwrite(recorder->buffer, 1, recorder->bufferUsed, recorder->file) != recorder->bufferUsed)
+  {
+    recorder->ok = false;
+  }
+  recorder->bufferUsed = 0;
+
+  return recorder->ok;
+}
+
+/* Function:  vrEmuTms9918TraceRecorderDestroy
+ * ----------------------------------------
+ * stop recording
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918TraceRecorderDestroy(VrEmuTms9918TraceRecorder* recorder)
+{
+  if (recorder)
+  {
+    vrEmuTms9918SetTraceFn(recorder->tms9918, NULL, NULL);
+    vrEmuTms9918TraceRecorderFlush(recorder);
+    fflush(recorder->file);
+    free(recorder);
+  }
+}
+
+/* Function:  tmsTraceParseHeader
+ * ----------------------------------------
+ * check the header and find the snapshot
+ */
+static bool tmsTraceParseHeader(VrEmuTms9918Trace* trace)
+{
+  if (trace->numBytes < TMS9918_TRACE_HEADER_BYTES ||
+      memcmp(trace->data, TRACE_MAGIC, 8) != 0 ||
+      tmsTraceRead32(trace->data + 8) != TMS9918_TRACE_VERSION)
+    return false;
+
+  trace->snapshotBytes = tmsTraceRead32(trace->data + 12);
+  if (trace->snapshotBytes > trace->numBytes - TMS9918_TRACE_HEADER_BYTES)
+    return false;
+
+  trace->snapshot = trace->data + TMS9918_TRACE_HEADER_BYTES;
+  return true;
+}
+
+/* Function:  vrEmuTms9918TraceOpenMemory
+ * ----------------------------------------
+ * replay a trace from memory
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Trace* vrEmuTms9918TraceOpenMemory(const void* data, size_t numBytes)
+{
+  if (data == NULL)
+    return NULL;
+
+  VrEmuTms9918Trace* trace = (VrEmuTms9918Trace*)calloc(1, sizeof(VrEmuTms9918Trace));
+  if (trace == NULL)
+    return NULL;
+
+  trace->data = (const uint8_t*)data;
+  trace->numBytes = numBytes;
+
+  if (!tmsTraceParseHeader(trace))
+  {
+    free(trace);
+    return NULL;
+  }
+
+  return trace;
+}
+
+/* Function:  vrEmuTms9918TraceOpen
+ * ----------------------------------------
+ * map a trace file
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Trace* vrEmuTms9918TraceOpen(const char* path)
+{
+  if (path == NULL)
+    return NULL;
+
+  VrEmuTms9918Trace* trace = (VrEmuTms9918Trace*)calloc(1, sizeof(VrEmuTms9918Trace));
+  if (trace == NULL)
+    return NULL;
+
+#if defined(_WIN32)
+  trace->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  LARGE_INTEGER size;
+  if (trace->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(trace->file, &size) ||
+      size.QuadPart == 0 || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX)
+  {
+    if (trace->file != INVALID_HANDLE_VALUE) CloseHandle(trace->file);
+    free(trace);
+    return NULL;
+  }
+
+  trace->mapping = CreateFileMappingA(trace->file, NULL, PAGE_READONLY, 0, 0, NULL);
+  trace->data = trace->mapping ? (const uint8_t*)MapViewOfFile(trace->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if (trace->data == NULL)
+  {
+    if (trace->mapping) CloseHandle(trace->mapping);
+    CloseHandle(trace->file);
+    free(trace);
+    return NULL;
+  }
+  trace->numBytes = (size_t)size.QuadPart;
+#else
+  const int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX)
+  {
+    if (fd >= 0) close(fd);
+    free(trace);
+    return NULL;
+  }
+
+  void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); /* the mapping keeps the file */
+  if (data == MAP_FAILED)
+  {
+    free(trace);
+    return NULL;
+  }
+
+  /* read ahead, and let pages go soon after they're replayed */
+  posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+  trace->data = (const uint8_t*)data;
+  trace->numBytes = (size_t)st.st_size;
+#endif
+
+  trace->mapped = true;
+
+  if (!tmsTraceParseHeader(trace))
+  {
+    vrEmuTms9918TraceClose(trace);
+    return NULL;
+  }
+
+  return trace;
+}
+
+/* Function:  vrEmuTms9918TraceClose
+ * ----------------------------------------
+ * unmap and free a trace
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918TraceClose(VrEmuTms9918Trace* trace)
+{
+  if (trace == NULL)
+    return;
+
+  if (trace->mapped)
+  {
+#if defined(_WIN32)
+    UnmapViewOfFile(trace->data);
+    CloseHandle(trace->mapping);
+    CloseHandle(trace->file);
+#else
+    munmap((void*)trace->data, trace->numBytes);
+#endif
+  }
+
+  free(trace);
+}
+
+/* Function:  vrEmuTms9918TraceSize
+ * ----------------------------------------
+ * size of a trace in bytes
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918TraceSize(const VrEmuTms9918Trace* trace)
+{
+  if (trace == NULL)
+    return 0;
+
+  return trace->numBytes;
+}
+
+/* Function:  vrEmuTms9918TraceReplay
+ * ----------------------------------------
+ * stream a trace through tms9918
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918TraceReplay(const VrEmuTms9918Trace* trace, VrEmuTms9918* tms9918, unsigned flags,
+                             vrEmuTms9918TraceStats* stats)
+{
+  vrEmuTms9918TraceStats replayed;
+  memset(&replayed, 0, sizeof(replayed));
+
+  if (stats)
+  {
+    *stats = replayed;
+  }
+
+  if (trace == NULL || tms9918 == NULL ||
+      !vrEmuTms9918LoadState(tms9918, trace->snapshot, trace->snapshotBytes))
+    return false;
+
+  const bool skipPixels = (flags & TMS_TRACE_REPLAY_SKIP_PIXELS) != 0;
+
+  uint8_t* frame = NULL;
+  if (!skipPixels)
+  {
+    frame = (uint8_t*)malloc(TMS9918_PIXELS_X * TMS9918_PIXELS_Y);
+    if (frame == NULL)
+      return false;
+  }
+
+  const uint8_t* p = trace->snapshot + trace->snapshotBytes;
+  const uint8_t* const end = trace->data + trace->numBytes;
+  bool ok = true;
+
+  while (p < end)
+  {
+    const uint8_t opByte = *p++;
+    const uint8_t op = opByte & TRACE_OP_MASK;
+
+    uint64_t time = opByte >> TRACE_OP_BITS;
+    if (time == TRACE_INLINE_TIME_MAX)
+    {
+      time = 0;
+      unsigned shift = 0;
+      uint8_t byte;
+      do
+      {
+        if (p == end || shift > 63)
+        {
+          ok = false;
+          break;
+        }
+        byte = *p++;
+        time |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+
+      if (!ok) break;
+    }
+
+    if (op == TMS_TRACE_FRAME)
+    {
+      if (skipPixels)
+      {
+        vrEmuTms9918SkipFrame(tms9918);
+      }
+      else
+      {
+        vrEmuTms9918RenderFrame(tms9918, frame, TMS9918_PIXELS_X);
+      }
+      ++replayed.frames;
+    }
+    else
+    {
+      if (op >= TMS_NUM_TRACE_OPS || p == end)
+      {
+        ok = false;
+        break;
+      }
+
+      const uint8_t value = *p++;
+      switch (op)
+      {
+        case TMS_TRACE_WRITE_ADDR:
+          vrEmuTms9918WriteAddr(tms9918, value);
+          break;
+
+        case TMS_TRACE_WRITE_DATA:
+          vrEmuTms9918WriteData(tms9918, value);
+          break;
+
+        case TMS_TRACE_READ_STATUS:
+          replayed.readMismatches += vrEmuTms9918ReadStatus(tms9918) != value;
+          break;
+
+        case TMS_TRACE_READ_DATA:
+          replayed.readMismatches += vrEmuTms9918ReadData(tms9918) != value;
+          break;
+
+        default: /* TMS_TRACE_SCANLINE */
+          if (skipPixels)
+          {
+            vrEmuTms9918SkipLine(tms9918, value);
+          }
+          else
+          {
+            vrEmuTms9918ScanLine(tms9918, value, frame);
+          }
+          ++replayed.scanLines;
+          break;
+      }
+
+      replayed.portAccesses += op < TMS_TRACE_SCANLINE;
+    }
+
+    ++replayed.records;
+    replayed.duration += time;
+  }
+
+  free(frame);
+
+  if (stats)
+  {
+    *stats = replayed;
+  }
+
+  return ok;
+}
@@ -0,0 +1,152 @@
+/*
+ * Troy's TMS9918 Emulator - Port trace recording and replay
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_TRACE_H_
+#define _VR_EMU_TMS9918_TRACE_H_
+
+#include "vrEmuTms9918.h"
+
+#include <stdio.h>
+
+/* TRACE FORMAT
+ * ----------------------------------------
+ * everything a guest did to the VDP, so it can be replayed offline:
+ *
+ *   header    TMS9918_TRACE_HEADER_BYTES: "TMS9918T", uint32_t version,
+ *             uint32_t snapshot size (little endian)
+ *   snapshot  vrEmuTms9918SaveState() when recording started
+ *   records   until the end of the file
+ *
+ * each record is an op byte: the vrEmuTms9918TraceOp in the low 3 bits and
+ * the time since the previous record in the high 5. a time of 31 or more
+ * is stored as 31, followed by the full time as a LEB128 varint. all ops
+ * but TMS_TRACE_FRAME are then followed by their value byte, so most
+ * records are two bytes. times are in the recorder's clock units (eg. cpu
+ * cycles), or all 0 without a clock
+ */
+#define TMS9918_TRACE_VERSION 1
+#define TMS9918_TRACE_HEADER_BYTES 16
+
+/* a clock for record times (eg. the cpu cycle count), passed context */
+typedef uint64_t (*vrEmuTms9918TraceClockFn)(void* context);
+
+/* vrEmuTms9918TraceReplay() flags */
+#define TMS_TRACE_REPLAY_SKIP_PIXELS 0x01  /* status only (vrEmuTms9918SkipLine / SkipFrame) */
+
+/* what a replay did
+ * ---------------------------------------- */
+typedef struct
+{
+  uint64_t records;
+  uint64_t portAccesses;
+  uint64_t scanLines;      /* TMS_TRACE_SCANLINE records */
+  uint64_t frames;         /* TMS_TRACE_FRAME records */
+  uint64_t readMismatches; /* reads that returned a different value to the recording */
+  uint64_t duration;       /* total of the record times */
+} vrEmuTms9918TraceStats;
+
+/* PRIVATE DATA STRUCTURES
+ * ---------------------------------------- */
+struct vrEmuTms9918TraceRecorder_s;
+typedef struct vrEmuTms9918TraceRecorder_s VrEmuTms9918TraceRecorder;
+
+struct vrEmuTms9918Trace_s;
+typedef struct vrEmuTms9918Trace_s VrEmuTms9918Trace;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918TraceRecorderNew
+ * ----------------------------------------
+ * start recording tms9918 to file (opened for binary writing): writes the
+ * header and a snapshot, then records every port access, scanline and
+ * frame until destroyed (see vrEmuTms9918SetTraceFn, which the recorder
+ * takes over). records are buffered, so file is written in large blocks.
+ * resets, state loads and debugger access (eg. vrEmuTms9918WriteRegValue)
+ * aren't port accesses, so aren't recorded
+ *
+ * clockFn (optional) times each record
+ *
+ * returns NULL if unable to allocate or write the header
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918TraceRecorder* vrEmuTms9918TraceRecorderNew(VrEmuTms9918* tms9918, FILE* file,
+                                                        vrEmuTms9918TraceClockFn clockFn, void* clockContext);
+
+/* Function:  vrEmuTms9918TraceRecorderFlush
+ * ----------------------------------------
+ * write buffered records to the file
+ *
+ * returns false if any write to the file has failed
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918TraceRecorderFlush(VrEmuTms9918TraceRecorder* recorder);
+
+/* Function:  vrEmuTms9918TraceRecorderDestroy
+ * ----------------------------------------
+ * flush, stop recording and free the recorder. the file is left open
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918TraceRecorderDestroy(VrEmuTms9918TraceRecorder* recorder);
+
+/* Function:  vrEmuTms9918TraceOpen
+ * ----------------------------------------
+ * map a trace file for replay. the file is memory mapped, not read, so
+ * traces larger than memory replay without being loaded (on 64-bit hosts)
+ *
+ * returns NULL if the file can't be mapped or isn't a trace
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Trace* vrEmuTms9918TraceOpen(const char* path);
+
+/* Function:  vrEmuTms9918TraceOpenMemory
+ * ----------------------------------------
+ * replay a trace from memory. data isn't copied, so must remain valid
+ * until vrEmuTms9918TraceClose()
+ *
+ * returns NULL if data isn't a trace
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Trace* vrEmuTms9918TraceOpenMemory(const void* data, size_t numBytes);
+
+/* Function:  vrEmuTms9918TraceClose
+ * ----------------------------------------
+ * unmap and free a trace
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918TraceClose(VrEmuTms9918Trace* trace);
+
+/* Function:  vrEmuTms9918TraceSize
+ * ----------------------------------------
+ * size of a trace in bytes (header and snapshot included)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918TraceSize(const VrEmuTms9918Trace* trace);
+
+/* Function:  vrEmuTms9918TraceReplay
+ * ----------------------------------------
+ * load the trace's snapshot into tms9918, then stream every record through
+ * it as fast as possible: port accesses are repeated, scanlines and frames
+ * are generated (into scratch buffers) or, with
+ * TMS_TRACE_REPLAY_SKIP_PIXELS, only skipped. reads are checked against
+ * the recorded values
+ *
+ * stats (optional) receives what was replayed
+ *
+ * returns false if the snapshot can't be loaded or a record is malformed
+ * (stats then covers the records before it)
+ */
+VR_EMU_TMS9918_DLLEXPORT
+bool vrEmuTms9918TraceReplay(const VrEmuTms9918Trace* trace, VrEmuTms9918* tms9918, unsigned flags,
+                             vrEmuTms9918TraceStats* stats);
+
+#endif // _VR_EMU_TMS9918_TRACE_H_
@@ -75,10 +75,7 @@ inline static void vrEmuTms9918SetAddressWrite(VrEmuTms9918* tms9918, uint16_t a
  */
 inline static void vrEmuTms9918WriteBytes(VrEmuTms9918* tms9918, const uint8_t *bytes, size_t numBytes)
 {
-  for (size_t i = 0; i < numBytes; ++i)
-  {
-    vrEmuTms9918WriteData(tms9918, bytes[i]);
-  }
+  vrEmuTms9918WriteBlock(tms9918, bytes, numBytes);
 }
 
 /*
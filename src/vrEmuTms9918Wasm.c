@@ -0,0 +1,104 @@
+/*
+ * Troy's TMS9918 Emulator - WebAssembly frame export
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Wasm.h"
+#include "vrEmuTms9918Output.h"
+#include "vrEmuTms9918Util.h"
+
+/* PRIVATE DATA
+ * ---------------------------------------- */
+
+/* the exported frame. static, so its address never changes */
+static uint8_t tmsWasmFrame[TMS9918_WASM_FRAME_BYTES];
+
+static vrEmuTms9918Output tmsWasmOutput;
+static uint32_t tmsWasmPalette[16];
+static bool tmsWasmOutputValid = false;
+
+
+/* Function:  tmsWasmOutputInit
+ * ----------------------------------------
+ * (re)build the RGBA conversion after a palette change
+ */
+static void tmsWasmOutputInit(void)
+{
+  vrEmuTms9918OutputInit(&tmsWasmOutput, TMS_PIXEL_RGBA8888, 1, tmsWasmPalette);
+  tmsWasmOutputValid = true;
+}
+
+/* Function:  tmsWasmPaletteInit
+ * ----------------------------------------
+ * start from the default palette
+ */
+static void tmsWasmPaletteInit(void)
+{
+  static bool paletteInit = false;
+
+  if (paletteInit)
+    return;
+
+  for (int i = 0; i < 16; ++i)
+  {
+    tmsWasmPalette[i] = vrEmuTms9918Palette[i];
+  }
+  paletteInit = true;
+}
+
+
+/* Function:  vrEmuTms9918WasmFrame
+ * ----------------------------------------
+ * the exported frame
+ */
+VR_EMU_TMS9918_DLLEXPORT uint8_t* vrEmuTms9918WasmFrame(void)
+{
+  return tmsWasmFrame;
+}
+
+/* Function:  vrEmuTms9918WasmFrameBytes
+ * ----------------------------------------
+ * size of the exported frame
+ */
+VR_EMU_TMS9918_DLLEXPORT size_t vrEmuTms9918WasmFrameBytes(void)
+{
+  return sizeof(tmsWasmFrame);
+}
+
+/* Function:  vrEmuTms9918WasmSetPaletteColor
+ * ----------------------------------------
+ * set an exported frame color
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WasmSetPaletteColor(uint8_t index, uint32_t rgba)
+{
+  if (index >= 16)
+    return;
+
+  tmsWasmPaletteInit();
+  tmsWasmPalette[index] = rgba;
+  tmsWasmOutputValid = false;
+}
+
+/* Function:  vrEmuTms9918WasmRenderFrame
+ * ----------------------------------------
+ * render a frame into the exported frame
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WasmRenderFrame(VrEmuTms9918* tms9918)
+{
+  if (tms9918 == NULL)
+    return;
+
+  if (!tmsWasmOutputValid)
+  {
+    tmsWasmPaletteInit();
+    tmsWasmOutputInit();
+  }
+
+  vrEmuTms9918RenderFrameToSurface(tms9918, &tmsWasmOutput, tmsWasmFrame, TMS9918_WASM_FRAME_PITCH);
+}
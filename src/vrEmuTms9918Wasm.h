@@ -0,0 +1,62 @@
+/*
+ * Troy's TMS9918 Emulator - WebAssembly frame export
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_WASM_H_
+#define _VR_EMU_TMS9918_WASM_H_
+
+#include "vrEmuTms9918.h"
+
+/* the exported frame: TMS9918_PIXELS_Y rows of TMS9918_PIXELS_X RGBA8888
+   pixels (bytes R, G, B, A), no padding. the layout ImageData and
+   texImage2D(..., RGBA, UNSIGNED_BYTE, ...) expect */
+#define TMS9918_WASM_FRAME_PITCH  (TMS9918_PIXELS_X * 4)
+#define TMS9918_WASM_FRAME_BYTES  (TMS9918_PIXELS_Y * TMS9918_WASM_FRAME_PITCH)
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918WasmFrame
+ * ----------------------------------------
+ * the exported frame, at a fixed address for the lifetime of the module.
+ * JavaScript wraps it once:
+ *
+ *   new Uint8ClampedArray(HEAPU8.buffer, ptr, TMS9918_WASM_FRAME_BYTES)
+ *
+ * the view stays valid as long as the heap can't grow
+ */
+VR_EMU_TMS9918_DLLEXPORT
+uint8_t* vrEmuTms9918WasmFrame(void);
+
+/* Function:  vrEmuTms9918WasmFrameBytes
+ * ----------------------------------------
+ * TMS9918_WASM_FRAME_BYTES, for callers without the header
+ */
+VR_EMU_TMS9918_DLLEXPORT
+size_t vrEmuTms9918WasmFrameBytes(void);
+
+/* Function:  vrEmuTms9918WasmSetPaletteColor
+ * ----------------------------------------
+ * set exported frame color index (0 - 15) to rgba (0xRRGGBBAA). the
+ * default is vrEmuTms9918Palette
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918WasmSetPaletteColor(uint8_t index, uint32_t rgba);
+
+/* Function:  vrEmuTms9918WasmRenderFrame
+ * ----------------------------------------
+ * vrEmuTms9918RenderFrame() converted straight into the exported frame, so
+ * a whole frame is one call from JavaScript with nothing to copy out
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918WasmRenderFrame(VrEmuTms9918* tms9918);
+
+#endif // _VR_EMU_TMS9918_WASM_H_
@@ -0,0 +1,223 @@
+/*
+ * Troy's TMS9918 Emulator - Shared VRAM watchpoints
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_WATCH_H_
+#define _VR_EMU_TMS9918_WATCH_H_
+
+/* the watched address ranges behind vrEmuTms9918AddWatch() and
+ * VDPAddWatch(): a small interval set, checked on vram writes, that
+ * collects the changed ranges of each watch until they are reported. the
+ * owner keeps the callbacks and decides when to report (see tmsWatchDue) */
+
+#include "vrEmuTms9918.h"
+#include <string.h>
+
+#define TMS_WATCH_VRAM_BYTES (TMS9918_VRAM_PAGES * TMS9918_VRAM_PAGE_BYTES)
+
+/* a watched address range and its changes since last reported
+ * ---------------------------------------- */
+typedef struct
+{
+  uint16_t first;      /* watched addresses first to end - 1 */
+  uint16_t end;
+  uint8_t numRanges;
+  vrEmuTms9918VramRange ranges[TMS9918_WATCH_MAX_RANGES];
+} tmsWatch;
+
+/* all watches of an instance
+ * ---------------------------------------- */
+typedef struct
+{
+  uint64_t pages;       /* bit per TMS9918_VRAM_PAGE_BYTES page overlapping a watch */
+  uint8_t active;       /* bit per installed watch */
+  uint8_t lineWatches;  /* TMS_WATCH_LINE watches */
+  uint8_t pending;      /* watches with changes to report */
+  tmsWatch watches[TMS9918_MAX_WATCHES];
+} tmsWatchSet;
+
+
+/* Function:  tmsWatchSetInit
+ * ----------------------------------------
+ * no watches
+ */
+static inline void tmsWatchSetInit(tmsWatchSet* set)
+{
+  memset(set, 0, sizeof(*set));
+}
+
+/* Function:  tmsWatchUpdatePages
+ * ----------------------------------------
+ * rebuild the page mask after adding or removing a watch
+ */
+static inline void tmsWatchUpdatePages(tmsWatchSet* set)
+{
+  set->pages = 0;
+
+  for (uint8_t i = 0; i < TMS9918_MAX_WATCHES; ++i)
+  {
+    if (set->active & (1 << i))
+    {
+      const tmsWatch* watch = &set->watches[i];
+      for (uint16_t page = watch->first / TMS9918_VRAM_PAGE_BYTES; page <= (watch->end - 1) / TMS9918_VRAM_PAGE_BYTES; ++page)
+      {
+        set->pages |= (uint64_t)1 << page;
+      }
+    }
+  }
+}
+
+/* Function:  tmsWatchAdd
+ * ----------------------------------------
+ * watch numBytes from addr (clipped to the end of vram)
+ *
+ * returns the watch number, or -1 if there are no free watches
+ */
+static inline int tmsWatchAdd(tmsWatchSet* set, uint16_t addr, uint16_t numBytes, unsigned flags)
+{
+  addr &= TMS_WATCH_VRAM_BYTES - 1;
+  if (numBytes == 0)
+    return -1;
+
+  for (int i = 0; i < TMS9918_MAX_WATCHES; ++i)
+  {
+    if ((set->active & (1 << i)) == 0)
+    {
+      tmsWatch* watch = &set->watches[i];
+      watch->first = addr;
+      watch->end = (numBytes < TMS_WATCH_VRAM_BYTES - addr) ? addr + numBytes : TMS_WATCH_VRAM_BYTES;
+      watch->numRanges = 0;
+
+      set->active |= (uint8_t)(1 << i);
+      if (flags & TMS_WATCH_LINE) set->lineWatches |= (uint8_t)(1 << i);
+      else set->lineWatches &= (uint8_t)~(1 << i);
+
+      tmsWatchUpdatePages(set);
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/* Function:  tmsWatchRemove
+ * ----------------------------------------
+ * remove a watch. unreported changes are dropped
+ */
+static inline void tmsWatchRemove(tmsWatchSet* set, int watch)
+{
+  if (watch < 0 || watch >= TMS9918_MAX_WATCHES)
+    return;
+
+  const uint8_t bit = (uint8_t)(1 << watch);
+  set->active &= (uint8_t)~bit;
+  set->lineWatches &= (uint8_t)~bit;
+  set->pending &= (uint8_t)~bit;
+
+  tmsWatchUpdatePages(set);
+}
+
+/* Function:  tmsWatchHit
+ * ----------------------------------------
+ * could a write to numBytes (> 0) from addr touch a watch? the only check
+ * on the write paths, so a single test (never true without watches)
+ */
+static inline bool tmsWatchHit(const tmsWatchSet* set, uint16_t addr, uint16_t numBytes)
+{
+  if (numBytes == 1)
+  {
+    return (set->pages >> (addr / TMS9918_VRAM_PAGE_BYTES)) & 1;
+  }
+
+  const uint8_t firstPage = addr / TMS9918_VRAM_PAGE_BYTES;
+  const uint8_t lastPage = (uint16_t)(addr + numBytes - 1) / TMS9918_VRAM_PAGE_BYTES;
+
+  return (set->pages & (~(uint64_t)0 << firstPage) & (~(uint64_t)0 >> (63 - lastPage))) != 0;
+}
+
+/* Function:  tmsWatchAddRange
+ * ----------------------------------------
+ * coalesce a changed range into a watch's ranges. a range touching or
+ * overlapping an existing one extends it (sequential writes through the
+ * data port extend the last range). once full, the last range grows to
+ * cover it
+ */
+static inline void tmsWatchAddRange(tmsWatch* watch, uint16_t first, uint16_t end)
+{
+  for (int i = watch->numRanges - 1; i >= 0; --i)
+  {
+    vrEmuTms9918VramRange* range = &watch->ranges[i];
+    const uint16_t rangeEnd = range->addr + range->numBytes;
+
+    if (first <= rangeEnd && end >= range->addr)
+    {
+      if (first < range->addr) range->addr = first;
+      range->numBytes = (uint16_t)(((end > rangeEnd) ? end : rangeEnd) - range->addr);
+      return;
+    }
+  }
+
+  if (watch->numRanges < TMS9918_WATCH_MAX_RANGES)
+  {
+    watch->ranges[watch->numRanges].addr = first;
+    watch->ranges[watch->numRanges].numBytes = (uint16_t)(end - first);
+    ++watch->numRanges;
+    return;
+  }
+
+  vrEmuTms9918VramRange* last = &watch->ranges[TMS9918_WATCH_MAX_RANGES - 1];
+  const uint16_t lastEnd = last->addr + last->numBytes;
+  if (first < last->addr) last->addr = first;
+  last->numBytes = (uint16_t)(((end > lastEnd) ? end : lastEnd) - last->addr);
+}
+
+/* Function:  tmsWatchWrite
+ * ----------------------------------------
+ * record a write of numBytes of data to vram from addr (not wrapping),
+ * before it is stored. only bytes that change value are recorded
+ */
+static inline void tmsWatchWrite(tmsWatchSet* set, const uint8_t* vram, uint16_t addr, const uint8_t* data, uint16_t numBytes)
+{
+  const uint16_t end = addr + numBytes;
+
+  for (uint8_t i = 0; i < TMS9918_MAX_WATCHES; ++i)
+  {
+    tmsWatch* watch = &set->watches[i];
+
+    if ((set->active & (1 << i)) == 0 || addr >= watch->end || end <= watch->first)
+      continue;
+
+    /* the changed bytes within the watch */
+    uint16_t first = (addr > watch->first) ? addr : watch->first;
+    uint16_t last = (end < watch->end) ? end : watch->end;
+
+    while (first < last && vram[first] == data[first - addr]) ++first;
+    while (last > first && vram[last - 1] == data[last - 1 - addr]) --last;
+
+    if (first < last)
+    {
+      tmsWatchAddRange(watch, first, last);
+      set->pending |= (uint8_t)(1 << i);
+    }
+  }
+}
+
+/* Function:  tmsWatchDue
+ * ----------------------------------------
+ * watches to report at a line boundary (or a frame boundary, which is
+ * also a line boundary). the owner takes each watch's ranges, clears
+ * numRanges and the pending bit, then calls its callback
+ */
+static inline uint8_t tmsWatchDue(const tmsWatchSet* set, bool frame)
+{
+  return frame ? set->pending : (uint8_t)(set->pending & set->lineWatches);
+}
+
+#endif // _VR_EMU_TMS9918_WATCH_H_
@@ -0,0 +1,252 @@
+/*
+ * Troy's TMS9918 Emulator - Worker thread pool
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#include "vrEmuTms9918Workers.h"
+#include <stdlib.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+
+  typedef SRWLOCK tmsMutex;
+  typedef CONDITION_VARIABLE tmsCond;
+  typedef HANDLE tmsThread;
+
+  #define tmsMutexInit(m)       InitializeSRWLock(m)
+  #define tmsMutexDestroy(m)    ((void)(m))
+  #define tmsMutexLock(m)       AcquireSRWLockExclusive(m)
+  #define tmsMutexUnlock(m)     ReleaseSRWLockExclusive(m)
+  #define tmsCondInit(c)        InitializeConditionVariable(c)
+  #define tmsCondDestroy(c)     ((void)(c))
+  #define tmsCondWait(c, m)     SleepConditionVariableSRW(c, m, INFINITE, 0)
+  #define tmsCondBroadcast(c)   WakeAllConditionVariable(c)
+#else
+  #include <pthread.h>
+
+  typedef pthread_mutex_t tmsMutex;
+  typedef pthread_cond_t tmsCond;
+  typedef pthread_t tmsThread;
+
+  #define tmsMutexInit(m)       pthread_mutex_init(m, NULL)
+  #define tmsMutexDestroy(m)    pthread_mutex_destroy(m)
+  #define tmsMutexLock(m)       pthread_mutex_lock(m)
+  #define tmsMutexUnlock(m)     pthread_mutex_unlock(m)
+  #define tmsCondInit(c)        pthread_cond_init(c, NULL)
+  #define tmsCondDestroy(c)     pthread_cond_destroy(c)
+  #define tmsCondWait(c, m)     pthread_cond_wait(c, m)
+  #define tmsCondBroadcast(c)   pthread_cond_broadcast(c)
+#endif
+
+ /* PRIVATE DATA STRUCTURE
+  * ---------------------- */
+struct vrEmuTms9918Workers_s
+{
+  /* guards everything below */
+  tmsMutex mutex;
+
+  /* broadcast when a new batch is posted (or on shutdown) */
+  tmsCond batchPosted;
+
+  /* broadcast when the last job of a batch completes */
+  tmsCond batchDone;
+
+  /* current batch */
+  vrEmuTms9918JobFn job;
+  void* jobData;
+  size_t numJobs;
+  size_t nextJob;
+  size_t jobsDone;
+  unsigned batch;
+
+  bool shutdown;
+
+  unsigned numThreads;
+  tmsThread* threads;
+};
+
+
+/* Function:  tmsWorkersRunJobs
+ * ----------------------------------------
+ * run jobs from the current batch until there are none left to claim.
+ * called (and returns) with the mutex held
+ */
+static void tmsWorkersRunJobs(VrEmuTms9918Workers* workers)
+{
+  while (workers->nextJob < workers->numJobs)
+  {
+    const size_t jobIndex = workers->nextJob++;
+
+    tmsMutexUnlock(&workers->mutex);
+    workers->job(workers->jobData, jobIndex);
+    tmsMutexLock(&workers->mutex);
+
+    if (++workers->jobsDone == workers->numJobs)
+    {
+      tmsCondBroadcast(&workers->batchDone);
+    }
+  }
+}
+
+/* Function:  tmsWorkerMain
+ * ----------------------------------------
+ * worker thread. waits for batches until shutdown
+ */
+static void tmsWorkerMain(VrEmuTms9918Workers* workers)
+{
+  tmsMutexLock(&workers->mutex);
+
+  unsigned batch = workers->batch;
+  for (;;)
+  {
+    while (!workers->shutdown && workers->batch == batch)
+    {
+      tmsCondWait(&workers->batchPosted, &workers->mutex);
+    }
+
+    if (workers->shutdown)
+      break;
+
+    batch = workers->batch;
+    tmsWorkersRunJobs(workers);
+  }
+
+  tmsMutexUnlock(&workers->mutex);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI tmsWorkerThread(LPVOID param)
+{
+  tmsWorkerMain((VrEmuTms9918Workers*)param);
+  return 0;
+}
+#else
+static void* tmsWorkerThread(void* param)
+{
+  tmsWorkerMain((VrEmuTms9918Workers*)param);
+  return NULL;
+}
+#endif
+
+
+/* Function:  vrEmuTms9918WorkersNew
+ * ----------------------------------------
+ * create a pool of worker threads
+ */
+VR_EMU_TMS9918_DLLEXPORT VrEmuTms9918Workers* vrEmuTms9918WorkersNew(unsigned numThreads)
+{
+  VrEmuTms9918Workers* workers = (VrEmuTms9918Workers*)calloc(1, sizeof(VrEmuTms9918Workers));
+  if (workers == NULL)
+    return NULL;
+
+  workers->threads = (tmsThread*)calloc(numThreads ? numThreads : 1, sizeof(tmsThread));
+  if (workers->threads == NULL)
+  {
+    free(workers);
+    return NULL;
+  }
+
+  tmsMutexInit(&workers->mutex);
+  tmsCondInit(&workers->batchPosted);
+  tmsCondInit(&workers->batchDone);
+
+  for (unsigned i = 0; i < numThreads; ++i)
+  {
+#if defined(_WIN32)
+    workers->threads[i] = CreateThread(NULL, 0, tmsWorkerThread, workers, 0, NULL);
+    if (workers->threads[i] == NULL)
+      break;
+#else
+    if (pthread_create(&workers->threads[i], NULL, tmsWorkerThread, workers) != 0)
+      break;
+#endif
+    ++workers->numThreads;
+  }
+
+  return workers;
+}
+
+/* Function:  vrEmuTms9918WorkersDestroy
+ * ----------------------------------------
+ * stop the worker threads and destroy the pool
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WorkersDestroy(VrEmuTms9918Workers* workers)
+{
+  if (workers == NULL)
+    return;
+
+  tmsMutexLock(&workers->mutex);
+  workers->shutdown = true;
+  tmsCondBroadcast(&workers->batchPosted);
+  tmsMutexUnlock(&workers->mutex);
+
+  for (unsigned i = 0; i < workers->numThreads; ++i)
+  {
+#if defined(_WIN32)
+    WaitForSingleObject(workers->threads[i], INFINITE);
+    CloseHandle(workers->threads[i]);
+#else
+    pthread_join(workers->threads[i], NULL);
+#endif
+  }
+
+  tmsCondDestroy(&workers->batchDone);
+  tmsCondDestroy(&workers->batchPosted);
+  tmsMutexDestroy(&workers->mutex);
+
+  free(workers->threads);
+  free(workers);
+}
+
+/* Function:  vrEmuTms9918WorkersParallelFor
+ * ----------------------------------------
+ * run a batch of jobs on the pool (and the calling thread)
+ */
+VR_EMU_TMS9918_DLLEXPORT void vrEmuTms9918WorkersParallelFor(void* pool, size_t numJobs, vrEmuTms9918JobFn job, void* jobData)
+{
+  VrEmuTms9918Workers* workers = (VrEmuTms9918Workers*)pool;
+
+  if (job == NULL || numJobs == 0)
+    return;
+
+  if (workers == NULL || workers->numThreads == 0 || numJobs == 1)
+  {
+    for (size_t i = 0; i < numJobs; ++i)
+    {
+      job(jobData, i);
+    }
+    return;
+  }
+
+  tmsMutexLock(&workers->mutex);
+
+  /* one batch at a time. wait for any batch posted by another thread */
+  while (workers->jobsDone < workers->numJobs)
+  {
+    tmsCondWait(&workers->batchDone, &workers->mutex);
+  }
+
+  workers->job = job;
+  workers->jobData = jobData;
+  workers->numJobs = numJobs;
+  workers->nextJob = 0;
+  workers->jobsDone = 0;
+  const unsigned batch = ++workers->batch;
+  tmsCondBroadcast(&workers->batchPosted);
+
+  tmsWorkersRunJobs(workers);
+
+  /* a newer batch can only have been posted once this one completed */
+  while (workers->batch == batch && workers->jobsDone < workers->numJobs)
+  {
+    tmsCondWait(&workers->batchDone, &workers->mutex);
+  }
+
+  tmsMutexUnlock(&workers->mutex);
+}
@@ -0,0 +1,51 @@
+/*
+ * Troy's TMS9918 Emulator - Worker thread pool
+ *
+ * Copyright (c) 2021 Troy Schrapel
+ *
+ * This code is licensed under the MIT license
+ *
+ * https://github.com/visrealm/vrEmuTms9918
+ *
+ */
+
+#ifndef _VR_EMU_TMS9918_WORKERS_H_
+#define _VR_EMU_TMS9918_WORKERS_H_
+
+#include "vrEmuTms9918.h"
+
+/* PRIVATE DATA STRUCTURE
+ * ---------------------------------------- */
+struct vrEmuTms9918Workers_s;
+typedef struct vrEmuTms9918Workers_s VrEmuTms9918Workers;
+
+
+/* PUBLIC INTERFACE
+ * ---------------------------------------- */
+
+/* Function:  vrEmuTms9918WorkersNew
+ * ----------------------------------------
+ * create a pool of numThreads worker threads. the thread calling
+ * vrEmuTms9918WorkersParallelFor() also runs jobs, so a pool of
+ * (cores - 1) threads uses every core
+ */
+VR_EMU_TMS9918_DLLEXPORT
+VrEmuTms9918Workers* vrEmuTms9918WorkersNew(unsigned numThreads);
+
+/* Function:  vrEmuTms9918WorkersDestroy
+ * ----------------------------------------
+ * stop the worker threads and destroy the pool
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918WorkersDestroy(VrEmuTms9918Workers* workers);
+
+/* Function:  vrEmuTms9918WorkersParallelFor
+ * ----------------------------------------
+ * a vrEmuTms9918ParallelFor. workers is the VrEmuTms9918Workers pool
+ *
+ * eg. vrEmuTms9918RenderFrameParallel(tms9918, fb, pitch, 4, vrEmuTms9918WorkersParallelFor, workers);
+ */
+VR_EMU_TMS9918_DLLEXPORT
+void vrEmuTms9918WorkersParallelFor(void* workers, size_t numJobs, vrEmuTms9918JobFn job, void* jobData);
+
+#endif // _VR_EMU_TMS9918_WORKERS_H_